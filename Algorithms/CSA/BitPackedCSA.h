@@ -0,0 +1,420 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "../../DataStructures/CSA/Data.h"
+#include "../../DataStructures/CSA/Entities/Journey.h"
+#include "../../ExternalLibs/aligned_allocator.h"
+#include "../../Helpers/Assert.h"
+#include "../../Helpers/Timer.h"
+#include "../../Helpers/Types.h"
+#include "../../Helpers/Vector/Vector.h"
+#include "Profiler.h"
+
+namespace CSA {
+
+// Variant of the CSA that computes the same earliest arrival times, but is
+// laid out for scanning many connections quickly:
+// - The connections are stored as separate, 32 byte aligned arrays, padded to
+//   a multiple of the block size with connections that are never reachable.
+// - The trip flags are a bitset, which is cleared with a single memset.
+// - Arrival times are tagged with the query epoch in which they were written,
+//   so clearing them is O(1).
+// - The connections are tested in blocks of eight without branches (with AVX2
+//   gathers if USE_SIMD is set). Only connections that are reachable and
+//   either enter their trip or improve their arrival stop are scanned, so
+//   METRIC_CONNECTIONS counts fewer connections than in the CSA. Later
+//   connections of a block are re-tested if an earlier one changed a label.
+//   Without USE_SIMD, the test is evaluated per lane and the CSA is faster.
+template <bool PATH_RETRIEVAL = true, typename PROFILER = NoProfiler>
+class BitPackedCSA {
+ public:
+  constexpr static bool PathRetrieval = PATH_RETRIEVAL;
+  using Profiler = PROFILER;
+  using Type = BitPackedCSA<PathRetrieval, Profiler>;
+
+  constexpr static size_t BlockSize = 8;
+  constexpr static uint32_t AllLanes = (1u << BlockSize) - 1;
+
+ private:
+  template <typename T>
+  using AlignedVector = std::vector<T, aligned_allocator<T, 32>>;
+
+  struct ParentLabel {
+    ParentLabel(const StopId parent = noStop,
+                const bool reachedByTransfer = false,
+                const TripId tripId = noTripId)
+        : parent(parent),
+          reachedByTransfer(reachedByTransfer),
+          tripId(tripId) {}
+
+    StopId parent;
+    bool reachedByTransfer;
+    union {
+      TripId tripId;
+      Edge transferId;
+    };
+  };
+
+ public:
+  BitPackedCSA(const Data& data, const Profiler& profilerTemplate = Profiler())
+      : data(data),
+        sourceStop(noStop),
+        targetStop(noStop),
+        tripFlags((data.numberOfTrips() + 32) / 32, 0),
+        tripEntry(PathRetrieval ? data.numberOfTrips() : 0, noConnection),
+        arrivalTime(data.numberOfStops(), never),
+        arrivalEpoch(data.numberOfStops(), 0),
+        epoch(0),
+        parentLabel(PathRetrieval ? data.numberOfStops() : 0),
+        profiler(profilerTemplate) {
+    AssertMsg(Vector::isSorted(data.connections),
+              "Connections must be sorted in ascending order!");
+    AssertMsg(data.numberOfStops() > 0, "The network has no stops!");
+    buildConnectionArrays();
+    profiler.registerPhases(
+        {PHASE_CLEAR, PHASE_INITIALIZATION, PHASE_CONNECTION_SCAN});
+    profiler.registerMetrics({METRIC_CONNECTIONS, METRIC_EDGES,
+                              METRIC_STOPS_BY_TRIP, METRIC_STOPS_BY_TRANSFER});
+    profiler.initialize();
+  }
+
+  inline void run(const StopId source, const int departureTime,
+                  const StopId target = noStop) noexcept {
+    profiler.start();
+
+    profiler.startPhase();
+    AssertMsg(data.isStop(source),
+              "Source stop " << source << " is not a valid stop!");
+    clear();
+    profiler.donePhase(PHASE_CLEAR);
+
+    profiler.startPhase();
+    sourceStop = source;
+    targetStop = target;
+    setArrivalTime(sourceStop, departureTime);
+    relaxEdges(sourceStop, departureTime);
+    const ConnectionId firstConnection =
+        firstReachableConnection(departureTime);
+    profiler.donePhase(PHASE_INITIALIZATION);
+
+    profiler.startPhase();
+    scanConnections(firstConnection, ConnectionId(data.connections.size()));
+    profiler.donePhase(PHASE_CONNECTION_SCAN);
+
+    profiler.done();
+  }
+
+  inline bool reachable(const StopId stop) const noexcept {
+    return getArrivalTime(stop) < never;
+  }
+
+  inline int getEarliestArrivalTime(const StopId stop) const noexcept {
+    return getArrivalTime(stop);
+  }
+
+  template <bool T = PathRetrieval,
+            typename = std::enable_if_t<T == PathRetrieval && T>>
+  inline Journey getJourney() const noexcept {
+    return getJourney(targetStop);
+  }
+
+  template <bool T = PathRetrieval,
+            typename = std::enable_if_t<T == PathRetrieval && T>>
+  inline Journey getJourney(StopId stop) const noexcept {
+    Journey journey;
+    if (!reachable(stop)) return journey;
+    while (stop != sourceStop) {
+      const ParentLabel& label = parentLabel[stop];
+      const int time = getArrivalTime(stop);
+      if (label.reachedByTransfer) {
+        const int travelTime =
+            data.transferGraph.get(TravelTime, label.transferId);
+        journey.emplace_back(label.parent, stop, time - travelTime, time,
+                             label.transferId);
+      } else {
+        journey.emplace_back(label.parent, stop,
+                             departureTime[tripEntry[label.tripId]], time,
+                             label.tripId);
+      }
+      stop = label.parent;
+    }
+    Vector::reverse(journey);
+    return journey;
+  }
+
+  inline std::vector<Vertex> getPath(const StopId stop) const noexcept {
+    return journeyToPath(getJourney(stop));
+  }
+
+  inline std::vector<std::string> getRouteDescription(
+      const StopId stop) const noexcept {
+    return data.journeyToText(getJourney(stop));
+  }
+
+  inline const Profiler& getProfiler() const noexcept { return profiler; }
+
+ private:
+  inline void buildConnectionArrays() noexcept {
+    const size_t numberOfConnections = data.numberOfConnections();
+    const size_t paddedSize =
+        ((numberOfConnections + BlockSize - 1) / BlockSize) * BlockSize;
+    departureStop.assign(paddedSize, 0);
+    arrivalStop.assign(paddedSize, 0);
+    departureTime.assign(paddedSize, never);
+    connectionArrivalTime.assign(paddedSize, never);
+    trip.assign(paddedSize, data.numberOfTrips());
+    latestArrivalAtDepartureStop.assign(paddedSize,
+                                        std::numeric_limits<int>::min());
+    for (size_t i = 0; i < numberOfConnections; i++) {
+      const Connection& connection = data.connections[i];
+      departureStop[i] = connection.departureStopId;
+      arrivalStop[i] = connection.arrivalStopId;
+      departureTime[i] = connection.departureTime;
+      connectionArrivalTime[i] = connection.arrivalTime;
+      trip[i] = connection.tripId;
+      latestArrivalAtDepartureStop[i] =
+          connection.departureTime -
+          data.minTransferTime(connection.departureStopId);
+    }
+  }
+
+  inline void clear() noexcept {
+    sourceStop = noStop;
+    targetStop = noStop;
+    std::fill(tripFlags.begin(), tripFlags.end(), 0);
+    ++epoch;
+    if (epoch == 0) [[unlikely]] {
+      std::fill(arrivalEpoch.begin(), arrivalEpoch.end(), 0);
+      epoch = 1;
+    }
+  }
+
+  inline int getArrivalTime(const StopId stop) const noexcept {
+    return (arrivalEpoch[stop] == epoch) ? arrivalTime[stop] : never;
+  }
+
+  inline void setArrivalTime(const StopId stop, const int time) noexcept {
+    arrivalTime[stop] = time;
+    arrivalEpoch[stop] = epoch;
+  }
+
+  inline bool tripIsReached(const uint32_t t) const noexcept {
+    return (tripFlags[t >> 5] >> (t & 31)) & 1;
+  }
+
+  inline ConnectionId firstReachableConnection(
+      const int time) const noexcept {
+    return ConnectionId(
+        Vector::lowerBound(data.connections, time,
+                           [](const Connection& connection, const int time) {
+                             return connection.departureTime < time;
+                           }));
+  }
+
+  // Bit i of the result is set if connection block + i has to be scanned,
+  // i.e., it is reachable (from its trip or its departure stop) and it either
+  // enters its trip or improves the arrival time at its arrival stop.
+  // Reachable connections that do neither do not change any label.
+  inline uint32_t activeLanes(const size_t block) const noexcept {
+#ifdef USE_SIMD
+    const __m256i byStop =
+        _mm256_cmpgt_epi32(_mm256_add_epi32(load(latestArrivalAtDepartureStop,
+                                                 block),
+                                            _mm256_set1_epi32(1)),
+                           gatherArrivalTimes(load(departureStop, block)));
+
+    const __m256i trips = load(trip, block);
+    const __m256i words = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(tripFlags.data()),
+        _mm256_srli_epi32(trips, 5), 4);
+    const __m256i bits = _mm256_and_si256(
+        _mm256_srlv_epi32(words,
+                          _mm256_and_si256(trips, _mm256_set1_epi32(31))),
+        _mm256_set1_epi32(1));
+    const __m256i byTrip = _mm256_cmpeq_epi32(bits, _mm256_set1_epi32(1));
+
+    const __m256i improves =
+        _mm256_cmpgt_epi32(gatherArrivalTimes(load(arrivalStop, block)),
+                           load(connectionArrivalTime, block));
+
+    const __m256i active = _mm256_or_si256(_mm256_and_si256(byTrip, improves),
+                                           _mm256_andnot_si256(byTrip, byStop));
+    return uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(active)));
+#else
+    uint32_t lanes = 0;
+    for (size_t i = 0; i < BlockSize; i++) {
+      lanes |= uint32_t(connectionIsActive(block + i)) << i;
+    }
+    return lanes;
+#endif
+  }
+
+#ifdef USE_SIMD
+  template <typename T>
+  inline static __m256i load(const AlignedVector<T>& values,
+                             const size_t block) noexcept {
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(&values[block]));
+  }
+
+  // Arrival times of the given stops, where labels of older epochs are read
+  // as never.
+  inline __m256i gatherArrivalTimes(const __m256i stops) const noexcept {
+    const __m256i times = _mm256_i32gather_epi32(arrivalTime.data(), stops, 4);
+    const __m256i epochs = _mm256_i32gather_epi32(
+        reinterpret_cast<const int*>(arrivalEpoch.data()), stops, 4);
+    return _mm256_blendv_epi8(
+        _mm256_set1_epi32(never), times,
+        _mm256_cmpeq_epi32(epochs, _mm256_set1_epi32(int(epoch))));
+  }
+#endif
+
+  inline bool connectionIsActive(const size_t i) const noexcept {
+    const bool byStop = getArrivalTime(StopId(departureStop[i])) <=
+                        latestArrivalAtDepartureStop[i];
+    const bool byTrip = tripIsReached(trip[i]);
+    const bool improves =
+        getArrivalTime(StopId(arrivalStop[i])) > connectionArrivalTime[i];
+    return (byTrip & improves) | (byStop & !byTrip);
+  }
+
+  inline void scanConnections(const ConnectionId begin,
+                              const ConnectionId end) noexcept {
+    for (size_t block = begin - (begin % BlockSize); block < end;
+         block += BlockSize) {
+      if (targetStop != noStop &&
+          departureTime[block] > getArrivalTime(targetStop))
+        break;
+      uint32_t lanes = AllLanes;
+      if (block < begin) lanes &= AllLanes << (begin - block);
+      if (block + BlockSize > end)
+        lanes &= AllLanes >> (block + BlockSize - end);
+      uint32_t candidates = activeLanes(block) & lanes;
+      // The precomputed lanes stay exact as long as no label changes within
+      // the block. After a change, all later lanes become candidates that
+      // have to be re-tested.
+      uint32_t retest = 0;
+      while (candidates) {
+        const uint32_t lane = std::countr_zero(candidates);
+        candidates &= candidates - 1;
+        const size_t i = block + lane;
+        if (((retest >> lane) & 1) && !connectionIsActive(i)) continue;
+        if (scanConnection(i)) {
+          const uint32_t later = lanes & (AllLanes << (lane + 1));
+          retest |= later & ~candidates;
+          candidates |= later;
+        }
+      }
+    }
+  }
+
+  // Returns true if any label changed.
+  inline bool scanConnection(const size_t i) noexcept {
+    profiler.countMetric(METRIC_CONNECTIONS);
+    bool changed = false;
+    const uint32_t t = trip[i];
+    if (!tripIsReached(t)) {
+      tripFlags[t >> 5] |= 1u << (t & 31);
+      if constexpr (PathRetrieval) tripEntry[t] = ConnectionId(i);
+      changed = true;
+    }
+    return arrivalByTrip(StopId(arrivalStop[i]), connectionArrivalTime[i],
+                         TripId(t)) |
+           changed;
+  }
+
+  inline bool arrivalByTrip(const StopId stop, const int time,
+                            const TripId tripId) noexcept {
+    if (getArrivalTime(stop) <= time) return false;
+    profiler.countMetric(METRIC_STOPS_BY_TRIP);
+    setArrivalTime(stop, time);
+    if constexpr (PathRetrieval) {
+      parentLabel[stop].parent = StopId(departureStop[tripEntry[tripId]]);
+      parentLabel[stop].reachedByTransfer = false;
+      parentLabel[stop].tripId = tripId;
+    }
+    relaxEdges(stop, time);
+    return true;
+  }
+
+  inline void relaxEdges(const StopId stop, const int time) noexcept {
+    for (const Edge edge : data.transferGraph.edgesFrom(stop)) {
+      profiler.countMetric(METRIC_EDGES);
+      const StopId toStop = StopId(data.transferGraph.get(ToVertex, edge));
+      const int newArrivalTime =
+          time + data.transferGraph.get(TravelTime, edge);
+      arrivalByTransfer(toStop, newArrivalTime, stop, edge);
+    }
+  }
+
+  inline void arrivalByTransfer(const StopId stop, const int time,
+                                const StopId parent, const Edge edge) noexcept {
+    if (getArrivalTime(stop) <= time) return;
+    profiler.countMetric(METRIC_STOPS_BY_TRANSFER);
+    setArrivalTime(stop, time);
+    if constexpr (PathRetrieval) {
+      parentLabel[stop].parent = parent;
+      parentLabel[stop].reachedByTransfer = true;
+      parentLabel[stop].transferId = edge;
+    }
+  }
+
+ private:
+  const Data& data;
+
+  StopId sourceStop;
+  StopId targetStop;
+
+  AlignedVector<uint32_t> departureStop;
+  AlignedVector<uint32_t> arrivalStop;
+  AlignedVector<int> departureTime;
+  AlignedVector<int> connectionArrivalTime;
+  AlignedVector<uint32_t> trip;
+  AlignedVector<int> latestArrivalAtDepartureStop;
+
+  std::vector<uint32_t> tripFlags;
+  std::vector<ConnectionId> tripEntry;
+
+  std::vector<int> arrivalTime;
+  std::vector<uint32_t> arrivalEpoch;
+  uint32_t epoch;
+
+  std::vector<ParentLabel> parentLabel;
+
+  Profiler profiler;
+};
+}  // namespace CSA
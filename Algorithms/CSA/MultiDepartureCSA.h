@@ -0,0 +1,291 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../../DataStructures/CSA/Data.h"
+#include "../../ExternalLibs/aligned_allocator.h"
+#include "../../Helpers/Assert.h"
+#include "../../Helpers/Types.h"
+#include "../../Helpers/Vector/Vector.h"
+#include "Profiler.h"
+
+namespace CSA {
+
+// One-to-all earliest arrival CSA for several departure times at once (e.g.,
+// every five minutes within three hours for an isochrone map). Every stop
+// keeps one arrival time per departure time, and every connection is scanned
+// once for all of them, updating the arrival vectors with SIMD min operations
+// (AVX2 if USE_SIMD is set).
+// Since departing later never leads to an earlier arrival, the arrival times
+// of a stop are non-decreasing in the departure time (as in the CSA, the
+// transfer graph has to be transitively closed). Hence, the departure times
+// from which a connection (or trip) is reachable are always a prefix of the
+// sorted departure times, and each trip only stores the length of its reached
+// prefix. Likewise, the lanes improved by a connection are a contiguous range.
+template <typename PROFILER = NoProfiler>
+class MultiDepartureCSA {
+ public:
+  using Profiler = PROFILER;
+  using Type = MultiDepartureCSA<Profiler>;
+
+  constexpr static size_t VectorSize = 8;
+
+ private:
+  using ArrivalTimes = std::vector<int, aligned_allocator<int, 32>>;
+
+ public:
+  MultiDepartureCSA(const Data& data,
+                    const Profiler& profilerTemplate = Profiler())
+      : data(data),
+        sourceStop(noStop),
+        numberOfLanes(0),
+        stride(0),
+        reachedLanes(data.numberOfTrips(), 0),
+        profiler(profilerTemplate) {
+    AssertMsg(Vector::isSorted(data.connections),
+              "Connections must be sorted in ascending order!");
+    profiler.registerPhases(
+        {PHASE_CLEAR, PHASE_INITIALIZATION, PHASE_CONNECTION_SCAN});
+    profiler.registerMetrics({METRIC_CONNECTIONS, METRIC_EDGES,
+                              METRIC_STOPS_BY_TRIP, METRIC_STOPS_BY_TRANSFER});
+    profiler.initialize();
+  }
+
+  // Departure times every interval seconds within [minDepartureTime,
+  // maxDepartureTime].
+  inline void run(const StopId source, const int minDepartureTime,
+                  const int maxDepartureTime, const int interval) noexcept {
+    AssertMsg(interval > 0, "The interval has to be positive!");
+    std::vector<int> departures;
+    for (int time = minDepartureTime; time <= maxDepartureTime;
+         time += interval) {
+      departures.emplace_back(time);
+    }
+    run(source, departures);
+  }
+
+  inline void run(const StopId source,
+                  const std::vector<int>& departures) noexcept {
+    profiler.start();
+
+    profiler.startPhase();
+    AssertMsg(data.isStop(source),
+              "Source stop " << source << " is not a valid stop!");
+    AssertMsg(!departures.empty(), "No departure times given!");
+    AssertMsg(Vector::isSorted(departures),
+              "Departure times must be sorted in ascending order!");
+    clear(departures);
+    profiler.donePhase(PHASE_CLEAR);
+
+    profiler.startPhase();
+    sourceStop = source;
+    int* sourceTimes = arrivalTimesOf(sourceStop);
+    std::copy(departureTimes.begin(), departureTimes.end(), sourceTimes);
+    relaxInitialEdges(sourceStop);
+    const ConnectionId firstConnection =
+        firstReachableConnection(departureTimes.front());
+    profiler.donePhase(PHASE_INITIALIZATION);
+
+    profiler.startPhase();
+    scanConnections(firstConnection, ConnectionId(data.connections.size()));
+    profiler.donePhase(PHASE_CONNECTION_SCAN);
+
+    profiler.done();
+  }
+
+  inline size_t numberOfDepartureTimes() const noexcept {
+    return numberOfLanes;
+  }
+
+  inline const std::vector<int>& getDepartureTimes() const noexcept {
+    return departureTimes;
+  }
+
+  inline bool reachable(const StopId stop, const size_t i) const noexcept {
+    return getEarliestArrivalTime(stop, i) < never;
+  }
+
+  // Earliest arrival time at the stop when departing at the i-th departure
+  // time.
+  inline int getEarliestArrivalTime(const StopId stop,
+                                    const size_t i) const noexcept {
+    AssertMsg(i < numberOfLanes, "Departure index " << i << " is invalid!");
+    return arrivalTimes[stop * stride + i];
+  }
+
+  inline std::vector<int> getEarliestArrivalTimes(
+      const StopId stop) const noexcept {
+    const int* times = &arrivalTimes[stop * stride];
+    return std::vector<int>(times, times + numberOfLanes);
+  }
+
+  inline const Profiler& getProfiler() const noexcept { return profiler; }
+
+ private:
+  inline void clear(const std::vector<int>& departures) noexcept {
+    sourceStop = noStop;
+    departureTimes = departures;
+    numberOfLanes = departures.size();
+    stride = ((numberOfLanes + VectorSize - 1) / VectorSize) * VectorSize;
+    arrivalTimes.assign(data.numberOfStops() * stride, never);
+    Vector::fill(reachedLanes, uint32_t(0));
+  }
+
+  inline int* arrivalTimesOf(const StopId stop) noexcept {
+    return &arrivalTimes[stop * stride];
+  }
+
+  inline ConnectionId firstReachableConnection(
+      const int departureTime) const noexcept {
+    return ConnectionId(
+        Vector::lowerBound(data.connections, departureTime,
+                           [](const Connection& connection, const int time) {
+                             return connection.departureTime < time;
+                           }));
+  }
+
+  inline void scanConnections(const ConnectionId begin,
+                              const ConnectionId end) noexcept {
+    for (ConnectionId i = begin; i < end; i++) {
+      const Connection& connection = data.connections[i];
+      const int* times = arrivalTimesOf(connection.departureStopId);
+      const int latestArrival =
+          connection.departureTime -
+          data.minTransferTime(connection.departureStopId);
+      uint32_t& lanes = reachedLanes[connection.tripId];
+      if (lanes < numberOfLanes && times[lanes] <= latestArrival) {
+        lanes = countAtMost(times, latestArrival);
+      }
+      if (lanes == 0) continue;
+      profiler.countMetric(METRIC_CONNECTIONS);
+      // The lanes improved by the connection are the reached lanes that
+      // arrive later than the connection, i.e., a suffix of them.
+      int* arrivalStopTimes = arrivalTimesOf(connection.arrivalStopId);
+      const uint32_t firstImproved =
+          countAtMost(arrivalStopTimes, connection.arrivalTime);
+      if (firstImproved >= lanes) continue;
+      profiler.countMetric(METRIC_STOPS_BY_TRIP);
+      minRange(arrivalStopTimes, connection.arrivalTime, firstImproved,
+               lanes);
+      relaxEdges(connection.arrivalStopId, connection.arrivalTime,
+                 firstImproved, lanes);
+    }
+  }
+
+  inline void relaxEdges(const StopId stop, const int time,
+                         const uint32_t firstLane,
+                         const uint32_t lastLane) noexcept {
+    for (const Edge edge : data.transferGraph.edgesFrom(stop)) {
+      profiler.countMetric(METRIC_EDGES);
+      const StopId toStop = StopId(data.transferGraph.get(ToVertex, edge));
+      minRange(arrivalTimesOf(toStop),
+               time + data.transferGraph.get(TravelTime, edge), firstLane,
+               lastLane);
+    }
+  }
+
+  inline void relaxInitialEdges(const StopId stop) noexcept {
+    for (const Edge edge : data.transferGraph.edgesFrom(stop)) {
+      profiler.countMetric(METRIC_EDGES);
+      const StopId toStop = StopId(data.transferGraph.get(ToVertex, edge));
+      const int travelTime = data.transferGraph.get(TravelTime, edge);
+      int* times = arrivalTimesOf(toStop);
+      for (size_t i = 0; i < numberOfLanes; i++) {
+        times[i] = std::min(times[i], departureTimes[i] + travelTime);
+      }
+    }
+  }
+
+  // Number of lanes with a value <= bound. Since the arrival times are
+  // non-decreasing, these are the first lanes.
+  inline uint32_t countAtMost(const int* values,
+                              const int bound) const noexcept {
+    uint32_t count = 0;
+#ifdef USE_SIMD
+    const __m256i limit = _mm256_set1_epi32(bound);
+    for (size_t i = 0; i < stride; i += VectorSize) {
+      const __m256i greater = _mm256_cmpgt_epi32(
+          _mm256_load_si256(reinterpret_cast<const __m256i*>(values + i)),
+          limit);
+      const uint32_t mask =
+          uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(greater)));
+      if (mask) return count + std::countr_zero(mask);
+      count += VectorSize;
+    }
+#else
+    while (count < stride && values[count] <= bound) count++;
+#endif
+    return count;
+  }
+
+  // Sets values[i] = min(values[i], time) for all lanes i in [begin, end).
+  inline void minRange(int* values, const int time, const uint32_t begin,
+                       const uint32_t end) const noexcept {
+#ifdef USE_SIMD
+    const __m256i times = _mm256_set1_epi32(time);
+    const __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (uint32_t i = begin - (begin % VectorSize); i < end; i += VectorSize) {
+      __m256i* target = reinterpret_cast<__m256i*>(values + i);
+      const __m256i lane = _mm256_add_epi32(index, _mm256_set1_epi32(int(i)));
+      const __m256i active = _mm256_and_si256(
+          _mm256_cmpgt_epi32(lane, _mm256_set1_epi32(int(begin) - 1)),
+          _mm256_cmpgt_epi32(_mm256_set1_epi32(int(end)), lane));
+      const __m256i old = _mm256_load_si256(target);
+      _mm256_store_si256(
+          target,
+          _mm256_blendv_epi8(old, _mm256_min_epi32(old, times), active));
+    }
+#else
+    for (uint32_t i = begin; i < end; i++) {
+      values[i] = std::min(values[i], time);
+    }
+#endif
+  }
+
+ private:
+  const Data& data;
+
+  StopId sourceStop;
+  std::vector<int> departureTimes;
+  size_t numberOfLanes;
+  size_t stride;
+
+  ArrivalTimes arrivalTimes;
+  std::vector<uint32_t> reachedLanes;
+
+  Profiler profiler;
+};
+}  // namespace CSA
@@ -0,0 +1,213 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+ Copyright (c) 2019-2022 KIT ITI Algorithmics Group
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <omp.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../../DataStructures/PTL/Data.h"
+#include "../../Helpers/Console/Progress.h"
+#include "../../Helpers/MultiThreading.h"
+#include "../../Helpers/Timer.h"
+
+namespace PTL {
+
+// Pruned landmark labeling for reachability on the (acyclic) time expanded
+// graph. The hubs are processed in the given order, and the search of a hub
+// stops at every vertex whose reachability is already answered by the labels
+// of the hubs before. To run in parallel, the hubs are processed in batches:
+// the searches of a batch only see the labels of the previous batches, and the
+// new label entries are merged after the batch. This may add some redundant
+// hubs (the searches of one batch do not prune each other), but every query
+// answer stays correct. The batches start with a single hub and double in size,
+// since the first hubs prune the most. The batch boundaries do not depend on
+// the number of threads, hence neither do the labels.
+class Builder {
+ public:
+  static constexpr size_t DefaultMaxBatchSize = 256;
+
+ private:
+  struct Worker {
+    Worker(const size_t numberOfVertices = 0)
+        : seen(numberOfVertices, 0),
+          seenStamp(0),
+          marked(numberOfVertices, 0),
+          markStamp(0) {}
+
+    std::vector<uint32_t> seen;
+    uint32_t seenStamp;
+    std::vector<uint32_t> marked;
+    uint32_t markStamp;
+    std::vector<Vertex> queue;
+
+    // (vertex, hub) pairs found in the current batch
+    std::vector<std::pair<Vertex, Vertex>> newFwdHubs;
+    std::vector<std::pair<Vertex, Vertex>> newBwdHubs;
+  };
+
+ public:
+  Builder(Data &data, const int numberOfThreads = 1,
+          const int pinMultiplier = 1,
+          const size_t maxBatchSize = DefaultMaxBatchSize)
+      : data(data),
+        graph(data.teData.timeExpandedGraph),
+        reverseGraph(data.teData.timeExpandedGraph),
+        numberOfThreads(numberOfThreads),
+        pinMultiplier(pinMultiplier),
+        maxBatchSize(maxBatchSize ? maxBatchSize : DefaultMaxBatchSize),
+        workers(numberOfThreads, Worker(graph.numVertices())),
+        buildTime(0) {
+    reverseGraph.revert();
+  }
+
+  // order[0] is the most important vertex, see TE::Data::getOrderForAkiba
+  inline void run(const std::vector<size_t> &order,
+                  const bool verbose = true) noexcept {
+    AssertMsg(order.size() == graph.numVertices(),
+              "The order does not contain every vertex!");
+    Timer timer;
+    const size_t n = graph.numVertices();
+    data.fwdVertices.assign(n, {});
+    data.bwdVertices.assign(n, {});
+    omp_set_num_threads(numberOfThreads);
+    const int numCores = numberOfCores();
+
+    Progress progress(n, verbose);
+    size_t begin = 0;
+    while (begin < n) {
+      const size_t batchSize =
+          std::min({std::max<size_t>(begin, 1), maxBatchSize, n - begin});
+#pragma omp parallel
+      {
+        const int threadId = omp_get_thread_num();
+        pinThreadToCoreId((threadId * pinMultiplier) % numCores);
+        Worker &worker = workers[threadId];
+
+#pragma omp for schedule(dynamic, 1)
+        for (size_t i = begin; i < begin + batchSize; ++i) {
+          const Vertex hub(order[i]);
+          forwardSearch(worker, hub);
+          backwardSearch(worker, hub);
+        }
+      }
+      mergeNewHubs();
+      begin += batchSize;
+      progress.iterateTo(begin);
+    }
+    progress.finished();
+
+    data.buildFlatLabels();
+    buildTime = timer.elapsedMilliseconds();
+  }
+
+  // Time (in milliseconds) of the last run
+  inline double getBuildTime() const noexcept { return buildTime; }
+
+  inline size_t getNumberOfLabelEntries() const noexcept {
+    return data.numberOfLabelEntries();
+  }
+
+  inline long long getLabelByteSize() const noexcept {
+    return data.labelByteSize();
+  }
+
+ private:
+  // Adds hub to the backward labels of all vertices it reaches (and whose
+  // reachability is not known yet)
+  inline void forwardSearch(Worker &worker, const Vertex hub) noexcept {
+    ++worker.markStamp;
+    for (const Vertex x : data.fwdVertices[hub]) {
+      worker.marked[x] = worker.markStamp;
+    }
+    search(worker, graph, hub, data.bwdVertices, worker.newBwdHubs);
+  }
+
+  // Adds hub to the forward labels of all vertices reaching it
+  inline void backwardSearch(Worker &worker, const Vertex hub) noexcept {
+    ++worker.markStamp;
+    for (const Vertex x : data.bwdVertices[hub]) {
+      worker.marked[x] = worker.markStamp;
+    }
+    search(worker, reverseGraph, hub, data.fwdVertices, worker.newFwdHubs);
+  }
+
+  // BFS from the hub, a vertex is pruned if one of its labels contains a
+  // marked hub
+  inline void search(Worker &worker, const TimeExpandedGraph &searchGraph,
+                     const Vertex hub,
+                     const std::vector<std::vector<Vertex>> &labels,
+                     std::vector<std::pair<Vertex, Vertex>> &newHubs) noexcept {
+    ++worker.seenStamp;
+    worker.queue.clear();
+    worker.queue.emplace_back(hub);
+    worker.seen[hub] = worker.seenStamp;
+    for (size_t i = 0; i < worker.queue.size(); ++i) {
+      const Vertex v = worker.queue[i];
+      const bool covered =
+          std::any_of(labels[v].begin(), labels[v].end(), [&](const Vertex x) {
+            return worker.marked[x] == worker.markStamp;
+          });
+      if (covered) continue;
+      newHubs.emplace_back(v, hub);
+      for (const Edge edge : searchGraph.edgesFrom(v)) {
+        const Vertex w = searchGraph.get(ToVertex, edge);
+        if (worker.seen[w] == worker.seenStamp) continue;
+        worker.seen[w] = worker.seenStamp;
+        worker.queue.emplace_back(w);
+      }
+    }
+  }
+
+  inline void mergeNewHubs() noexcept {
+    for (Worker &worker : workers) {
+      for (const auto &[v, hub] : worker.newFwdHubs) {
+        data.fwdVertices[v].emplace_back(hub);
+      }
+      for (const auto &[v, hub] : worker.newBwdHubs) {
+        data.bwdVertices[v].emplace_back(hub);
+      }
+      worker.newFwdHubs.clear();
+      worker.newBwdHubs.clear();
+    }
+  }
+
+ private:
+  Data &data;
+  const TimeExpandedGraph &graph;
+  TimeExpandedGraph reverseGraph;
+
+  const int numberOfThreads;
+  const int pinMultiplier;
+  const size_t maxBatchSize;
+
+  std::vector<Worker> workers;
+  double buildTime;
+};
+
+}  // namespace PTL
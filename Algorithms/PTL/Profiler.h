@@ -34,17 +34,14 @@ namespace PTL {
 
 typedef enum {
   PHASE_FIND_FIRST_VERTEX,
-  PHASE_INSERT_HASH,
   PHASE_RUN,
   NUM_PHASES
 } Phase;
 
 constexpr const char* PhaseNames[] = {"Find first reachable Vertex  ",
-                                      "Building Hash-Hubs           ",
                                       "Run Query                    "};
 
 typedef enum {
-  METRIC_INSERTED_HUBS,
   METRIC_CHECK_ARR_EVENTS,
   METRIC_CHECK_HUBS,
   METRIC_FOUND_SOLUTIONS,
@@ -52,8 +49,8 @@ typedef enum {
 } Metric;
 
 constexpr const char* MetricNames[] = {
-    "# Inserted Hubs              ", "# Arrival Events             ",
-    "# Check Hubs                 ", "# Solutions                  "};
+    "# Arrival Events             ", "# Check Hubs                 ",
+    "# Solutions                  "};
 
 class NoProfiler {
  public:
@@ -25,6 +25,8 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <span>
 #include <vector>
 
 #include "../../DataStructures/PTL/Data.h"
@@ -38,10 +40,9 @@ class Query {
   using Profiler = PROFILER;
 
   Query(Data& data) : data(data) {
-    profiler.registerPhases(
-        {PHASE_FIND_FIRST_VERTEX, PHASE_INSERT_HASH, PHASE_RUN});
-    profiler.registerMetrics({METRIC_INSERTED_HUBS, METRIC_CHECK_ARR_EVENTS,
-                              METRIC_CHECK_HUBS, METRIC_FOUND_SOLUTIONS});
+    profiler.registerPhases({PHASE_FIND_FIRST_VERTEX, PHASE_RUN});
+    profiler.registerMetrics(
+        {METRIC_CHECK_ARR_EVENTS, METRIC_CHECK_HUBS, METRIC_FOUND_SOLUTIONS});
   };
 
   template <bool BINARY = true>
@@ -64,13 +65,12 @@ class Query {
 
     profiler.startPhase();
     prepareSet();
-    profiler.donePhase(PHASE_INSERT_HASH);
 
-    profiler.startPhase();
-
-    const auto& arrEvents = data.teData.getArrivalsOfStop(target);
+    const std::span<const Vertex> arrEvents =
+        data.teData.getArrivalsOfStop(target);
 
-    size_t left = getIndexOfFirstEventAfterTime(arrEvents, departureTime);
+    size_t left = getIndexOfFirstEventAfterTime(
+        data.teData.getArrivalTimesOfStop(target), departureTime);
 
     int finalTime = -1;
 
@@ -109,24 +109,50 @@ class Query {
     AssertMsg(data.teData.isEvent(startingVertex),
               "First reachable node is not valid!");
 
-    hash.clear();
+    sourceHubs = data.getFwdHubs(startingVertex);
+  }
 
-    for (auto& fwdHub : data.getFwdHubs(startingVertex)) {
-      hash.insert(fwdHub);
+  // Checks whether the two sorted hub lists share a hub. Lists of similar size
+  // are merged, otherwise every hub of the shorter list is searched in the
+  // longer one by galloping.
+  inline bool hasCommonHub(std::span<const Vertex> a,
+                           std::span<const Vertex> b) noexcept {
+    if (a.empty() || b.empty()) return false;
+    if (a.size() > b.size()) std::swap(a, b);
+    if (a.back() < b.front() || b.back() < a.front()) return false;
+
+    if (b.size() > GallopingFactor * a.size()) {
+      size_t j = 0;
+      for (const Vertex x : a) {
+        profiler.countMetric(METRIC_CHECK_HUBS);
+        size_t step = 1;
+        while (j + step < b.size() && b[j + step] < x) step <<= 1;
+        const auto end = b.begin() + std::min(j + step + 1, b.size());
+        j = std::lower_bound(b.begin() + j + (step >> 1), end, x) - b.begin();
+        if (j == b.size()) return false;
+        if (b[j] == x) return true;
+      }
+      return false;
+    }
 
-      profiler.countMetric(METRIC_INSERTED_HUBS);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+      profiler.countMetric(METRIC_CHECK_HUBS);
+      const Vertex x = a[i];
+      const Vertex y = b[j];
+      if (x == y) return true;
+      i += (x < y);
+      j += (y < x);
     }
+    return false;
   }
 
-  inline size_t getIndexOfFirstEventAfterTime(const auto& arrEvents,
-                                              const int time) noexcept {
-    auto it = std::lower_bound(
-        arrEvents.begin(), arrEvents.end(), time,
-        [&](const size_t event, const int time) {
-          return data.teData.getTimeOfVertex(Vertex(event)) < time;
-        });
+  inline size_t getIndexOfFirstEventAfterTime(
+      const std::span<const int> arrTimes, const int time) noexcept {
+    auto it = std::lower_bound(arrTimes.begin(), arrTimes.end(), time);
 
-    return std::distance(arrEvents.begin(), it);
+    return std::distance(arrTimes.begin(), it);
   }
 
   inline int scanHubs(const auto& arrEvents, const size_t left = 0) noexcept {
@@ -137,15 +163,10 @@ class Query {
 
       profiler.countMetric(METRIC_CHECK_ARR_EVENTS);
 
-      const auto& bwdLabels = data.getBwdHubs(Vertex(arrEventAtTarget));
-
-      for (const auto& hub : bwdLabels) {
-        profiler.countMetric(METRIC_CHECK_HUBS);
-
-        if (hash.find(hub) != hash.end()) [[unlikely]] {
-          profiler.countMetric(METRIC_FOUND_SOLUTIONS);
-          return arrTime;
-        }
+      if (hasCommonHub(sourceHubs, data.getBwdHubs(Vertex(arrEventAtTarget))))
+          [[unlikely]] {
+        profiler.countMetric(METRIC_FOUND_SOLUTIONS);
+        return arrTime;
       }
     }
     return -1;
@@ -172,17 +193,8 @@ class Query {
 
       profiler.countMetric(METRIC_CHECK_ARR_EVENTS);
 
-      const auto& bwdLabels = data.getBwdHubs(Vertex(arrEventAtTarget));
-
-      for (const auto& hub : bwdLabels) {
-        profiler.countMetric(METRIC_CHECK_HUBS);
-
-        found = (hash.find(hub) != hash.end());
-
-        if (found) {
-          break;
-        }
-      }
+      found =
+          hasCommonHub(sourceHubs, data.getBwdHubs(Vertex(arrEventAtTarget)));
       if (found) {
         j = mid - 1;
       } else {
@@ -201,9 +213,13 @@ class Query {
 
   inline const Profiler& getProfiler() const noexcept { return profiler; }
 
+  // Galloping is used if one hub list is longer than this factor times the
+  // other one
+  static constexpr size_t GallopingFactor = 16;
+
   Data& data;
   Vertex startingVertex;
-  std::set<Vertex> hash;
+  std::span<const Vertex> sourceHubs;
   Profiler profiler;
 };
 }  // namespace PTL
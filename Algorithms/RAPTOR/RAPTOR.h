@@ -33,13 +33,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../DataStructures/Container/Set.h"
 #include "../../DataStructures/RAPTOR/Data.h"
 #include "../../DataStructures/RAPTOR/Entities/EarliestArrivalTime.h"
+#include "../../DataStructures/RAPTOR/Entities/StopMajorRoutes.h"
 #include "Profiler.h"
 
 namespace RAPTOR {
 
 template <bool TARGET_PRUNING, typename PROFILER = NoProfiler,
           bool TRANSITIVE = true, bool USE_MIN_TRANSFER_TIMES = false,
-          bool PREVENT_DIRECT_WALKING = false>
+          bool PREVENT_DIRECT_WALKING = false,
+          bool STOP_MAJOR_ROUTES = false>
 class RAPTOR {
  public:
   static constexpr bool TargetPruning = TARGET_PRUNING;
@@ -47,12 +49,15 @@ class RAPTOR {
   static constexpr bool Transitive = TRANSITIVE;
   static constexpr bool UseMinTransferTimes = USE_MIN_TRANSFER_TIMES;
   static constexpr bool PreventDirectWalking = PREVENT_DIRECT_WALKING;
+  // Scan routes on a stop-major copy of the stop event times (see
+  // StopMajorRoutes) instead of the trip-major stop events of the data.
+  static constexpr bool StopMajorRouteStorage = STOP_MAJOR_ROUTES;
   static constexpr bool SeparateRouteAndTransferEntries =
       !Transitive | UseMinTransferTimes | PreventDirectWalking;
   static constexpr int RoundFactor = SeparateRouteAndTransferEntries ? 2 : 1;
   using ArrivalTime = EarliestArrivalTime<SeparateRouteAndTransferEntries>;
   using Type = RAPTOR<TargetPruning, Profiler, Transitive, UseMinTransferTimes,
-                      PreventDirectWalking>;
+                      PreventDirectWalking, StopMajorRouteStorage>;
   using InitialTransferGraph = TransferGraph;
   using SourceType = StopId;
 
@@ -87,6 +92,9 @@ class RAPTOR {
         sourceDepartureTime(never),
         walkingDistance(INFTY),
         profiler(profilerTemplate) {
+    if constexpr (StopMajorRouteStorage) {
+      stopMajorRoutes = StopMajorRoutes(data);
+    }
     if constexpr (UseMinTransferTimes) {
       AssertMsg(!data.hasImplicitBufferTimes(),
                 "Either min transfer times have to be used OR departure buffer "
@@ -301,6 +309,10 @@ class RAPTOR {
   }
 
   inline void scanRoutes() noexcept {
+    if constexpr (StopMajorRouteStorage) {
+      scanStopMajorRoutes();
+      return;
+    }
     stopsUpdatedByRoute.clear();
     auto& collectedRoutes = routesServingUpdatedStops.getKeys();
     for (size_t r(0); r < collectedRoutes.size(); ++r) {
@@ -355,6 +367,56 @@ class RAPTOR {
     }
   }
 
+  inline void scanStopMajorRoutes() noexcept {
+    stopsUpdatedByRoute.clear();
+    auto& collectedRoutes = routesServingUpdatedStops.getKeys();
+    for (size_t r(0); r < collectedRoutes.size(); ++r) {
+      const RouteId route = collectedRoutes[r];
+
+#ifdef ENABLE_PREFETCH
+      if (r + 4 < collectedRoutes.size()) {
+        const RouteId nextRoute = collectedRoutes[r + 4];
+        __builtin_prefetch(data.stopArrayOfRoute(nextRoute));
+        __builtin_prefetch(stopMajorRoutes.departureTimes(
+            nextRoute, routesServingUpdatedStops[nextRoute]));
+      }
+#endif
+
+      profiler.countMetric(METRIC_ROUTES);
+      StopIndex stopIndex = routesServingUpdatedStops[route];
+      const size_t tripSize = data.numberOfStopsInRoute(route);
+      AssertMsg(stopIndex < tripSize - 1,
+                "Cannot scan a route starting at/after the last stop (Route: "
+                    << route << ", StopIndex: " << stopIndex
+                    << ", TripSize: " << tripSize << ")!");
+
+      const StopId* stops = data.stopArrayOfRoute(route);
+      uint32_t trip = data.numberOfTripsInRoute(route) - 1;
+      StopId stop = stops[stopIndex];
+      StopIndex parentIndex = stopIndex;
+      while (stopIndex < tripSize - 1) {
+        const uint32_t earliestTrip = stopMajorRoutes.earliestTrip(
+            route, stopIndex, trip, previousRound()[stop].arrivalTime);
+        if (earliestTrip != trip) {
+          trip = earliestTrip;
+          parentIndex = stopIndex;
+        }
+        stopIndex++;
+        stop = stops[stopIndex];
+        profiler.countMetric(METRIC_ROUTE_SEGMENTS);
+        if (arrivalByRoute(
+                stop, stopMajorRoutes.arrivalTimes(route, stopIndex)[trip])) {
+          EarliestArrivalLabel& label = currentRound()[stop];
+          label.parent = stops[parentIndex];
+          label.parentDepartureTime =
+              stopMajorRoutes.departureTimes(route, parentIndex)[trip];
+          label.usesRoute = true;
+          label.routeId = route;
+        }
+      }
+    }
+  }
+
   template <bool INITIAL_TRANSFERS = false>
   inline void relaxTransfers() noexcept {
     stopsUpdatedByTransfer.clear();
@@ -519,6 +581,7 @@ class RAPTOR {
 
  private:
   const Data& data;
+  StopMajorRoutes stopMajorRoutes;
 
   std::vector<Round> rounds;
 
@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <algorithm>
 
+#include "../../../DataStructures/Container/ShortcutSink.h"
 #include "../../../DataStructures/RAPTOR/Data.h"
 #include "../../../Helpers/Console/Progress.h"
 #include "../../../Helpers/MultiThreading.h"
@@ -65,15 +66,16 @@ class Builder {
                 << " threads." << std::endl;
 
     size_t optimalCandidates = 0;
+    ShortcutSink sink(data.numberOfStops(), threadPinning.numberOfThreads);
     Progress progress(data.numberOfStops(), verbose);
     omp_set_num_threads(threadPinning.numberOfThreads);
 #pragma omp parallel
     {
       threadPinning.pinThread();
 
-      DynamicTransferGraph localShortcutGraph = shortcutGraph;
+      ShortcutSink::Shard& shard = sink.shard(omp_get_thread_num());
       ShortcutSearch<Debug, CountOptimalCandidates, IgnoreIsolatedCandidates>
-          shortcutSearch(data, localShortcutGraph, witnessTransferLimit);
+          shortcutSearch(data, shard, witnessTransferLimit);
 
 #pragma omp for schedule(dynamic)
       for (size_t i = 0; i < data.numberOfStops(); i++) {
@@ -81,34 +83,13 @@ class Builder {
         progress++;
       }
 
-#pragma omp critical
-      {
-        if constexpr (CountOptimalCandidates) {
-          optimalCandidates += shortcutSearch.getNumberOfOptimalCandidates();
-        }
-        for (const Vertex from : shortcutGraph.vertices()) {
-          for (const Edge edge : localShortcutGraph.edgesFrom(from)) {
-            const Vertex to = localShortcutGraph.get(ToVertex, edge);
-            if (!shortcutGraph.hasEdge(from, to)) {
-              shortcutGraph.addEdge(from, to).set(
-                  TravelTime, localShortcutGraph.get(TravelTime, edge));
-            } else {
-              AssertMsg(shortcutGraph.get(TravelTime,
-                                          shortcutGraph.findEdge(from, to)) ==
-                            localShortcutGraph.get(TravelTime, edge),
-                        "Edge from "
-                            << from << " to " << to
-                            << " has inconclusive travel time ("
-                            << shortcutGraph.get(
-                                   TravelTime, shortcutGraph.findEdge(from, to))
-                            << ", " << localShortcutGraph.get(TravelTime, edge)
-                            << ")");
-            }
-          }
-        }
+      if constexpr (CountOptimalCandidates) {
+#pragma omp atomic
+        optimalCandidates += shortcutSearch.getNumberOfOptimalCandidates();
       }
     }
     progress.finished();
+    sink.build(shortcutGraph, verbose);
     if constexpr (CountOptimalCandidates) {
       std::cout << "#Optimal candidates: "
                 << String::prettyInt(optimalCandidates) << std::endl;
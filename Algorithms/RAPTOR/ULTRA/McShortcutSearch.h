@@ -32,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/Container/ExternalKHeap.h"
 #include "../../../DataStructures/Container/Map.h"
 #include "../../../DataStructures/Container/Set.h"
+#include "../../../DataStructures/Container/ShortcutSink.h"
 #include "../../../DataStructures/RAPTOR/Data.h"
 #include "../../../Helpers/Helpers.h"
 #include "../../../Helpers/Meta.h"
@@ -503,11 +504,11 @@ class McShortcutSearch {
   };
 
  public:
-  McShortcutSearch(const Data& data, DynamicTransferGraph& shortcutGraph,
+  McShortcutSearch(const Data& data, ShortcutSink::Shard& shortcutShard,
                    const int intermediateWitnessTransferLimit,
                    const int finalWitnessTransferLimit)
       : data(data),
-        shortcutGraph(shortcutGraph),
+        shortcutShard(shortcutShard),
         stationOfStop(data.numberOfStops()),
         sourceStation(),
         sourceDepartureTime(0),
@@ -547,23 +548,8 @@ class McShortcutSearch {
          collectDepartures(minTime, maxTime)) {
       runForDepartureTime(label);
       for (const Shortcut& shortcut : shortcuts) {
-        if (!shortcutGraph.hasEdge(shortcut.origin, shortcut.destination)) {
-          shortcutGraph.addEdge(shortcut.origin, shortcut.destination)
-              .set(TravelTime, shortcut.travelTime);
-        } else {
-          AssertMsg(
-              shortcutGraph.get(TravelTime,
-                                shortcutGraph.findEdge(shortcut.origin,
-                                                       shortcut.destination)) ==
-                  shortcut.travelTime,
-              "Edge from " << shortcut.origin << " to " << shortcut.destination
-                           << " has inconclusive travel time ("
-                           << shortcutGraph.get(
-                                  TravelTime,
-                                  shortcutGraph.findEdge(shortcut.origin,
-                                                         shortcut.destination))
-                           << ", " << shortcut.travelTime << ")");
-        }
+        shortcutShard.insert(shortcut.origin, shortcut.destination,
+                             shortcut.travelTime);
       }
     }
   }
@@ -1070,7 +1056,7 @@ class McShortcutSearch {
                               const StopEventId finalStopEvent) noexcept {
     const bool isCandidate =
         routeLabel.isCandidate() && (routeLabel.shortcutOrigin != parentStop) &&
-        !shortcutGraph.hasEdge(routeLabel.shortcutOrigin, parentStop);
+        !shortcutShard.contains(routeLabel.shortcutOrigin, parentStop);
     if (isCandidate) {
       label.finalStopEvent = finalStopEvent;
     }
@@ -1202,7 +1188,7 @@ class McShortcutSearch {
 
  private:
   const Data& data;
-  DynamicTransferGraph& shortcutGraph;
+  ShortcutSink::Shard& shortcutShard;
   std::vector<Station> stationOfStop;
 
   Station sourceStation;
@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <algorithm>
 
+#include "../../../DataStructures/Container/ShortcutSink.h"
 #include "../../../DataStructures/RAPTOR/Data.h"
 #include "../../../Helpers/Console/Progress.h"
 #include "../../../Helpers/MultiThreading.h"
@@ -63,15 +64,16 @@ class MultimodalMcBuilder {
       std::cout << "Computing shortcuts with " << threadPinning.numberOfThreads
                 << " threads." << std::endl;
 
+    ShortcutSink sink(data.numberOfStops(), threadPinning.numberOfThreads);
     Progress progress(data.numberOfStops(), verbose);
     omp_set_num_threads(threadPinning.numberOfThreads);
 #pragma omp parallel
     {
       threadPinning.pinThread();
 
-      DynamicTransferGraph localShortcutGraph = shortcutGraph;
+      ShortcutSink::Shard& shard = sink.shard(omp_get_thread_num());
       MultimodalMcShortcutSearch<Debug, TimeFactor> shortcutSearch(
-          data, transitiveTransferGraph, localShortcutGraph,
+          data, transitiveTransferGraph, shard,
           intermediateWitnessTransferLimit, finalWitnessTransferLimit);
 
 #pragma omp for schedule(dynamic)
@@ -79,32 +81,9 @@ class MultimodalMcBuilder {
         shortcutSearch.run(StopId(i), minDepartureTime, maxDepartureTime);
         progress++;
       }
-
-#pragma omp critical
-      {
-        for (const Vertex from : shortcutGraph.vertices()) {
-          for (const Edge edge : localShortcutGraph.edgesFrom(from)) {
-            const Vertex to = localShortcutGraph.get(ToVertex, edge);
-            if (!shortcutGraph.hasEdge(from, to)) {
-              shortcutGraph.addEdge(from, to).set(
-                  TravelTime, localShortcutGraph.get(TravelTime, edge));
-            } else {
-              AssertMsg(shortcutGraph.get(TravelTime,
-                                          shortcutGraph.findEdge(from, to)) ==
-                            localShortcutGraph.get(TravelTime, edge),
-                        "Edge from "
-                            << from << " to " << to
-                            << " has inconclusive travel time ("
-                            << shortcutGraph.get(
-                                   TravelTime, shortcutGraph.findEdge(from, to))
-                            << ", " << localShortcutGraph.get(TravelTime, edge)
-                            << ")");
-            }
-          }
-        }
-      }
     }
     progress.finished();
+    sink.build(shortcutGraph, verbose);
   }
 
   inline const DynamicTransferGraph& getShortcutGraph() const noexcept {
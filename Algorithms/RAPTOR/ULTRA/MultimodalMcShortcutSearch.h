@@ -32,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/Container/ExternalKHeap.h"
 #include "../../../DataStructures/Container/Map.h"
 #include "../../../DataStructures/Container/Set.h"
+#include "../../../DataStructures/Container/ShortcutSink.h"
 #include "../../../DataStructures/RAPTOR/Data.h"
 #include "../../../Helpers/Helpers.h"
 #include "../../../Helpers/Meta.h"
@@ -553,12 +554,12 @@ class MultimodalMcShortcutSearch {
  public:
   MultimodalMcShortcutSearch(const Data& data,
                              const TransferGraph& transitiveTransferGraph,
-                             DynamicTransferGraph& shortcutGraph,
+                             ShortcutSink::Shard& shortcutShard,
                              const int intermediateWitnessTransferLimit,
                              const int finalWitnessTransferLimit)
       : data(data),
         transitiveTransferGraph(transitiveTransferGraph),
-        shortcutGraph(shortcutGraph),
+        shortcutShard(shortcutShard),
         stationOfStop(data.numberOfStops()),
         sourceStation(),
         sourceDepartureTime(0),
@@ -599,23 +600,8 @@ class MultimodalMcShortcutSearch {
          collectDepartures(minTime, maxTime)) {
       runForDepartureTime(label);
       for (const Shortcut& shortcut : shortcuts) {
-        if (!shortcutGraph.hasEdge(shortcut.origin, shortcut.destination)) {
-          shortcutGraph.addEdge(shortcut.origin, shortcut.destination)
-              .set(TravelTime, shortcut.travelTime);
-        } else {
-          AssertMsg(
-              shortcutGraph.get(TravelTime,
-                                shortcutGraph.findEdge(shortcut.origin,
-                                                       shortcut.destination)) ==
-                  shortcut.travelTime,
-              "Edge from " << shortcut.origin << " to " << shortcut.destination
-                           << " has inconclusive travel time ("
-                           << shortcutGraph.get(
-                                  TravelTime,
-                                  shortcutGraph.findEdge(shortcut.origin,
-                                                         shortcut.destination))
-                           << ", " << shortcut.travelTime << ")");
-        }
+        shortcutShard.insert(shortcut.origin, shortcut.destination,
+                             shortcut.travelTime);
       }
     }
   }
@@ -1161,7 +1147,7 @@ class MultimodalMcShortcutSearch {
                               const StopEventId finalStopEvent) noexcept {
     const bool isCandidate =
         routeLabel.isCandidate() && (routeLabel.shortcutOrigin != parentStop) &&
-        !shortcutGraph.hasEdge(routeLabel.shortcutOrigin, parentStop);
+        !shortcutShard.contains(routeLabel.shortcutOrigin, parentStop);
     if (isCandidate) {
       label.finalStopEvent = finalStopEvent;
     }
@@ -1330,7 +1316,7 @@ class MultimodalMcShortcutSearch {
  private:
   const Data& data;
   const TransferGraph& transitiveTransferGraph;
-  DynamicTransferGraph& shortcutGraph;
+  ShortcutSink::Shard& shortcutShard;
   std::vector<Station> stationOfStop;
 
   Station sourceStation;
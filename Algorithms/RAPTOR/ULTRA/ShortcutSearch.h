@@ -32,6 +32,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/Container/ExternalKHeap.h"
 #include "../../../DataStructures/Container/Map.h"
 #include "../../../DataStructures/Container/Set.h"
+#include "../../../DataStructures/Container/ShortcutSink.h"
 #include "../../../DataStructures/RAPTOR/Data.h"
 #include "../../../DataStructures/RAPTOR/Entities/Shortcut.h"
 #include "../../../Helpers/Helpers.h"
@@ -101,10 +102,10 @@ class ShortcutSearch {
   };
 
  public:
-  ShortcutSearch(const Data& data, DynamicTransferGraph& shortcutGraph,
+  ShortcutSearch(const Data& data, ShortcutSink::Shard& shortcutShard,
                  const int witnessTransferLimit)
       : data(data),
-        shortcutGraph(shortcutGraph),
+        shortcutShard(shortcutShard),
         stationOfStop(data.numberOfStops()),
         sourceStation(),
         sourceDepartureTime(0),
@@ -146,23 +147,8 @@ class ShortcutSearch {
         optimalCandidates += shortcuts.size();
       }
       for (const Shortcut& shortcut : shortcuts) {
-        if (!shortcutGraph.hasEdge(shortcut.origin, shortcut.destination)) {
-          shortcutGraph.addEdge(shortcut.origin, shortcut.destination)
-              .set(TravelTime, shortcut.travelTime);
-        } else {
-          AssertMsg(
-              shortcutGraph.get(TravelTime,
-                                shortcutGraph.findEdge(shortcut.origin,
-                                                       shortcut.destination)) ==
-                  shortcut.travelTime,
-              "Edge from " << shortcut.origin << " to " << shortcut.destination
-                           << " has inconclusive travel time ("
-                           << shortcutGraph.get(
-                                  TravelTime,
-                                  shortcutGraph.findEdge(shortcut.origin,
-                                                         shortcut.destination))
-                           << ", " << shortcut.travelTime << ")");
-        }
+        shortcutShard.insert(shortcut.origin, shortcut.destination,
+                             shortcut.travelTime);
       }
     }
   }
@@ -691,7 +677,7 @@ class ShortcutSearch {
 
   inline bool shortcutAlreadyExists(const StopId parent) const noexcept {
     if constexpr (!CountOptimalCandidates) {
-      return shortcutGraph.hasEdge(oneTripTransferParent[parent], parent);
+      return shortcutShard.contains(oneTripTransferParent[parent], parent);
     } else {
       suppressUnusedParameterWarning(parent);
       return false;
@@ -778,7 +764,7 @@ class ShortcutSearch {
 
  private:
   const Data& data;
-  DynamicTransferGraph& shortcutGraph;
+  ShortcutSink::Shard& shortcutShard;
   std::vector<Station> stationOfStop;
 
   Station sourceStation;
@@ -72,11 +72,9 @@ class EADijkstra {
   };
 
  public:
-  EADijkstra(
-      const GRAPH& graph,
-      const std::vector<std::vector<std::pair<uint32_t, uint32_t>>>& times)
-      : graph(graph),
-        times(times),
+  EADijkstra(const Data& data)
+      : data(data),
+        graph(data.timeDependentGraph),
         Q(graph.numVertices()),
         label(graph.numVertices()),
         timeStamp(0),
@@ -87,18 +85,7 @@ class EADijkstra {
          METRIC_RELAXED_ROUTE_EDGES, METRIC_FOUND_SOLUTIONS});
   }
 
-  template <AttributeNameType ATTRIBUTE_NAME>
-  EADijkstra(const GRAPH& graph,
-             const AttributeNameWrapper<ATTRIBUTE_NAME> weight)
-      : EADijkstra(graph, graph[weight]) {}
-
-  EADijkstra(const GRAPH&&, const std::vector<int>&) = delete;
-  EADijkstra(const GRAPH&, const std::vector<int>&&) = delete;
-  EADijkstra(const GRAPH&&) = delete;
-
-  template <AttributeNameType ATTRIBUTE_NAME>
-  EADijkstra(const GRAPH&&,
-             const AttributeNameWrapper<ATTRIBUTE_NAME>) = delete;
+  EADijkstra(const Data&&) = delete;
 
   template <typename SETTLE = NO_OPERATION, typename STOP = NO_OPERATION,
             typename PRUNE_EDGE = NO_OPERATION>
@@ -195,21 +182,18 @@ class EADijkstra {
         if (pruneEdge(u, edge)) continue;
         // duration != -1 => footpath
         int arrivalTime = uLabel->arrivalTime;
-        int durationToAdd = 0;
+        const int travelTime = graph.get(TravelTime, edge);
 
-        if (graph.get(TravelTime, edge) != -1) {
+        if (travelTime != -1) {
           profiler.countMetric(METRIC_RELAXED_TRANSFER_EDGES);
-          durationToAdd = graph.get(TravelTime, edge);
+          arrivalTime += travelTime;
         } else {
           profiler.countMetric(METRIC_RELAXED_ROUTE_EDGES);
-          assert(!graph.get(DurationFunction, edge).empty());
-          durationToAdd = evaluateEdgeBinary(graph.get(DurationFunction, edge),
-                                             arrivalTime);
+          arrivalTime = data.getArrivalTime(edge, arrivalTime);
+          if (arrivalTime == intMax) [[unlikely]] {
+            continue;
+          }
         }
-        if (durationToAdd == intMax) [[unlikely]] {
-          continue;
-        }
-        arrivalTime += durationToAdd;
         if (vLabel.arrivalTime > arrivalTime) {
           vLabel.arrivalTime = arrivalTime;
           vLabel.parent = u;
@@ -292,50 +276,9 @@ class EADijkstra {
     return result;
   }
 
-  inline int evaluateEdgeLinear(const auto& times,
-                                const int arrivalTime) const {
-    AssertMsg(!times.empty(), "Given DurationFunction is empty?");
-    AssertMsg(times.back().first == intMax,
-              "The end should contain a sentinel!");
-    AssertMsg(times.back().second == intMax,
-              "The end should contain a sentinel!");
-    AssertMsg(arrivalTime < intMax, "ArrivalTime is infinity?");
-    size_t i = 0;
-
-    while (i < times.size() &&
-           times[i].first < static_cast<uint32_t>(arrivalTime))
-      ++i;
-
-    assert(i < times.size());
-    return times[i].second;
-  }
-
-  inline int evaluateEdgeBinary(const auto& times,
-                                const int arrivalTime) const {
-    AssertMsg(!times.empty(), "Given DurationFunction is empty?");
-    AssertMsg(times.back().first == intMax,
-              "The end should contain a sentinel!");
-    AssertMsg(times.back().second == intMax,
-              "The end should contain a sentinel!");
-    AssertMsg(arrivalTime < intMax, "ArrivalTime is infinity?");
-
-    // Use std::lower_bound to find the first element that is not less than
-    // arrivalTime
-    auto it =
-        std::lower_bound(times.begin(), times.end(), arrivalTime,
-                         [](const auto& pair, const int value) {
-                           return pair.first < static_cast<uint32_t>(value);
-                         });
-
-    // We assume that the last element is the sentinel, so it should always find
-    // a valid iterator.
-    assert(it != times.end());
-    return it->second;
-  }
-
  private:
+  const Data& data;
   const GRAPH& graph;
-  const std::vector<std::vector<std::pair<uint32_t, uint32_t>>>& times;
 
   ExternalKHeap<2, VertexLabel> Q;
 
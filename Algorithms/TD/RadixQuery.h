@@ -0,0 +1,243 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../DataStructures/Attributes/AttributeNames.h"
+#include "../../DataStructures/Container/radix_heap.h"
+#include "../../DataStructures/TD/Data.h"
+#include "../../Helpers/Meta.h"
+#include "../../Helpers/String/String.h"
+#include "../../Helpers/Timer.h"
+#include "../../Helpers/Types.h"
+#include "../../Helpers/Vector/Vector.h"
+#include "Profiler.h"
+
+namespace TD {
+
+// Same as EADijkstra, but with a radix heap as queue. Arrival times never
+// decrease along an edge, so the keys are monotone. Instead of decreasing a
+// key, the vertex is pushed again and outdated entries are skipped.
+template <typename GRAPH, typename PROFILER = NoProfiler, bool DEBUG = false>
+class RadixEADijkstra {
+ public:
+  using Graph = GRAPH;
+  using Profiler = PROFILER;
+  static constexpr bool Debug = DEBUG;
+  using Type = RadixEADijkstra<Graph, Profiler, Debug>;
+
+ public:
+  struct VertexLabel {
+    VertexLabel() : arrivalTime(intMax), parent(noVertex), timeStamp(-1) {}
+    inline void reset(int time) {
+      arrivalTime = intMax;
+      parent = noVertex;
+      timeStamp = time;
+    }
+
+    int arrivalTime;
+    Vertex parent;
+    int timeStamp;
+  };
+
+ public:
+  RadixEADijkstra(const Data& data)
+      : data(data),
+        graph(data.timeDependentGraph),
+        Q(),
+        label(graph.numVertices()),
+        timeStamp(0),
+        settleCount(0) {
+    profiler.registerPhases({PHASE_CLEAR, PHASE_RUN});
+    profiler.registerMetrics(
+        {METRIC_SEETLED_VERTICES, METRIC_RELAXED_TRANSFER_EDGES,
+         METRIC_RELAXED_ROUTE_EDGES, METRIC_FOUND_SOLUTIONS});
+  }
+
+  RadixEADijkstra(const Data&&) = delete;
+
+  template <typename SETTLE = NO_OPERATION, typename STOP = NO_OPERATION,
+            typename PRUNE_EDGE = NO_OPERATION>
+  inline void run(const Vertex source, const int departureTime = 0,
+                  const Vertex target = noVertex,
+                  const SETTLE& settle = NoOperation,
+                  const STOP& stop = NoOperation,
+                  const PRUNE_EDGE& pruneEdge = NoOperation) noexcept {
+    profiler.start();
+
+    clear();
+    addSource(source, departureTime);
+    run(target, settle, stop, pruneEdge);
+
+    profiler.done();
+
+    if (getDistance(target) != intMax)
+      profiler.countMetric(METRIC_FOUND_SOLUTIONS);
+  }
+
+  inline void clear() noexcept {
+    profiler.startPhase();
+
+    if constexpr (Debug) {
+      timer.restart();
+      settleCount = 0;
+    }
+    Q.clear();
+    timeStamp++;
+
+    profiler.donePhase(PHASE_CLEAR);
+  }
+
+  // All sources have to be added before the search starts
+  inline void addSource(const Vertex source,
+                        const int arrivalTime = 0) noexcept {
+    VertexLabel& sourceLabel = getLabel(source);
+    if (sourceLabel.arrivalTime <= arrivalTime) return;
+    sourceLabel.arrivalTime = arrivalTime;
+    Q.push(static_cast<uint32_t>(arrivalTime), source);
+  }
+
+  inline void run() noexcept {
+    run(noVertex, NoOperation, NoOperation, NoOperation);
+  }
+
+  template <typename SETTLE, typename STOP = NO_OPERATION,
+            typename PRUNE_EDGE = NO_OPERATION,
+            typename = decltype(std::declval<SETTLE>()(std::declval<Vertex>()))>
+  inline void run(const Vertex target, const SETTLE& settle,
+                  const STOP& stop = NoOperation,
+                  const PRUNE_EDGE& pruneEdge = NoOperation) noexcept {
+    profiler.startPhase();
+
+    while (!Q.empty()) {
+      if (stop()) break;
+      const int key = Q.top_key();
+      const Vertex u = Q.top_value();
+      Q.pop();
+      const VertexLabel& uLabel = label[u];
+      if (key != uLabel.arrivalTime) continue;
+      if (u == target) [[unlikely]]
+        break;
+      for (const Edge& edge : graph.edgesFrom(u)) {
+        const Vertex v = graph.get(ToVertex, edge);
+        VertexLabel& vLabel = getLabel(v);
+        if (pruneEdge(u, edge)) continue;
+        // duration != -1 => footpath
+        int arrivalTime = uLabel.arrivalTime;
+        const int travelTime = graph.get(TravelTime, edge);
+
+        if (travelTime != -1) {
+          profiler.countMetric(METRIC_RELAXED_TRANSFER_EDGES);
+          arrivalTime += travelTime;
+        } else {
+          profiler.countMetric(METRIC_RELAXED_ROUTE_EDGES);
+          arrivalTime = data.getArrivalTime(edge, arrivalTime);
+          if (arrivalTime == intMax) [[unlikely]] {
+            continue;
+          }
+        }
+        if (vLabel.arrivalTime > arrivalTime) {
+          vLabel.arrivalTime = arrivalTime;
+          vLabel.parent = u;
+          Q.push(static_cast<uint32_t>(arrivalTime), v);
+        }
+      }
+      profiler.countMetric(METRIC_SEETLED_VERTICES);
+
+      settle(u);
+      if constexpr (Debug) settleCount++;
+    }
+    if constexpr (Debug) {
+      std::cout << "Settled Vertices = " << String::prettyInt(settleCount)
+                << std::endl;
+      std::cout << "Time = " << String::msToString(timer.elapsedMilliseconds())
+                << std::endl;
+    }
+
+    profiler.donePhase(PHASE_RUN);
+  }
+
+  inline bool reachable(const Vertex vertex) const noexcept {
+    return label[vertex].timeStamp == timeStamp;
+  }
+
+  inline bool visited(const Vertex vertex) const noexcept {
+    return label[vertex].timeStamp == timeStamp;
+  }
+
+  inline int getDistance(const Vertex vertex) const noexcept {
+    if (visited(vertex)) return label[vertex].arrivalTime;
+    return -1;
+  }
+
+  inline Vertex getParent(const Vertex vertex) const noexcept {
+    if (visited(vertex)) return label[vertex].parent;
+    return noVertex;
+  }
+
+  inline std::vector<Vertex> getReversePath(const Vertex to) const noexcept {
+    std::vector<Vertex> path;
+    if (!visited(to)) return path;
+    path.push_back(to);
+    while (label[path.back()].parent != noVertex) {
+      path.push_back(label[path.back()].parent);
+    }
+    return path;
+  }
+
+  inline std::vector<Vertex> getPath(const Vertex to) const noexcept {
+    return Vector::reverse(getReversePath(to));
+  }
+
+  inline int getSettleCount() const noexcept { return settleCount; }
+
+  inline const Profiler& getProfiler() const noexcept { return profiler; }
+
+ private:
+  inline VertexLabel& getLabel(const Vertex vertex) noexcept {
+    VertexLabel& result = label[vertex];
+    if (result.timeStamp != timeStamp) result.reset(timeStamp);
+    return result;
+  }
+
+ private:
+  const Data& data;
+  const GRAPH& graph;
+
+  radix_heap::pair_radix_heap<uint32_t, Vertex> Q;
+
+  std::vector<VertexLabel> label;
+  int timeStamp;
+
+  int settleCount;
+  Timer timer;
+
+  Profiler profiler;
+};
+}  // namespace TD
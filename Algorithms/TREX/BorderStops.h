@@ -80,16 +80,14 @@ class BorderStops {
     result.second.reserve(2000);
 
     auto inSameCell = [&](auto a, auto b, const int level) -> bool {
-      assert(level >= 0 && level < 16);
-      return (data.getCellIdOfStop(a) >> level) ==
-             (data.getCellIdOfStop(b) >> level);
+      assert(data.isLevel(level));
+      return data.getCellOfStop(a, level) == data.getCellOfStop(b, level);
     };
 
     auto isInCell = [&](const StopId stop, const int level,
                         const int cell) -> bool {
-      assert(level >= 0 && level < 16);
-      return (data.getCellIdOfStop(stop) >> level) ==
-             static_cast<std::uint16_t>(cell);
+      assert(data.isLevel(level));
+      return data.getCellOfStop(stop, level) == static_cast<uint32_t>(cell);
     };
 
     for (StopId stop(0); stop < data.numberOfStops(); ++stop) {
@@ -24,11 +24,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
-// Builder for Number Of Cells = 2 on all levels
+// Builder for any power of two as the number of cells per level
 
 #include <omp.h>
 #include <tbb/global_control.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <execution>
 #include <vector>
@@ -38,6 +40,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../Helpers/Console/Progress.h"
 #include "../../../Helpers/MultiThreading.h"
 #include "../../../Helpers/String/String.h"
+#include "../../../Helpers/Timer.h"
 #include "../../TripBased/Query/Profiler.h"
 #include "TransferSearchIBEs.h"
 
@@ -60,12 +63,16 @@ class Builder {
         numberOfThreads(numberOfThreads),
         pinMultiplier(pinMultiplier),
         seekers(),
-        IBEs() {
+        IBEs(),
+        levelTimes() {
     // set number of threads
     tbb::global_control c(tbb::global_control::max_allowed_parallelism,
                           numberOfThreads);
     omp_set_num_threads(numberOfThreads);
 
+    // the transfer searches read the edge labels of the shared query tables
+    data.buildQueryTables();
+
     seekers.reserve(numberOfThreads);
     for (int i = 0; i < numberOfThreads; ++i) seekers.emplace_back(data);
 
@@ -137,6 +144,7 @@ class Builder {
     // cross at this level, not lower levels
 
     profiler.startPhase();
+    const int shift = data.getCellShift(level);
     IBEs.erase(std::remove_if(
                    std::execution::par, IBEs.begin(), IBEs.end(),
                    [&](PackedIBE ibe) {
@@ -147,7 +155,7 @@ class Builder {
                      auto toStop = data.getStop(trip, StopIndex(stopIndex + 1));
                      return !((data.getCellIdOfStop(fromStop) ^
                                data.getCellIdOfStop(toStop)) >>
-                              level);
+                              shift);
                    }),
                IBEs.end());
     profiler.donePhase(PHASE_TREX_FILTER_IBES);
@@ -167,7 +175,7 @@ class Builder {
       profiler.donePhase(PHASE_TREX_SORT_IBES);
     }
 
-    const int numCores = numberOfCores();
+    levelTimes.assign(data.getNumberOfLevels(), 0);
 
     // now for every level, we have an invariant: IBEs contains exactly the IBEs
     // we need on this level
@@ -176,43 +184,207 @@ class Builder {
         std::cout << "Starting Level " << (int)level
                   << " [IBEs: " << IBEs.size() << "]... " << std::endl;
 
-      Progress progress(IBEs.size());
+      Timer levelTimer;
+      runLevel<VERBOSE>(IBEs, level);
 
-#pragma omp parallel
-      {
-#pragma omp for schedule(dynamic)
-        for (size_t i = 0; i < IBEs.size(); ++i) {
-          int threadId = omp_get_thread_num();
-          pinThreadToCoreId((threadId * pinMultiplier) % numCores);
-          AssertMsg(omp_get_num_threads() == numberOfThreads,
-                    "Number of threads is " << omp_get_num_threads()
-                                            << ", but should be "
-                                            << numberOfThreads << "!");
-
-          auto& values = IBEs[i];
-          seekers[threadId].run(TripId(values >> TRIPOFFSET),
-                                StopIndex(values & STOPINDEX_MASK), level);
-          ++progress;
+      if (level < data.getNumberOfLevels() - 1) filterIrrelevantIBEs(level + 1);
+
+      levelTimes[level] = levelTimer.elapsedMilliseconds();
+      if (VERBOSE)
+        std::cout << "done in " << String::msToString(levelTimes[level])
+                  << "!\n";
+    }
+
+    // the local levels have changed, hence refresh the query tables
+    data.buildQueryTables();
+    profiler.done();
+  }
+
+  // Incremental customization after an update of the partition and/or of some
+  // trips. The local levels of the stop event graph have to be the result of
+  // a customization with the cell ids 'oldCellIds'. Since then, the cell ids
+  // of any stop may have changed (e.g., by applyGlobalIDs) and the trips in
+  // 'changedTrips' may have changed, including their transfers. Transfers,
+  // which have been added to the stop event graph, need local level 0.
+  //
+  // A search of an IBE on level l only boards trips at stops inside the cell
+  // of the IBE on level l. Hence, a cell is affected on level l if a 'dirty'
+  // stop (a stop with a new cell id or a stop of a changed trip) belongs to it
+  // before or after the update. Since a transfer is only relaxed on level l if
+  // it has been raised on all levels below, the local level of a transfer is
+  // still valid up to the lowest affected level of the cell of its target
+  // stop. We cap the local levels accordingly and rerun only the IBEs leading
+  // into affected cells.
+  template <bool SORT_IBES = true, bool VERBOSE = true>
+  inline void runIncremental(const std::vector<uint32_t>& oldCellIds,
+                             const std::vector<TripId>& changedTrips) noexcept {
+    AssertMsg(oldCellIds.size() == data.numberOfStops(),
+              "Old cell ids do not match the number of stops!");
+    profiler.start();
+    const int numberOfLevels = data.getNumberOfLevels();
+
+    std::vector<bool> isDirty(data.numberOfStops(), false);
+    for (const StopId stop : data.stops()) {
+      isDirty[stop] = (oldCellIds[stop] != data.cellIds[stop]);
+    }
+    for (const TripId trip : changedTrips) {
+      AssertMsg(data.isTrip(trip), "Trip " << trip << " is not valid!");
+      const StopId* stops = data.stopArrayOfTrip(trip);
+      for (size_t i = 0; i < data.numberOfStopsInTrip(trip); ++i) {
+        isDirty[stops[i]] = true;
+      }
+    }
+
+    auto cellOf = [&](const uint32_t cellId, const int level) {
+      return cellId >> data.getCellShift(level);
+    };
+
+    // affectedCells[l][c] <=> the cell with id prefix c is affected on level l
+    const uint32_t maxCellId =
+        std::max(*std::max_element(oldCellIds.begin(), oldCellIds.end()),
+                 *std::max_element(data.cellIds.begin(), data.cellIds.end()));
+    std::vector<std::vector<bool>> affectedCells(numberOfLevels);
+    for (int level = 0; level < numberOfLevels; ++level) {
+      affectedCells[level].assign(cellOf(maxCellId, level) + 1, false);
+    }
+    for (const StopId stop : data.stops()) {
+      if (!isDirty[stop]) continue;
+      for (int level = 0; level < numberOfLevels; ++level) {
+        affectedCells[level][cellOf(oldCellIds[stop], level)] = true;
+        affectedCells[level][cellOf(data.cellIds[stop], level)] = true;
+      }
+    }
+
+    std::vector<uint8_t> lowestAffectedLevel(data.numberOfStops(),
+                                             numberOfLevels);
+    for (const StopId stop : data.stops()) {
+      for (int level = 0; level < numberOfLevels; ++level) {
+        if (affectedCells[level][cellOf(data.cellIds[stop], level)]) {
+          lowestAffectedLevel[stop] = level;
+          break;
+        }
+      }
+    }
+    const uint8_t firstLevel = *std::min_element(lowestAffectedLevel.begin(),
+                                                 lowestAffectedLevel.end());
+    if (firstLevel == numberOfLevels) {
+      if (VERBOSE) std::cout << "No cell is affected by the update!\n";
+      profiler.done();
+      return;
+    }
+
+    // cap the local levels by the lowest affected level of the target stop
+    std::vector<uint8_t>& localLevels = data.stopEventGraph.get(LocalLevel);
+#pragma omp parallel for
+    for (size_t edge = 0; edge < localLevels.size(); ++edge) {
+      const StopId stop = data.getStopOfStopEvent(
+          StopEventId(data.stopEventGraph.get(ToVertex, Edge(edge))));
+      localLevels[edge] = std::min(localLevels[edge], lowestAffectedLevel[stop]);
+    }
+
+    collectAllIBEsOnLowestLevel();
+    if (SORT_IBES) {
+      profiler.startPhase();
+      ips4o::parallel::sort(IBEs.begin(), IBEs.end());
+      profiler.donePhase(PHASE_TREX_SORT_IBES);
+    }
+
+    levelTimes.assign(numberOfLevels, 0);
+    std::vector<PackedIBE> affectedIBEs;
+    for (uint8_t level(0); level < numberOfLevels; ++level) {
+      Timer levelTimer;
+      if (level >= firstLevel) {
+        affectedIBEs.clear();
+        for (const PackedIBE ibe : IBEs) {
+          const StopId toStop =
+              data.getStop(TripId(ibe >> TRIPOFFSET),
+                           StopIndex((ibe & STOPINDEX_MASK) + 1));
+          if (affectedCells[level][cellOf(data.cellIds[toStop], level)]) {
+            affectedIBEs.emplace_back(ibe);
+          }
         }
+        if (VERBOSE)
+          std::cout << "Starting Level " << (int)level
+                    << " [IBEs: " << affectedIBEs.size() << " of "
+                    << IBEs.size() << "]... " << std::endl;
+        runLevel<VERBOSE>(affectedIBEs, level);
       }
 
-      progress.finished();
+      if (level < numberOfLevels - 1) filterIrrelevantIBEs(level + 1);
 
-      if (level < data.getNumberOfLevels() - 1) filterIrrelevantIBEs(level + 1);
+      levelTimes[level] = levelTimer.elapsedMilliseconds();
+      if (VERBOSE && level >= firstLevel)
+        std::cout << "done in " << String::msToString(levelTimes[level])
+                  << "!\n";
+    }
 
-      if (VERBOSE) std::cout << "done!\n";
+    // the level of an event is the highest level of its outgoing transfers
+#pragma omp parallel for
+    for (size_t event = 0; event < data.numberOfStopEvents(); ++event) {
+      uint8_t level = 0;
+      for (const Edge edge : data.stopEventGraph.edgesFrom(Vertex(event))) {
+        level = std::max(level, localLevels[edge]);
+      }
+      data.getLocalLevelOfEvent(StopEventId(event)) = level;
     }
+
+    // the local levels have changed, hence refresh the query tables
+    data.buildQueryTables();
     profiler.done();
   }
 
+ private:
+  // runs the transfer searches of all given IBEs on the given level
+  template <bool VERBOSE>
+  inline void runLevel(const std::vector<PackedIBE>& ibes,
+                       const uint8_t level) noexcept {
+    const int numCores = numberOfCores();
+    Progress progress(ibes.size(), VERBOSE);
+    std::atomic<size_t> ibesDone(0);
+
+    // Every IBE is a task of its own (and not every cell), so even the top
+    // levels with only a few cells keep all threads busy. The searches only
+    // raise local levels via atomicMax, hence the result is independent of
+    // the schedule.
+#pragma omp parallel
+    {
+      const int threadId = omp_get_thread_num();
+      pinThreadToCoreId((threadId * pinMultiplier) % numCores);
+      AssertMsg(omp_get_num_threads() == numberOfThreads,
+                "Number of threads is " << omp_get_num_threads()
+                                        << ", but should be "
+                                        << numberOfThreads << "!");
+
+#pragma omp for schedule(dynamic, 16)
+      for (size_t i = 0; i < ibes.size(); ++i) {
+        const PackedIBE ibe = ibes[i];
+        seekers[threadId].run(TripId(ibe >> TRIPOFFSET),
+                              StopIndex(ibe & STOPINDEX_MASK), level);
+        const size_t done =
+            ibesDone.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (threadId == 0) progress.iterateTo(done);
+      }
+    }
+
+    progress.finished();
+  }
+
+ public:
   inline AggregateProfiler& getProfiler() noexcept { return profiler; }
 
+  // Wall time (in milliseconds) of every level of the last run, including the
+  // filtering of the IBEs for the next level
+  inline const std::vector<double>& getLevelTimes() const noexcept {
+    return levelTimes;
+  }
+
   TREXData& data;
   const int numberOfThreads;
   const int pinMultiplier;
 
   std::vector<TransferSearch<TripBased::NoProfiler>> seekers;
   std::vector<PackedIBE> IBEs;
+  std::vector<double> levelTimes;
   AggregateProfiler profiler;
 };
 }  // namespace TripBased
@@ -29,13 +29,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <vector>
 
 #include "../../../Algorithms/DepthFirstSearch.h"
-#include "../../../DataStructures/Container/SIMD16u.h"
 #include "../../../DataStructures/Graph/Graph.h"
 #include "../../../DataStructures/TREX/TREXData.h"
 #include "../../../Helpers/Console/Progress.h"
 
 namespace TripBased {
 
+// Time-expanded graph of the trip-based network: every stop event e has a
+// vertex (alighting at e, transfers leave here) and a split vertex (being
+// seated in the trip at e, transfers arrive here). Transfers cost 1, staying
+// in the trip costs 0. The vertices are numbered in topological order.
 class TBTEGraph {
  public:
   const TREXData &data;
@@ -43,14 +46,21 @@ class TBTEGraph {
 
   std::vector<std::uint8_t> rank;
 
-  std::vector<SIMD16u> distances;
-  std::vector<SIMD16u> parents;
+  // stop event => its (non split) vertex, and vertex => original vertex, i.e.,
+  // e for the vertex of e and n + e for the split vertex of e
+  std::vector<Vertex> vertexOfEvent;
+  std::vector<Vertex> originalVertex;
 
   TBTEGraph(const TREXData &data)
-      : data(data),
-        rank(data.stopEventGraph.numEdges(), 0),
-        distances(),
-        parents() {}
+      : data(data), rank(data.stopEventGraph.numEdges(), 0) {}
+
+  inline bool isEventVertex(const Vertex vertex) const noexcept {
+    return originalVertex[vertex] < data.numberOfStopEvents();
+  }
+
+  inline StopEventId eventOfVertex(const Vertex vertex) const noexcept {
+    return StopEventId(originalVertex[vertex] % data.numberOfStopEvents());
+  }
 
   static std::uint8_t extractWeight(std::uint16_t packed) noexcept {
     return static_cast<std::uint8_t>(packed >> 15);
@@ -133,6 +143,7 @@ class TBTEGraph {
            i++) {
         const StopId stop = stops[i];
         graph.set(CellId, Vertex(firstEvent + i), data.cellIds[stop]);
+        graph.set(CellId, splitVertex[firstEvent + i], data.cellIds[stop]);
       }
     }
 
@@ -158,8 +169,16 @@ class TBTEGraph {
 
     // now the other datastructes
     rank.assign(data.stopEventGraph.numEdges(), 0);
-    distances.resize(graph.numEdges());
-    parents.resize(graph.numEdges());
+    originalVertex.assign(topoOrder.size(), noVertex);
+    for (size_t i = 0; i < topoOrder.size(); ++i)
+      originalVertex[i] = Vertex(topoOrder[i]);
+    vertexOfEvent.assign(n, noVertex);
+    for (Vertex v(0); v < graph.numVertices(); ++v) {
+      if (isEventVertex(v)) vertexOfEvent[originalVertex[v]] = v;
+      // the searches store the parent edge as index into the incoming edges
+      AssertMsg(graph.get(IncomingEdges, v).size() < 0xFFFF,
+                "Vertex " << v << " has too many incoming edges!");
+    }
   }
 };
 }  // namespace TripBased
@@ -24,30 +24,316 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <immintrin.h>
+#include <omp.h>
+
+#include <algorithm>
 #include <queue>
+#include <tuple>
 #include <vector>
 
+#include "../../../DataStructures/Container/SIMD16u.h"
+#include "../../../DataStructures/TREX/TREXData.h"
+#include "../../../Helpers/MultiThreading.h"
+#include "../../../Helpers/String/String.h"
+#include "../../../Helpers/Timer.h"
 #include "TBTEGraph.h"
 
 namespace TripBased {
 
+// Customization engine working on the TBTE graph instead of the stop event
+// graph. One run handles up to 16 incoming border events (IBEs) of the same
+// cell at once, one per SIMD16u lane. Since the vertices of the TBTE graph are
+// numbered in topological order, settling them in increasing order (with a
+// priority queue on the vertex ids) visits every vertex after all of its
+// predecessors, hence every lane gets the minimum number of transfers from its
+// IBE. Afterwards, the transfers on the minimum transfer paths (first found
+// parent) towards events outside the cell get the next local level, just like
+// TransferSearch::unpack does.
+// Contrary to the TransferSearch, later trips of an already reached route are
+// not pruned, thus TopoBFS may raise a few more transfers.
 class TopoBFS {
  public:
+  static constexpr size_t NumberOfLanes = 16;
+  static constexpr uint16_t Unreached = 0xFFFF;
+  // same limit as the 16 rounds of the TransferSearch
+  static constexpr uint16_t MaxTransfers = 15;
+
   using PQueue =
       std::priority_queue<Vertex, std::vector<Vertex>, std::greater<>>;
-  TBTEGraph &tbte;
+
+  TopoBFS(TREXData &data, const TBTEGraph &tbte)
+      : data(data),
+        tbte(tbte),
+        graph(tbte.graph),
+        distances(graph.numVertices(), SIMD16u(Unreached)),
+        parents(graph.numVertices(), SIMD16u(Unreached)),
+        isTouched(graph.numVertices(), false),
+        lastUnpackedRun(data.stopEventGraph.numEdges(), 0),
+        currentRun(0),
+        minLevel(0),
+        cellShift(0),
+        currentCellId(0) {}
+
+  // sources are the vertices of the IBEs, their next stop lies in the cell
+  // with the given id
+  inline void run(const std::vector<Vertex> &sources, const uint8_t level,
+                  const uint32_t cellId) noexcept {
+    AssertMsg(sources.size() <= NumberOfLanes,
+              "At most " << NumberOfLanes << " sources are supported!");
+    reset();
+    minLevel = level;
+    cellShift = data.getCellShift(level);
+    currentCellId = cellId;
+
+    for (size_t lane = 0; lane < sources.size(); ++lane) {
+      touch(sources[lane]);
+      distances[sources[lane]][lane] = 0;
+    }
+
+    sweep();
+
+    for (size_t lane = 0; lane < sources.size(); ++lane) {
+      ++currentRun;
+      for (const Vertex exit : exits) {
+        if (distances[exit][lane] == Unreached) continue;
+        unpack(exit, sources[lane], lane);
+      }
+    }
+  }
+
+  inline void reset() noexcept {
+    for (const Vertex vertex : touched) {
+      distances[vertex].fill(Unreached);
+      parents[vertex].fill(Unreached);
+      isTouched[vertex] = false;
+    }
+    touched.clear();
+    exits.clear();
+    Q = PQueue();
+  }
+
+ private:
+  inline bool isInCell(const Vertex vertex) const noexcept {
+    return !((graph.get(CellId, vertex) ^ currentCellId) >> cellShift);
+  }
+
+  inline void touch(const Vertex vertex) noexcept {
+    if (isTouched[vertex]) return;
+    isTouched[vertex] = true;
+    touched.emplace_back(vertex);
+    Q.push(vertex);
+  }
+
+  inline void sweep() noexcept {
+    const SIMD16u one(1);
+    const SIMD16u limit(MaxTransfers);
+    const SIMD16u unreached(Unreached);
+
+    while (!Q.empty()) {
+      const Vertex u = Q.top();
+      Q.pop();
+      // events outside the cell, which are reached in a trip
+      if (tbte.isEventVertex(u) && !isInCell(u)) exits.emplace_back(u);
+
+      const SIMD16u distance = distances[u];
+      for (const Edge edge : graph.edgesFrom(u)) {
+        const Vertex v = graph.get(ToVertex, edge);
+        SIMD16u candidate = distance;
+        if (tbte.getWeight(edge)) {
+          // boarding is only allowed inside the cell and via transfers, which
+          // are still relevant on this level
+          if (!isInCell(v)) continue;
+          const Edge transfer(graph.get(OriginalEdge, edge));
+          if (minLevel >
+              atomicLoad(data.stopEventGraph.get(LocalLevel, transfer)))
+            continue;
+          candidate = distance.adds(one);
+          // lanes exceeding the transfer limit become unreached
+          const __m256i withinLimit = _mm256_cmpeq_epi16(
+              _mm256_min_epu16(candidate.v.reg, limit.v.reg),
+              candidate.v.reg);
+          candidate.blend(unreached, withinLimit);
+        }
+        if (_mm256_movemask_epi8(candidate.cmpeq(unreached).v.reg) == -1)
+          continue;
+
+        touch(v);
+        // lanes, which improved, take this edge as parent
+        const __m256i unchanged = distances[v].min(candidate);
+        parents[v].blend(
+            SIMD16u(uint16_t(graph.get(IncomingEdgePointer, edge))),
+            unchanged);
+      }
+    }
+  }
+
+  // raises the level of all transfers on the path of the lane to the vertex
+  inline void unpack(Vertex vertex, const Vertex source,
+                     const size_t lane) noexcept {
+    const uint8_t newLevel = minLevel + 1;
+    while (vertex != source) {
+      AssertMsg(parents[vertex][lane] != Unreached,
+                "Vertex " << vertex << " has no parent in lane " << lane);
+      const Edge edge =
+          graph.get(IncomingEdges, vertex)[parents[vertex][lane]];
+      const Vertex parent = graph.get(FromVertex, edge);
+      if (tbte.getWeight(edge)) {
+        const Edge transfer(graph.get(OriginalEdge, edge));
+        // the remaining path has been unpacked already
+        if (lastUnpackedRun[transfer] == currentRun) return;
+        lastUnpackedRun[transfer] = currentRun;
+
+        atomicMax(data.stopEventGraph.get(LocalLevel, transfer), newLevel);
+        atomicMax(data.getLocalLevelOfEvent(tbte.eventOfVertex(parent)),
+                  newLevel);
+      }
+      vertex = parent;
+    }
+  }
+
+ private:
+  TREXData &data;
+  const TBTEGraph &tbte;
+  const DynamicTBTEGraph &graph;
+
+  std::vector<SIMD16u> distances;
+  std::vector<SIMD16u> parents;
+
+  std::vector<bool> isTouched;
+  std::vector<Vertex> touched;
+  std::vector<Vertex> exits;
   PQueue Q;
 
-  TopoBFS(TBTEGraph &tbte) : tbte(tbte) {}
+  std::vector<uint32_t> lastUnpackedRun;
+  uint32_t currentRun;
+
+  uint8_t minLevel;
+  uint8_t cellShift;
+  uint32_t currentCellId;
+};
+
+// Customization with TopoBFS: per level, the IBEs are grouped by cell and
+// handed out in batches of 16 to the threads.
+class TopoBFSBuilder {
+ public:
+  TopoBFSBuilder(TREXData &data, const int numberOfThreads = 1,
+                 const int pinMultiplier = 1)
+      : data(data),
+        tbte(data),
+        numberOfThreads(numberOfThreads),
+        pinMultiplier(pinMultiplier),
+        graphTime(0) {
+    Timer timer;
+    tbte.buildTBTEGraph();
+    graphTime = timer.elapsedMilliseconds();
+
+    searches.reserve(numberOfThreads);
+    for (int i = 0; i < numberOfThreads; ++i) searches.emplace_back(data, tbte);
+  }
+
+  template <bool VERBOSE = true>
+  inline void run() noexcept {
+    const int numCores = numberOfCores();
+    omp_set_num_threads(numberOfThreads);
+    levelTimes.assign(data.getNumberOfLevels(), 0);
+
+    for (uint8_t level(0); level < data.getNumberOfLevels(); ++level) {
+      Timer levelTimer;
+      collectBatches(level);
+      if (VERBOSE)
+        std::cout << "Starting Level " << (int)level
+                  << " [IBEs: " << sources.size()
+                  << ", batches: " << batchCellIds.size() << "]... "
+                  << std::flush;
+
+#pragma omp parallel
+      {
+        const int threadId = omp_get_thread_num();
+        pinThreadToCoreId((threadId * pinMultiplier) % numCores);
+        AssertMsg(omp_get_num_threads() == numberOfThreads,
+                  "Number of threads is " << omp_get_num_threads()
+                                          << ", but should be "
+                                          << numberOfThreads << "!");
+        std::vector<Vertex> batch;
+
+#pragma omp for schedule(dynamic)
+        for (size_t i = 0; i < batchCellIds.size(); ++i) {
+          batch.assign(sources.begin() + firstSourceOfBatch[i],
+                       sources.begin() + firstSourceOfBatch[i + 1]);
+          searches[threadId].run(batch, level, batchCellIds[i]);
+        }
+      }
 
-  void reset() { Q = PQueue(); }
+      levelTimes[level] = levelTimer.elapsedMilliseconds();
+      if (VERBOSE)
+        std::cout << "done in " << String::msToString(levelTimes[level])
+                  << "!" << std::endl;
+    }
+
+    // the local levels have changed, hence refresh the query tables
+    data.buildQueryTables();
+  }
+
+  // Time (in milliseconds) for building the TBTE graph
+  inline double getGraphTime() const noexcept { return graphTime; }
 
-  void run(std::vector<Vertex> &sources) {
-    for (auto s : sources) {
-      Q.push(s);
-      tbte.distances[s].fill(0);
-      tbte.parent[s].fill(static_cast<uint16_t>(-1));
+  // Wall time (in milliseconds) of every level of the last run
+  inline const std::vector<double> &getLevelTimes() const noexcept {
+    return levelTimes;
+  }
+
+ private:
+  // collects the IBEs crossing on this level, sorted by their cell on this
+  // level, and cuts them into batches of at most 16 IBEs of the same cell
+  inline void collectBatches(const uint8_t level) noexcept {
+    const int shift = data.getCellShift(level);
+    std::vector<std::tuple<uint32_t, uint32_t, Vertex>> ibes;
+    for (const TripId trip : data.trips()) {
+      const StopEventId firstEvent = data.firstStopEventOfTrip[trip];
+      const StopId *stops = data.stopArrayOfTrip(trip);
+      for (size_t i = 0; i + 1 < data.numberOfStopsInTrip(trip); ++i) {
+        const uint32_t fromCell = data.cellIds[stops[i]];
+        const uint32_t toCell = data.cellIds[stops[i + 1]];
+        if (!((fromCell ^ toCell) >> shift)) continue;
+        ibes.emplace_back(toCell >> shift, toCell,
+                          tbte.vertexOfEvent[firstEvent + i]);
+      }
     }
+    std::sort(ibes.begin(), ibes.end());
+
+    sources.clear();
+    batchCellIds.clear();
+    firstSourceOfBatch.assign(1, 0);
+    for (size_t i = 0; i < ibes.size(); ++i) {
+      const bool newBatch =
+          (i == 0) ||
+          (std::get<0>(ibes[i]) != std::get<0>(ibes[i - 1])) ||
+          (sources.size() - firstSourceOfBatch.back() ==
+           TopoBFS::NumberOfLanes);
+      if (newBatch) {
+        if (i > 0) firstSourceOfBatch.emplace_back(sources.size());
+        batchCellIds.emplace_back(std::get<1>(ibes[i]));
+      }
+      sources.emplace_back(std::get<2>(ibes[i]));
+    }
+    firstSourceOfBatch.emplace_back(sources.size());
   }
+
+ private:
+  TREXData &data;
+  TBTEGraph tbte;
+
+  const int numberOfThreads;
+  const int pinMultiplier;
+
+  std::vector<TopoBFS> searches;
+
+  std::vector<Vertex> sources;
+  std::vector<size_t> firstSourceOfBatch;
+  std::vector<uint32_t> batchCellIds;
+
+  double graphTime;
+  std::vector<double> levelTimes;
 };
 }  // namespace TripBased
@@ -31,16 +31,20 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/TripBased/Data.h"
 #include "../../TripBased/Query/Profiler.h"
 #include "../../TripBased/Query/ReachedIndex.h"
+#include "../../TripBased/Query/TimestampedReachedIndex.h"
 
 // NOTE: die Länge der extracted paths stimmt nicht, weil ich beim entpacken
 // aufhöre sobald ich etwas sehe was ich vorher bereits schon entpackt habe
 namespace TripBased {
 
-template <typename PROFILER = NoProfiler>
+// REACHED_INDEX is either ReachedIndex or TimestampedReachedIndex
+template <typename PROFILER = NoProfiler,
+          typename REACHED_INDEX = ReachedIndex>
 class TransferSearch {
  public:
   using Profiler = PROFILER;
-  using Type = TransferSearch<Profiler>;
+  using ReachedIndexType = REACHED_INDEX;
+  using Type = TransferSearch<Profiler, ReachedIndexType>;
 
  private:
   struct TripLabel {
@@ -365,7 +369,7 @@ class TransferSearch {
   std::vector<EdgeRange> edgeRanges;
 
   size_t queueSize;
-  ReachedIndex reachedIndex;
+  ReachedIndexType reachedIndex;
 
   std::vector<EdgeLabel> edgeLabels;
   std::vector<RouteLabel> routeLabels;
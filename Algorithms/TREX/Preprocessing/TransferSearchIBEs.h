@@ -30,6 +30,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/RAPTOR/Entities/Journey.h"
 #include "../../../DataStructures/TREX/TREXData.h"
 #include "../../../DataStructures/TripBased/Data.h"
+#include "../../../Helpers/MultiThreading.h"
 #include "../../TripBased/Query/Profiler.h"
 #include "../../TripBased/Query/TimestampedReachedIndex.h"
 
@@ -65,26 +66,6 @@ class TransferSearch {
     Edge end;
   };
 
-  struct EdgeLabel {
-    EdgeLabel(const StopEventId stopEvent = noStopEvent,
-              const TripId trip = noTripId,
-              const StopEventId firstEvent = noStopEvent)
-        : stopEvent(stopEvent), trip(trip), firstEvent(firstEvent) {}
-
-    StopEventId stopEvent;
-    TripId trip;
-    StopEventId firstEvent;
-  };
-
-  struct RouteLabel {
-    RouteLabel() : numberOfTrips(0) {}
-    inline StopIndex end() const noexcept {
-      return StopIndex(departureTimes.size() / numberOfTrips);
-    }
-    u_int32_t numberOfTrips;
-    std::vector<int> departureTimes;
-  };
-
   // Stores the shortcut information, which we insert into the
   // augmentedStopEventGraph we keep track of the number of transfer we hid
   // inside
@@ -114,8 +95,7 @@ class TransferSearch {
         edgeRanges(data.numberOfStopEvents()),
         queueSize(0),
         reachedIndex(data),
-        edgeLabels(data.stopEventGraph.numEdges()),
-        routeLabels(data.numberOfRoutes()),
+        edgeLabels(data.queryTables.edgeLabels),
         toBeUnpacked(data.numberOfStopEvents()),
         fromStopEventId(data.stopEventGraph.numEdges()),
         lastExtractedRun(data.stopEventGraph.numEdges(), 0),
@@ -124,33 +104,11 @@ class TransferSearch {
   /* , totalLengthPfExtractedPaths(0) */
   /* , numAddedShortcuts(0) */
   {
-    for (const auto [edge, from] : data.stopEventGraph.edgesWithFromVertex()) {
-      edgeLabels[edge].stopEvent =
-          StopEventId(data.stopEventGraph.get(ToVertex, edge) + 1);
-      edgeLabels[edge].trip =
-          data.tripOfStopEvent[data.stopEventGraph.get(ToVertex, edge)];
-      edgeLabels[edge].firstEvent =
-          data.firstStopEventOfTrip[edgeLabels[edge].trip];
-
+    AssertMsg(edgeLabels.size() == data.stopEventGraph.numEdges(),
+              "Query tables have not been built!");
+    for (const auto [edge, from] : data.stopEventGraph.edgesWithFromVertex())
       fromStopEventId[edge] = StopEventId(from);
-    }
 
-    for (const RouteId route : data.raptorData.routes()) {
-      const size_t numberOfStops = data.numberOfStopsInRoute(route);
-      const size_t numberOfTrips = data.raptorData.numberOfTripsInRoute(route);
-      const RAPTOR::StopEvent *stopEvents =
-          data.raptorData.firstTripOfRoute(route);
-      routeLabels[route].numberOfTrips = numberOfTrips;
-      routeLabels[route].departureTimes.resize((numberOfStops - 1) *
-                                               numberOfTrips);
-      for (size_t trip = 0; trip < numberOfTrips; trip++) {
-        for (size_t stopIndex = 0; stopIndex + 1 < numberOfStops; stopIndex++) {
-          routeLabels[route]
-              .departureTimes[(stopIndex * numberOfTrips) + trip] =
-              stopEvents[(trip * numberOfStops) + stopIndex].departureTime;
-        }
-      }
-    }
     profiler.registerPhases({PHASE_SCAN_TRIPS});
     profiler.registerMetrics({METRIC_ROUNDS, METRIC_SCANNED_TRIPS,
                               METRIC_SCANNED_STOPS, METRIC_RELAXED_TRANSFERS,
@@ -169,6 +127,7 @@ class TransferSearch {
     clear();
 
     minLevel = newLevel;
+    cellShift = data.getCellShift(newLevel);
     currentCellId =
         data.getCellIdOfStop(data.getStop(trip, StopIndex(stopIndex + 1)));
 
@@ -250,7 +209,7 @@ class TransferSearch {
 
   inline bool isStopInCell(StopId stop) const {
     AssertMsg(data.isStop(stop), "Stop is not a valid stop!");
-    return !((data.getCellIdOfStop(stop) ^ currentCellId) >> minLevel);
+    return !((data.getCellIdOfStop(stop) ^ currentCellId) >> cellShift);
   }
 
   inline void enqueue(const TripId trip, const StopIndex index) noexcept {
@@ -266,28 +225,28 @@ class TransferSearch {
 
   inline void enqueue(const Edge edge, const size_t parent) noexcept {
     profiler.countMetric(METRIC_ENQUEUES);
-    const EdgeLabel &label = edgeLabels[edge];
+    const TREXQueryTables::EdgeLabel &label = edgeLabels[edge];
 
     // break if a) already reached OR b) the stop if this transfer is not in the
     // same cell
-    if (reachedIndex.alreadyReached(label.trip,
-                                    label.stopEvent - label.firstEvent) ||
-        !isStopInCell(data.getStop(
-            label.trip, StopIndex(label.stopEvent - label.firstEvent - 1))))
+    if (reachedIndex.alreadyReached(label.trip, label.stopEvent) ||
+        !isStopInCell(
+            data.getStop(label.trip, StopIndex(label.stopEvent - 1))))
         [[likely]]
       return;
 
-    if (minLevel > data.stopEventGraph.get(LocalLevel, edge)) [[likely]]
+    // other threads may raise the level concurrently (only to minLevel + 1)
+    if (minLevel > atomicLoad(data.stopEventGraph.get(LocalLevel, edge)))
+        [[likely]]
       return;
 
     queue[queueSize] = TripLabel(
-        label.stopEvent,
+        StopEventId(label.firstEvent + label.stopEvent),
         StopEventId(label.firstEvent + reachedIndex(label.trip)), parent, edge);
 
     queueSize++;
     AssertMsg(queueSize <= queue.size(), "Queue is overfull!");
-    reachedIndex.update(label.trip,
-                        StopIndex(label.stopEvent - label.firstEvent));
+    reachedIndex.update(label.trip, label.stopEvent);
   }
 
   // all marked events which we want to marks as local for the next level
@@ -341,11 +300,14 @@ class TransferSearch {
       /* fromVertex = fromStopEventId[currentEdge]; */
       /* currentHopCounter += data.stopEventGraph.get(Hop, currentEdge); */
 
-      data.stopEventGraph.set(LocalLevel, currentEdge, minLevel + 1);
+      // several threads may unpack the same transfer, hence the levels are
+      // only ever raised atomically
+      atomicMax(data.stopEventGraph.get(LocalLevel, currentEdge),
+                uint8_t(minLevel + 1));
 
       // set the locallevel of the events
       StopEventId e = fromStopEventId[currentEdge];
-      data.getLocalLevelOfEvent(e) = minLevel + 1;
+      atomicMax(data.getLocalLevelOfEvent(e), uint8_t(minLevel + 1));
 
       index = label.parent;
       label = queue[index];
@@ -402,11 +364,12 @@ class TransferSearch {
   size_t queueSize;
   TimestampedReachedIndex reachedIndex;
 
-  std::vector<EdgeLabel> edgeLabels;
-  std::vector<RouteLabel> routeLabels;
+  // shared with the queries, see TREXQueryTables
+  const std::vector<TREXQueryTables::EdgeLabel> &edgeLabels;
 
   uint8_t minLevel;
-  uint16_t currentCellId;
+  uint8_t cellShift;
+  uint32_t currentCellId;
 
   Profiler profiler;
 
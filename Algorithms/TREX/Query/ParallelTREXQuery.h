@@ -0,0 +1,169 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <omp.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../../../DataStructures/Queries/Queries.h"
+#include "../../../DataStructures/TREX/MappedTREXData.h"
+#include "../../../DataStructures/TREX/TREXData.h"
+#include "../../../Helpers/MultiThreading.h"
+#include "../../../Helpers/Timer.h"
+#include "../../../Helpers/Vector/Vector.h"
+#include "TREXQuery.h"
+
+namespace TripBased {
+
+// Answers a batch of independent TREX queries with several threads. All
+// workers share the query tables of the data; every worker (one per thread)
+// only owns the scratch memory of its search. DATA is either the TREXData or
+// the memory mapped MappedTREXData, EDGE_LAYOUT is passed to the TREXQuery.
+template <typename DATA = TREXData, typename EDGE_LAYOUT = PaddedEdgeLayout>
+class ParallelTREXQuery {
+ public:
+  using DataType = DATA;
+  using EdgeLayout = EDGE_LAYOUT;
+  using Query = TREXQuery<NoProfiler, DataType, EdgeLayout>;
+
+  struct Result {
+    Result() : arrivalTime(INFTY), numberOfJourneys(0), queryTime(0) {}
+
+    int arrivalTime;
+    size_t numberOfJourneys;
+    double queryTime;
+  };
+
+  ParallelTREXQuery(const DataType &data, const int numberOfThreads,
+                    const int pinMultiplier = 1)
+      : data(data),
+        numberOfThreads(std::max(numberOfThreads, 1)),
+        pinMultiplier(pinMultiplier),
+        totalTime(0) {
+    workers.reserve(this->numberOfThreads);
+    for (int i = 0; i < this->numberOfThreads; ++i) {
+      workers.emplace_back(data);
+    }
+  }
+
+  inline void run(const std::vector<StopQuery> &queries) noexcept {
+    results.assign(queries.size(), Result());
+
+    const int numCores = numberOfCores();
+    omp_set_num_threads(numberOfThreads);
+
+    Timer timer;
+#pragma omp parallel
+    {
+      const int threadId = omp_get_thread_num();
+      pinThreadToCoreId((threadId * pinMultiplier) % numCores);
+      AssertMsg(omp_get_num_threads() == numberOfThreads,
+                "Number of threads is " << omp_get_num_threads()
+                                        << ", but should be " << numberOfThreads
+                                        << "!");
+
+      Query &query = workers[threadId];
+      Timer queryTimer;
+
+#pragma omp for schedule(dynamic, 8)
+      for (size_t i = 0; i < queries.size(); ++i) {
+        queryTimer.restart();
+        query.run(queries[i].source, queries[i].departureTime,
+                  queries[i].target);
+        results[i].arrivalTime = query.getEarliestArrivalTime();
+        results[i].numberOfJourneys = query.getJourneys().size();
+        results[i].queryTime = queryTimer.elapsedMicroseconds();
+      }
+    }
+    totalTime = timer.elapsedMicroseconds();
+  }
+
+  inline const std::vector<Result> &getResults() const noexcept {
+    return results;
+  }
+
+  // Wall clock time of the last batch in microseconds
+  inline double getTotalTime() const noexcept { return totalTime; }
+
+  inline double getThroughput() const noexcept {
+    if (totalTime <= 0) return 0;
+    return results.size() / (totalTime / 1000000.0);
+  }
+
+  // Sorted latencies (in microseconds) of the last batch
+  inline std::vector<double> getSortedQueryTimes() const noexcept {
+    std::vector<double> queryTimes;
+    queryTimes.reserve(results.size());
+    for (const Result &result : results) {
+      queryTimes.emplace_back(result.queryTime);
+    }
+    std::sort(queryTimes.begin(), queryTimes.end());
+    return queryTimes;
+  }
+
+  inline void printStatistics() const noexcept {
+    if (results.empty()) return;
+    const std::vector<double> queryTimes = getSortedQueryTimes();
+    double numberOfJourneys = 0;
+    for (const Result &result : results) {
+      numberOfJourneys += result.numberOfJourneys;
+    }
+    std::cout << "Threads: " << numberOfThreads << std::endl;
+    std::cout << "Queries: " << String::prettyInt(results.size()) << std::endl;
+    std::cout << "Wall time: " << String::musToString(totalTime) << std::endl;
+    std::cout << "Throughput: " << String::prettyDouble(getThroughput())
+              << " queries/s" << std::endl;
+    std::cout << "Avg. latency: "
+              << String::musToString(Vector::mean(queryTimes)) << std::endl;
+    std::cout << "p50 latency: "
+              << String::musToString(Vector::percentile(queryTimes, 0.5))
+              << std::endl;
+    std::cout << "p99 latency: "
+              << String::musToString(Vector::percentile(queryTimes, 0.99))
+              << std::endl;
+    std::cout << "Max latency: " << String::musToString(queryTimes.back())
+              << std::endl;
+    std::cout << "Avg. journeys: "
+              << String::prettyDouble(numberOfJourneys / results.size())
+              << std::endl;
+    std::cout << "Shared query tables: "
+              << String::bytesToString(data.queryTables.byteSize())
+              << std::endl;
+  }
+
+ private:
+  const DataType &data;
+
+  const int numberOfThreads;
+  const int pinMultiplier;
+
+  std::vector<Query> workers;
+  std::vector<Result> results;
+  double totalTime;
+};
+
+}  // namespace TripBased
@@ -0,0 +1,151 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <omp.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../../../DataStructures/TREX/MappedTREXData.h"
+#include "../../../DataStructures/TREX/TREXData.h"
+#include "../../../Helpers/Assert.h"
+#include "../../../Helpers/MultiThreading.h"
+#include "../../../Helpers/Timer.h"
+#include "TREXOneToManyQuery.h"
+
+namespace TripBased {
+
+// Travel time matrix from many origins to many destinations for one departure
+// time. The origins are distributed over the threads, every worker runs one
+// TREXOneToManyQuery per origin towards all destinations. DATA is either the
+// TREXData or the memory mapped MappedTREXData.
+template <typename DATA = TREXData>
+class TREXMatrixQuery {
+ public:
+  using DataType = DATA;
+  using Query = TREXOneToManyQuery<NoProfiler, DataType>;
+
+  // entry of unreachable destinations
+  static constexpr int32_t Unreachable = -1;
+
+  TREXMatrixQuery(const DataType &data, const int numberOfThreads,
+                  const int pinMultiplier = 1)
+      : data(data),
+        numberOfThreads(std::max(numberOfThreads, 1)),
+        pinMultiplier(pinMultiplier),
+        numberOfOrigins(0),
+        numberOfDestinations(0),
+        totalTime(0) {
+    workers.reserve(this->numberOfThreads);
+    for (int i = 0; i < this->numberOfThreads; ++i) {
+      workers.emplace_back(data);
+    }
+  }
+
+  inline void run(const std::vector<StopId> &origins,
+                  const std::vector<StopId> &destinations,
+                  const int departureTime) noexcept {
+    numberOfOrigins = origins.size();
+    numberOfDestinations = destinations.size();
+    matrix.assign(numberOfOrigins * numberOfDestinations, Unreachable);
+
+    const int numCores = numberOfCores();
+    omp_set_num_threads(numberOfThreads);
+
+    Timer timer;
+#pragma omp parallel
+    {
+      const int threadId = omp_get_thread_num();
+      pinThreadToCoreId((threadId * pinMultiplier) % numCores);
+      AssertMsg(omp_get_num_threads() == numberOfThreads,
+                "Number of threads is " << omp_get_num_threads()
+                                        << ", but should be " << numberOfThreads
+                                        << "!");
+
+      Query &query = workers[threadId];
+      query.setTargets(destinations);
+
+#pragma omp for schedule(dynamic, 1)
+      for (size_t i = 0; i < origins.size(); ++i) {
+        query.run(origins[i], departureTime);
+        const std::vector<int> &arrivalTimes = query.getArrivalTimes();
+        int32_t *row = matrix.data() + (i * numberOfDestinations);
+        for (size_t j = 0; j < numberOfDestinations; ++j) {
+          if (arrivalTimes[j] >= INFTY) continue;
+          row[j] = arrivalTimes[j] - departureTime;
+        }
+      }
+    }
+    totalTime = timer.elapsedMicroseconds();
+  }
+
+  // Travel time (in seconds) from origins[i] to destinations[j], or
+  // Unreachable
+  inline int32_t travelTime(const size_t i, const size_t j) const noexcept {
+    AssertMsg(i < numberOfOrigins, "Origin " << i << " is out of bounds!");
+    AssertMsg(j < numberOfDestinations,
+              "Destination " << j << " is out of bounds!");
+    return matrix[(i * numberOfDestinations) + j];
+  }
+
+  inline const std::vector<int32_t> &getMatrix() const noexcept {
+    return matrix;
+  }
+
+  // Wall clock time of the last run in microseconds
+  inline double getTotalTime() const noexcept { return totalTime; }
+
+  // Binary format: number of origins and number of destinations (uint64_t
+  // each), followed by the row major int32_t travel times
+  inline void writeBinary(const std::string &fileName) const noexcept {
+    std::ofstream os(fileName, std::ios::binary);
+    Ensure(os.is_open(), "Cannot create output stream for: " << fileName);
+    const uint64_t rows = numberOfOrigins;
+    const uint64_t columns = numberOfDestinations;
+    os.write(reinterpret_cast<const char *>(&rows), sizeof(uint64_t));
+    os.write(reinterpret_cast<const char *>(&columns), sizeof(uint64_t));
+    os.write(reinterpret_cast<const char *>(matrix.data()),
+             matrix.size() * sizeof(int32_t));
+    Ensure(os.good(), "Could not write file: " << fileName);
+  }
+
+ private:
+  const DataType &data;
+
+  const int numberOfThreads;
+  const int pinMultiplier;
+
+  std::vector<Query> workers;
+
+  size_t numberOfOrigins;
+  size_t numberOfDestinations;
+  std::vector<int32_t> matrix;
+  double totalTime;
+};
+
+}  // namespace TripBased
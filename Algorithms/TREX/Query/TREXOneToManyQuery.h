@@ -0,0 +1,421 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../../../DataStructures/Container/Set.h"
+#include "../../../DataStructures/TREX/TREXData.h"
+#include "../../../DataStructures/TREX/TREXQueryTables.h"
+#include "../../TripBased/Query/Profiler.h"
+#include "../../TripBased/Query/ReachedIndex.h"
+
+namespace TripBased {
+
+// Earliest arrival TREX query from one source stop to a set of target stops.
+// A transfer is relaxed if it is local w.r.t. the cell of the source or w.r.t.
+// the cell of any target, i.e., the pruning of the TREXQuery with the union of
+// the cell id prefixes of all targets. DATA is either the TREXData or the
+// memory mapped MappedTREXData.
+template <typename PROFILER = NoProfiler, typename DATA = TREXData>
+class TREXOneToManyQuery {
+ public:
+  using Profiler = PROFILER;
+  using DataType = DATA;
+  using QueryTables = typename DataType::QueryTables;
+  using Type = TREXOneToManyQuery<Profiler, DataType>;
+
+ private:
+  struct TripLabel {
+    TripLabel(const StopEventId begin = noStopEvent,
+              const StopEventId end = noStopEvent)
+        : begin(begin), end(end) {}
+    StopEventId begin;
+    StopEventId end;
+  };
+
+  struct EdgeRange {
+    EdgeRange() : begin(noEdge), end(noEdge) {}
+    Edge begin;
+    Edge end;
+  };
+
+  using EdgeLabel = TREXQueryTables::EdgeLabel;
+  using RouteLabel = TREXQueryTables::RouteLabel;
+
+  // final transfer of a stop to the target with the given index
+  struct TargetTransfer {
+    TargetTransfer(const u_int32_t target = -1, const int travelTime = INFTY)
+        : target(target), travelTime(travelTime) {}
+    u_int32_t target;
+    int travelTime;
+  };
+
+ public:
+  TREXOneToManyQuery(const DataType &data)
+      : data(data),
+        tables(data.queryTables),
+        transferFromSource(data.numberOfStops(), INFTY),
+        lastSource(StopId(0)),
+        transfersToTargets(data.numberOfStops()),
+        firstCellOfShift(33, 0),
+        reachedRoutes(data.numberOfRoutes()),
+        queue(data.numberOfStopEvents()),
+        edgeRanges(data.numberOfStopEvents()),
+        queueSize(0),
+        reachedIndex(data),
+        numberOfUnreachedTargets(0),
+        maxArrivalTime(INFTY),
+        sourceStop(noStop),
+        sourceCellId(0),
+        sourceDepartureTime(never) {
+    AssertMsg(tables.isBuilt(), "The query tables have not been built!");
+    uint32_t maxCellId = 0;
+    for (StopId stop(0); stop < data.numberOfStops(); ++stop) {
+      maxCellId = std::max<uint32_t>(maxCellId, data.getCellIdOfStop(stop));
+    }
+    // only shifts of whole levels occur, the other shifts get no cells
+    for (int level = 0; level <= data.getNumberOfLevels(); ++level) {
+      const int shift = data.getCellShift(level);
+      firstCellOfShift[shift + 1] = (maxCellId >> shift) + 1;
+    }
+    for (size_t shift = 1; shift < firstCellOfShift.size(); ++shift) {
+      firstCellOfShift[shift] += firstCellOfShift[shift - 1];
+    }
+    isTargetCell.assign(firstCellOfShift.back(), false);
+    profiler.registerPhases(
+        {PHASE_SCAN_INITIAL, PHASE_EVALUATE_INITIAL, PHASE_SCAN_TRIPS});
+    profiler.registerMetrics({METRIC_ROUNDS, METRIC_SCANNED_TRIPS,
+                              METRIC_SCANNED_STOPS, METRIC_RELAXED_TRANSFERS,
+                              METRIC_ENQUEUES, METRIC_ADD_JOURNEYS,
+                              DISCARDED_EDGE});
+  }
+
+  // The targets stay the same for all following runs
+  inline void setTargets(const std::vector<StopId> &newTargets) noexcept {
+    for (const StopId target : targets) {
+      transfersToTargets[target].clear();
+      for (const Edge edge : tables.reverseTransferGraph.edgesFrom(target)) {
+        transfersToTargets[tables.reverseTransferGraph.get(ToVertex, edge)]
+            .clear();
+      }
+      for (int level = 0; level <= data.getNumberOfLevels(); ++level) {
+        isTargetCell[cellIndex(data.getCellIdOfStop(target),
+                               data.getCellShift(level))] = false;
+      }
+    }
+
+    targets = newTargets;
+    for (u_int32_t i = 0; i < targets.size(); ++i) {
+      const StopId target = targets[i];
+      AssertMsg(data.isStop(target), "Target " << target << " is not a stop!");
+      transfersToTargets[target].emplace_back(i, 0);
+      for (const Edge edge : tables.reverseTransferGraph.edgesFrom(target)) {
+        transfersToTargets[tables.reverseTransferGraph.get(ToVertex, edge)]
+            .emplace_back(i, tables.reverseTransferGraph.get(TravelTime, edge));
+      }
+      for (int level = 0; level <= data.getNumberOfLevels(); ++level) {
+        isTargetCell[cellIndex(data.getCellIdOfStop(target),
+                               data.getCellShift(level))] = true;
+      }
+    }
+    arrivalTimes.assign(targets.size(), INFTY);
+  }
+
+  inline void run(const Vertex source, const int departureTime) noexcept {
+    AssertMsg(data.isStop(source), "Source " << source << " is not a stop!");
+    run(StopId(source), departureTime);
+  }
+
+  inline void run(const StopId source, const int departureTime) noexcept {
+    profiler.start();
+    clear();
+    sourceStop = source;
+    sourceCellId = data.getCellIdOfStop(sourceStop);
+    sourceDepartureTime = departureTime;
+
+    computeInitialTransfers();
+    evaluateInitialTransfers();
+    scanTrips(16);
+    profiler.done();
+  }
+
+  inline const std::vector<StopId> &getTargets() const noexcept {
+    return targets;
+  }
+
+  // Earliest arrival time at every target (in the order of the targets), or
+  // INFTY if the target is not reachable
+  inline const std::vector<int> &getArrivalTimes() const noexcept {
+    return arrivalTimes;
+  }
+
+  inline Profiler &getProfiler() noexcept { return profiler; }
+
+ private:
+  inline size_t cellIndex(const uint32_t cellId,
+                          const int shift) const noexcept {
+    return firstCellOfShift[shift] + (cellId >> shift);
+  }
+
+  inline void clear() noexcept {
+    queueSize = 0;
+    reachedIndex.clear();
+    std::fill(arrivalTimes.begin(), arrivalTimes.end(), INFTY);
+    numberOfUnreachedTargets = targets.size();
+    maxArrivalTime = INFTY;
+  }
+
+  inline void computeInitialTransfers() noexcept {
+    profiler.startPhase();
+    transferFromSource[lastSource] = INFTY;
+    for (const Edge edge :
+         data.raptorData.transferGraph.edgesFrom(lastSource)) {
+      const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
+      transferFromSource[stop] = INFTY;
+    }
+    transferFromSource[sourceStop] = 0;
+    for (const Edge edge :
+         data.raptorData.transferGraph.edgesFrom(sourceStop)) {
+      const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
+      transferFromSource[stop] =
+          data.raptorData.transferGraph.get(TravelTime, edge);
+    }
+    for (const TargetTransfer &transfer : transfersToTargets[sourceStop]) {
+      addArrivalTime(transfer.target,
+                     sourceDepartureTime + transfer.travelTime);
+    }
+    lastSource = sourceStop;
+    profiler.donePhase(PHASE_SCAN_INITIAL);
+  }
+
+  inline void evaluateInitialTransfers() noexcept {
+    profiler.startPhase();
+    reachedRoutes.clear();
+    for (const RAPTOR::RouteSegment &route :
+         data.raptorData.routesContainingStop(sourceStop)) {
+      reachedRoutes.insert(route.routeId);
+    }
+    for (const Edge edge :
+         data.raptorData.transferGraph.edgesFrom(sourceStop)) {
+      const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
+      for (const RAPTOR::RouteSegment &route :
+           data.raptorData.routesContainingStop(StopId(stop))) {
+        reachedRoutes.insert(route.routeId);
+      }
+    }
+    reachedRoutes.sort();
+    auto &routesToLoopOver = reachedRoutes.getValues();
+    for (size_t i(0); i < routesToLoopOver.size(); ++i) {
+      const RouteId route = routesToLoopOver[i];
+
+#ifdef ENABLE_PREFETCH
+      if (i + 4 < routesToLoopOver.size()) {
+        __builtin_prefetch(
+            tables.departureTimesOfRoute(routesToLoopOver[i + 4]));
+        __builtin_prefetch(&data.firstTripOfRoute[routesToLoopOver[i + 4]]);
+      }
+#endif
+      const RouteLabel label = tables.routeLabel(route);
+      const StopIndex endIndex = label.end();
+      const TripId firstTrip = data.firstTripOfRoute[route];
+      const StopId *stops = data.raptorData.stopArrayOfRoute(route);
+      TripId tripIndex = noTripId;
+      for (StopIndex stopIndex(0); stopIndex < endIndex; stopIndex++) {
+        const int timeFromSource = transferFromSource[stops[stopIndex]];
+        if (timeFromSource == INFTY) continue;
+        const int stopDepartureTime = sourceDepartureTime + timeFromSource;
+        const u_int32_t labelIndex = stopIndex * label.numberOfTrips;
+        if (tripIndex >= label.numberOfTrips) {
+          tripIndex = std::lower_bound(
+              TripId(0), TripId(label.numberOfTrips), stopDepartureTime,
+              [&](const TripId trip, const int time) {
+                return label.departureTimes[labelIndex + trip] < time;
+              });
+          if (tripIndex >= label.numberOfTrips) continue;
+        } else {
+          if (label.departureTimes[labelIndex + tripIndex - 1] <
+              stopDepartureTime)
+            continue;
+          --tripIndex;
+          while ((tripIndex > 0) &&
+                 (label.departureTimes[labelIndex + tripIndex - 1] >=
+                  stopDepartureTime)) {
+            --tripIndex;
+          }
+        }
+        enqueue(firstTrip + tripIndex, StopIndex(stopIndex + 1));
+        if (tripIndex == 0) break;
+      }
+    }
+    profiler.donePhase(PHASE_EVALUATE_INITIAL);
+  }
+
+  inline void scanTrips(const uint8_t MAX_ROUNDS = 16) noexcept {
+    profiler.startPhase();
+    u_int8_t currentRoundNumber = 0;
+    size_t roundBegin = 0;
+    size_t roundEnd = queueSize;
+    while (roundBegin < roundEnd && currentRoundNumber < MAX_ROUNDS) {
+      ++currentRoundNumber;
+      profiler.countMetric(METRIC_ROUNDS);
+      // Evaluate final transfers in order to check which targets are
+      // reachable
+      for (size_t i = roundBegin; i < roundEnd; ++i) {
+#ifdef ENABLE_PREFETCH
+        if (i + 4 < roundEnd) {
+          __builtin_prefetch(&data.arrivalEvents[queue[i + 4].begin]);
+        }
+#endif
+        const TripLabel &label = queue[i];
+        profiler.countMetric(METRIC_SCANNED_TRIPS);
+        for (StopEventId j = label.begin; j < label.end; j++) {
+          profiler.countMetric(METRIC_SCANNED_STOPS);
+          const int arrivalTime = data.arrivalEvents[j].arrivalTime;
+          if (arrivalTime >= maxArrivalTime) break;
+          for (const TargetTransfer &transfer :
+               transfersToTargets[data.arrivalEvents[j].stop]) {
+            addArrivalTime(transfer.target, arrivalTime + transfer.travelTime);
+          }
+        }
+      }
+      // a trip segment is irrelevant once it cannot improve any target
+      if (numberOfUnreachedTargets == 0) {
+        maxArrivalTime =
+            *std::max_element(arrivalTimes.begin(), arrivalTimes.end());
+      }
+      // Find the range of transfers for each trip
+      for (size_t i = roundBegin; i < roundEnd; i++) {
+#ifdef ENABLE_PREFETCH
+        if (i + 4 < roundEnd) {
+          __builtin_prefetch(&data.arrivalEvents[queue[i + 4].begin]);
+          __builtin_prefetch(&edgeRanges[i + 4]);
+        }
+#endif
+        TripLabel &label = queue[i];
+        for (StopEventId j = label.begin; j < label.end; j++) {
+          if (data.arrivalEvents[j].arrivalTime >= maxArrivalTime) {
+            label.end = j;
+            break;
+          }
+        }
+        edgeRanges[i].begin =
+            data.stopEventGraph.beginEdgeFrom(Vertex(label.begin));
+        edgeRanges[i].end =
+            data.stopEventGraph.beginEdgeFrom(Vertex(label.end));
+      }
+      // Relax the transfers for each trip
+      for (size_t i = roundBegin; i < roundEnd; i++) {
+        const EdgeRange &label = edgeRanges[i];
+        for (Edge edge = label.begin; edge < label.end; edge++) {
+          profiler.countMetric(METRIC_RELAXED_TRANSFERS);
+          enqueue(edge);
+        }
+      }
+
+      roundBegin = roundEnd;
+      roundEnd = queueSize;
+    }
+    profiler.donePhase(PHASE_SCAN_TRIPS);
+  }
+
+  inline void enqueue(const TripId trip, const StopIndex index) noexcept {
+    profiler.countMetric(METRIC_ENQUEUES);
+    if (reachedIndex.alreadyReached(trip, index)) return;
+    const StopEventId firstEvent = data.firstStopEventOfTrip[trip];
+    queue[queueSize] = TripLabel(StopEventId(firstEvent + index),
+                                 StopEventId(firstEvent + reachedIndex(trip)));
+    ++queueSize;
+    AssertMsg(queueSize <= queue.size(), "Queue is overfull!");
+    reachedIndex.update(trip, index);
+  }
+
+  inline void enqueue(const Edge edge) noexcept {
+    profiler.countMetric(METRIC_ENQUEUES);
+    const EdgeLabel &label = tables.edgeLabels[edge];
+
+    if (reachedIndex.alreadyReached(label.trip, label.stopEvent)) [[likely]]
+      return;
+
+    if (((label.cellId ^ sourceCellId) >> label.cellShift) &&
+        !isTargetCell[cellIndex(label.cellId, label.cellShift)]) [[likely]] {
+      profiler.countMetric(DISCARDED_EDGE);
+      reachedIndex.update(label.trip, StopIndex(label.stopEvent));
+      return;
+    }
+
+    queue[queueSize] = TripLabel(
+        StopEventId(label.stopEvent + label.firstEvent),
+        StopEventId(label.firstEvent + reachedIndex(label.trip)));
+    ++queueSize;
+    AssertMsg(queueSize <= queue.size(), "Queue is overfull!");
+    reachedIndex.update(label.trip, StopIndex(label.stopEvent));
+  }
+
+  inline void addArrivalTime(const u_int32_t target,
+                             const int arrivalTime) noexcept {
+    profiler.countMetric(METRIC_ADD_JOURNEYS);
+    if (arrivalTime >= arrivalTimes[target]) return;
+    if (arrivalTimes[target] == INFTY) --numberOfUnreachedTargets;
+    arrivalTimes[target] = arrivalTime;
+  }
+
+ private:
+  const DataType &data;
+
+  const QueryTables &tables;
+
+  std::vector<int> transferFromSource;
+  StopId lastSource;
+
+  std::vector<StopId> targets;
+  std::vector<std::vector<TargetTransfer>> transfersToTargets;
+
+  // isTargetCell[firstCellOfShift[s] + (cellId >> s)] <=> a target lies in the
+  // cell with this id prefix, s being the cell shift of a level
+  std::vector<size_t> firstCellOfShift;
+  std::vector<uint8_t> isTargetCell;
+
+  IndexedSet<false, RouteId> reachedRoutes;
+
+  std::vector<TripLabel> queue;
+  std::vector<EdgeRange> edgeRanges;
+  size_t queueSize;
+  ReachedIndex reachedIndex;
+
+  std::vector<int> arrivalTimes;
+  size_t numberOfUnreachedTargets;
+  int maxArrivalTime;
+
+  StopId sourceStop;
+  uint32_t sourceCellId;
+  int sourceDepartureTime;
+
+  Profiler profiler;
+};
+
+}  // namespace TripBased
@@ -24,11 +24,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
 #include "../../../DataStructures/Container/Set.h"
 #include "../../../DataStructures/RAPTOR/Entities/ArrivalLabel.h"
 #include "../../../DataStructures/RAPTOR/Entities/Journey.h"
 #include "../../../DataStructures/RAPTOR/Entities/RouteSegment.h"
 #include "../../../DataStructures/TREX/TREXData.h"
+#include "../../../DataStructures/TREX/TREXQueryTables.h"
 #include "../../../Helpers/String/String.h"
 
 #ifdef USE_SIMD
@@ -64,31 +69,8 @@ class TREXProfileQuery {
     Edge end;
   };
 
-  struct EdgeLabel {
-    EdgeLabel(const StopEventId stopEvent = noStopEvent,
-              const TripId trip = noTripId,
-              const StopEventId firstEvent = noStopEvent,
-              const uint16_t cellId = 0, const uint8_t localLevel = 0)
-        : stopEvent(stopEvent),
-          trip(trip),
-          firstEvent(firstEvent),
-          cellId(cellId),
-          localLevel(localLevel) {}
-    StopEventId stopEvent;
-    TripId trip;
-    StopEventId firstEvent;
-    uint16_t cellId;
-    uint8_t localLevel;
-  };
-
-  struct RouteLabel {
-    RouteLabel() : numberOfTrips(0) {}
-    inline StopIndex end() const noexcept {
-      return StopIndex(departureTimes.size() / numberOfTrips);
-    }
-    u_int32_t numberOfTrips;
-    std::vector<int> departureTimes;
-  };
+  using EdgeLabel = TREXQueryTables::EdgeLabel;
+  using RouteLabel = TREXQueryTables::RouteLabel;
 
   struct TargetLabel {
     TargetLabel(const int arrivalTime = INFTY, const u_int32_t parent = -1)
@@ -117,7 +99,7 @@ class TREXProfileQuery {
  public:
   TREXProfileQuery(const TREXData &data)
       : data(data),
-        reverseTransferGraph(data.raptorData.transferGraph),
+        tables(data.queryTables),
         transferFromSource(data.numberOfStops(), INFTY),
         transferToTarget(data.numberOfStops(), INFTY),
         lastSource(StopId(0)),
@@ -129,44 +111,15 @@ class TREXProfileQuery {
         reachedIndex(data),
         targetLabels(1),
         minArrivalTimeFastLookUp(16, INFTY),
-        edgeLabels(data.stopEventGraph.numEdges()),
         sourceStop(noStop),
         targetStop(noStop),
         minDepartureTime(never),
         maxDepartureTime(never),
-        targetLabelChanged(16, false),
-        routeLabels(data.stopEventGraph.numEdges()) {
+        targetLabelChanged(16, false) {
     collectedDepTimes.reserve(
         data.raptorData.numberOfTrips());  // can be adjusted
     allJourneys.reserve(32);
-    reverseTransferGraph.revert();
-    for (const auto [edge, from] : data.stopEventGraph.edgesWithFromVertex()) {
-      edgeLabels[edge].stopEvent =
-          StopEventId(data.stopEventGraph.get(ToVertex, edge) + 1);
-      edgeLabels[edge].trip =
-          data.tripOfStopEvent[data.stopEventGraph.get(ToVertex, edge)];
-      edgeLabels[edge].firstEvent =
-          data.firstStopEventOfTrip[edgeLabels[edge].trip];
-      edgeLabels[edge].localLevel = data.stopEventGraph.get(LocalLevel, edge);
-      edgeLabels[edge].cellId = ((uint16_t)data.getCellIdOfStop(
-          data.getStopOfStopEvent(StopEventId(from))));
-    }
-    for (const RouteId route : data.raptorData.routes()) {
-      const size_t numberOfStops = data.numberOfStopsInRoute(route);
-      const size_t numberOfTrips = data.raptorData.numberOfTripsInRoute(route);
-      const RAPTOR::StopEvent *stopEvents =
-          data.raptorData.firstTripOfRoute(route);
-      routeLabels[route].numberOfTrips = numberOfTrips;
-      routeLabels[route].departureTimes.resize((numberOfStops - 1) *
-                                               numberOfTrips);
-      for (size_t trip = 0; trip < numberOfTrips; trip++) {
-        for (size_t stopIndex = 0; stopIndex + 1 < numberOfStops; stopIndex++) {
-          routeLabels[route]
-              .departureTimes[(stopIndex * numberOfTrips) + trip] =
-              stopEvents[(trip * numberOfStops) + stopIndex].departureTime;
-        }
-      }
-    }
+    AssertMsg(tables.isBuilt(), "The query tables have not been built!");
 
     profiler.registerPhases(
         {PHASE_SCAN_INITIAL, PHASE_COLLECT_DEPTIMES, PHASE_SCAN_TRIPS});
@@ -200,6 +153,8 @@ class TREXProfileQuery {
     // clear everything
     clear();
     computeInitialAndFinalTransfers();
+    // the journeys departing at the end of the time window (or later) prune the
+    // ones departing within the window, just like in rRAPTOR
     evaluateInitialTransfers();
     scanTrips();
     journeyOfRound = getJourneys();
@@ -249,13 +204,14 @@ class TREXProfileQuery {
     for (size_t i = 0; i < valuesToLoopOver.size(); ++i) {
 #ifdef ENABLE_PREFETCH
       if (i + 4 < valuesToLoopOver.size()) {
-        __builtin_prefetch(&(routeLabels[valuesToLoopOver[i + 4]]));
+        __builtin_prefetch(
+            tables.departureTimesOfRoute(valuesToLoopOver[i + 4]));
         __builtin_prefetch(&(data.firstTripOfRoute[valuesToLoopOver[i + 4]]));
       }
 #endif
 
       const RouteId route = valuesToLoopOver[i];
-      const RouteLabel &label = routeLabels[route];
+      const RouteLabel label = tables.routeLabel(route);
       const StopIndex endIndex = label.end();
       const TripId firstTrip = data.firstTripOfRoute[route];
       const StopId *stops = data.raptorData.stopArrayOfRoute(route);
@@ -263,7 +219,7 @@ class TREXProfileQuery {
       for (StopIndex stopIndex(0); stopIndex < endIndex; stopIndex++) {
         const int timeFromSource = transferFromSource[stops[stopIndex]];
         if (timeFromSource == INFTY) continue;
-        const int stopDepartureTime = 24 * 60 * 60 + timeFromSource;
+        const int stopDepartureTime = maxDepartureTime + timeFromSource;
         const u_int32_t labelIndex = stopIndex * label.numberOfTrips;
         if (tripIndex >= label.numberOfTrips) {
           tripIndex = std::lower_bound(
@@ -299,6 +255,56 @@ class TREXProfileQuery {
     return allJourneys;
   }
 
+  // The journeys departing within [minDepartureTime, maxDepartureTime), which
+  // are Pareto optimal w.r.t. departure time (later is better), arrival time
+  // and number of trips
+  inline std::vector<RAPTOR::Journey> getParetoJourneys() const noexcept {
+    struct Criteria {
+      int departureTime;
+      int arrivalTime;
+      size_t numberOfTrips;
+      size_t index;
+    };
+    std::vector<Criteria> candidates;
+    for (size_t i = 0; i < allJourneys.size(); ++i) {
+      const RAPTOR::Journey &journey = allJourneys[i];
+      if (journey.empty()) continue;
+      const int departureTime = journey.front().departureTime;
+      if (departureTime < minDepartureTime ||
+          departureTime >= maxDepartureTime)
+        continue;
+      const size_t numberOfTrips =
+          std::count_if(journey.begin(), journey.end(),
+                        [](const RAPTOR::JourneyLeg &leg) {
+                          return leg.usesRoute;
+                        });
+      candidates.push_back(
+          {departureTime, journey.back().arrivalTime, numberOfTrips, i});
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Criteria &a, const Criteria &b) {
+                return std::tie(b.departureTime, a.arrivalTime,
+                                a.numberOfTrips) <
+                       std::tie(a.departureTime, b.arrivalTime,
+                                b.numberOfTrips);
+              });
+
+    // every kept journey departs at least as late as the current candidate
+    std::vector<Criteria> kept;
+    std::vector<RAPTOR::Journey> result;
+    for (const Criteria &candidate : candidates) {
+      const bool dominated = std::any_of(
+          kept.begin(), kept.end(), [&](const Criteria &other) {
+            return other.arrivalTime <= candidate.arrivalTime &&
+                   other.numberOfTrips <= candidate.numberOfTrips;
+          });
+      if (dominated) continue;
+      kept.emplace_back(candidate);
+      result.emplace_back(allJourneys[candidate.index]);
+    }
+    return result;
+  }
+
   inline std::vector<RAPTOR::Journey> getJourneys() const noexcept {
     std::vector<RAPTOR::Journey> result;
     int bestArrivalTime = INFTY;
@@ -332,8 +338,9 @@ class TREXProfileQuery {
       transferFromSource[stop] = INFTY;
     }
     transferToTarget[lastTarget] = INFTY;
-    for (const Edge edge : reverseTransferGraph.edgesFrom(lastTarget)) {
-      const Vertex stop = reverseTransferGraph.get(ToVertex, edge);
+    for (const Edge edge :
+         tables.reverseTransferGraph.edgesFrom(lastTarget)) {
+      const Vertex stop = tables.reverseTransferGraph.get(ToVertex, edge);
       transferToTarget[stop] = INFTY;
     }
     transferFromSource[sourceStop] = 0;
@@ -345,12 +352,14 @@ class TREXProfileQuery {
     }
     transferToTarget[targetStop] = 0;
     if (sourceStop == targetStop) addTargetLabel(minDepartureTime);
-    for (const Edge edge : reverseTransferGraph.edgesFrom(targetStop)) {
-      const Vertex stop = reverseTransferGraph.get(ToVertex, edge);
+    for (const Edge edge :
+         tables.reverseTransferGraph.edgesFrom(targetStop)) {
+      const Vertex stop = tables.reverseTransferGraph.get(ToVertex, edge);
       if (stop == sourceStop)
         addTargetLabel(minDepartureTime +
-                       reverseTransferGraph.get(TravelTime, edge));
-      transferToTarget[stop] = reverseTransferGraph.get(TravelTime, edge);
+                       tables.reverseTransferGraph.get(TravelTime, edge));
+      transferToTarget[stop] =
+          tables.reverseTransferGraph.get(TravelTime, edge);
     }
     lastSource = sourceStop;
     lastTarget = targetStop;
@@ -490,25 +499,23 @@ class TREXProfileQuery {
   inline void enqueue(const Edge edge, const size_t parent,
                       const u_int8_t n) noexcept {
     profiler.countMetric(METRIC_ENQUEUES);
-    const EdgeLabel &label = edgeLabels[edge];
-    if (reachedIndex.alreadyReached(label.trip,
-                                    label.stopEvent - label.firstEvent, n + 1))
+    const EdgeLabel &label = tables.edgeLabels[edge];
+    if (reachedIndex.alreadyReached(label.trip, label.stopEvent, n + 1))
       return;
 
-    if (((label.cellId ^ sourceCellId) >> label.localLevel) &&
-        ((label.cellId ^ targetCellId) >> label.localLevel)) [[likely]] {
-      reachedIndex.update(label.trip,
-                          StopIndex(label.stopEvent - label.firstEvent), n + 1);
+    if (((label.cellId ^ sourceCellId) >> label.cellShift) &&
+        ((label.cellId ^ targetCellId) >> label.cellShift)) [[likely]] {
+      reachedIndex.update(label.trip, label.stopEvent, n + 1);
       return;
     }
     queue[queueSize] = TripLabel(
-        label.stopEvent,
+        StopEventId(label.firstEvent + label.stopEvent),
         StopEventId(label.firstEvent + reachedIndex(label.trip, n + 1)),
         parent);
     queueSize++;
     AssertMsg(queueSize <= queue.size(), "Queue is overfull!");
     reachedIndex.update(label.trip,
-                        StopIndex(label.stopEvent - label.firstEvent), n + 1);
+                        label.stopEvent, n + 1);
   }
 
   inline void addTargetLabel(const int newArrivalTime,
@@ -594,7 +601,9 @@ class TREXProfileQuery {
       const StopEventId departureStopEvent) const noexcept {
     for (StopEventId i = parentLabel.begin; i < parentLabel.end; i++) {
       for (const Edge edge : data.stopEventGraph.edgesFrom(Vertex(i))) {
-        if (edgeLabels[edge].stopEvent == departureStopEvent)
+        if (tables.edgeLabels[edge].firstEvent +
+                tables.edgeLabels[edge].stopEvent ==
+            departureStopEvent)
           return std::make_pair(i, edge);
       }
     }
@@ -622,15 +631,15 @@ class TREXProfileQuery {
 
  private:
   const TREXData &data;
+  const TREXQueryTables &tables;
 
-  TransferGraph reverseTransferGraph;
   std::vector<int> transferFromSource;
   std::vector<int> transferToTarget;
   StopId lastSource;
   StopId lastTarget;
 
-  uint16_t sourceCellId;
-  uint16_t targetCellId;
+  uint32_t sourceCellId;
+  uint32_t targetCellId;
 
   IndexedSet<false, RouteId> reachedRoutes;
 
@@ -647,8 +656,6 @@ class TREXProfileQuery {
   std::vector<TargetLabel> targetLabels;
   std::vector<int> minArrivalTimeFastLookUp;
 
-  std::vector<EdgeLabel> edgeLabels;
-
   StopId sourceStop;
   StopId targetStop;
   int minDepartureTime;
@@ -658,7 +665,6 @@ class TREXProfileQuery {
   std::vector<RAPTOR::Journey> allJourneys;
   std::vector<bool> targetLabelChanged;
 
-  std::vector<RouteLabel> routeLabels;
   Profiler profiler;
 };
 
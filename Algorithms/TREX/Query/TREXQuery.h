@@ -24,23 +24,48 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bit>
 
 #include "../../../DataStructures/Container/Set.h"
 #include "../../../DataStructures/Graph/Utils/Conversion.h"
 #include "../../../DataStructures/RAPTOR/Entities/ArrivalLabel.h"
 #include "../../../DataStructures/RAPTOR/Entities/Journey.h"
 #include "../../../DataStructures/TREX/TREXData.h"
+#include "../../../DataStructures/TREX/TREXQueryTables.h"
 #include "../../TripBased/Query/Profiler.h"
 #include "../../TripBased/Query/ReachedIndex.h"
+#include "../../TripBased/Query/TimestampedReachedIndex.h"
 
 namespace TripBased {
 
-template <typename PROFILER = NoProfiler>
+// Layout of the edge labels, which are read while relaxing the transfers
+struct PaddedEdgeLayout {
+  static constexpr bool Compact = false;
+};
+
+// 8 byte edge labels. All transfers of a stop event share the cell id of its
+// stop, hence the cell test reduces to comparing the local level of a transfer
+// against a threshold, which is computed once per stop event.
+struct CompactEdgeLayout {
+  static constexpr bool Compact = true;
+};
+
+// DATA is either the TREXData or the memory mapped MappedTREXData,
+// EDGE_LAYOUT is either PaddedEdgeLayout or CompactEdgeLayout,
+// REACHED_INDEX is either ReachedIndex or TimestampedReachedIndex
+template <typename PROFILER = NoProfiler, typename DATA = TREXData,
+          typename EDGE_LAYOUT = PaddedEdgeLayout,
+          typename REACHED_INDEX = ReachedIndex>
 class TREXQuery {
  public:
   using Profiler = PROFILER;
-  using Type = TREXQuery<Profiler>;
+  using DataType = DATA;
+  using EdgeLayout = EDGE_LAYOUT;
+  using ReachedIndexType = REACHED_INDEX;
+  using QueryTables = typename DataType::QueryTables;
+  using Type = TREXQuery<Profiler, DataType, EdgeLayout, ReachedIndexType>;
 
  private:
   struct TripLabel {
@@ -58,31 +83,9 @@ class TREXQuery {
     Edge end;
   };
 
-  struct EdgeLabel {
-    EdgeLabel(const StopEventId firstEvent = noStopEvent,
-              const TripId trip = noTripId,
-              const StopIndex stopEvent = noStopIndex,
-              const uint16_t cellId = 0, const uint8_t localLevel = 0)
-        : firstEvent(firstEvent),
-          trip(trip),
-          stopEvent(stopEvent),
-          cellId(cellId),
-          localLevel(localLevel) {}
-    StopEventId firstEvent;
-    TripId trip;
-    StopIndex stopEvent;
-    uint16_t cellId;
-    uint8_t localLevel;
-  };
-
-  struct RouteLabel {
-    RouteLabel() : numberOfTrips(0) {}
-    inline StopIndex end() const noexcept {
-      return StopIndex(departureTimes.size() / numberOfTrips);
-    }
-    u_int32_t numberOfTrips;
-    std::vector<int> departureTimes;
-  };
+  using EdgeLabel = TREXQueryTables::EdgeLabel;
+  using CompactEdgeLabel = TREXQueryTables::CompactEdgeLabel;
+  using RouteLabel = TREXQueryTables::RouteLabel;
 
   struct TargetLabel {
     TargetLabel(const int arrivalTime = INFTY, const u_int32_t parent = -1)
@@ -101,9 +104,9 @@ class TREXQuery {
       0b1000000000000000};
 
  public:
-  TREXQuery(TREXData &data)
+  TREXQuery(const DataType &data)
       : data(data),
-        reverseTransferGraph(data.raptorData.transferGraph),
+        tables(data.queryTables),
         transferFromSource(data.numberOfStops(), INFTY),
         transferToTarget(data.numberOfStops(), INFTY),
         lastSource(StopId(0)),
@@ -115,44 +118,12 @@ class TREXQuery {
         reachedIndex(data),
         targetLabels(1),
         minArrivalTime(INFTY),
-        edgeLabels(data.stopEventGraph.numEdges()),
-        routeLabels(data.numberOfRoutes()),
         sourceStop(noStop),
         targetStop(noStop),
         sourceDepartureTime(never),
         transferPerLevel(data.getNumberOfLevels() + 1, 0),
         numQueries(0) {
-    reverseTransferGraph.revert();
-
-    for (const auto [edge, from] : data.stopEventGraph.edgesWithFromVertex()) {
-      edgeLabels[edge].trip =
-          data.tripOfStopEvent[data.stopEventGraph.get(ToVertex, edge)];
-      edgeLabels[edge].firstEvent =
-          data.firstStopEventOfTrip[edgeLabels[edge].trip];
-      edgeLabels[edge].stopEvent =
-          StopIndex(StopEventId(data.stopEventGraph.get(ToVertex, edge) + 1) -
-                    edgeLabels[edge].firstEvent);
-      edgeLabels[edge].localLevel = data.stopEventGraph.get(LocalLevel, edge);
-      edgeLabels[edge].cellId = ((uint16_t)data.getCellIdOfStop(
-          data.getStopOfStopEvent(StopEventId(from))));
-    }
-
-    for (const RouteId route : data.raptorData.routes()) {
-      const size_t numberOfStops = data.numberOfStopsInRoute(route);
-      const size_t numberOfTrips = data.raptorData.numberOfTripsInRoute(route);
-      const RAPTOR::StopEvent *stopEvents =
-          data.raptorData.firstTripOfRoute(route);
-      routeLabels[route].numberOfTrips = numberOfTrips;
-      routeLabels[route].departureTimes.resize((numberOfStops - 1) *
-                                               numberOfTrips);
-      for (size_t trip = 0; trip < numberOfTrips; trip++) {
-        for (size_t stopIndex = 0; stopIndex + 1 < numberOfStops; stopIndex++) {
-          routeLabels[route]
-              .departureTimes[(stopIndex * numberOfTrips) + trip] =
-              stopEvents[(trip * numberOfStops) + stopIndex].departureTime;
-        }
-      }
-    }
+    AssertMsg(tables.isBuilt(), "The query tables have not been built!");
     profiler.registerPhases(
         {PHASE_SCAN_INITIAL, PHASE_EVALUATE_INITIAL, PHASE_SCAN_TRIPS});
     profiler.registerMetrics({METRIC_ROUNDS, METRIC_SCANNED_TRIPS,
@@ -253,8 +224,9 @@ class TREXQuery {
       transferFromSource[stop] = INFTY;
     }
     transferToTarget[lastTarget] = INFTY;
-    for (const Edge edge : reverseTransferGraph.edgesFrom(lastTarget)) {
-      const Vertex stop = reverseTransferGraph.get(ToVertex, edge);
+    for (const Edge edge :
+         tables.reverseTransferGraph.edgesFrom(lastTarget)) {
+      const Vertex stop = tables.reverseTransferGraph.get(ToVertex, edge);
       transferToTarget[stop] = INFTY;
     }
     transferFromSource[sourceStop] = 0;
@@ -266,12 +238,14 @@ class TREXQuery {
     }
     transferToTarget[targetStop] = 0;
     if (sourceStop == targetStop) addTargetLabel(sourceDepartureTime);
-    for (const Edge edge : reverseTransferGraph.edgesFrom(targetStop)) {
-      const Vertex stop = reverseTransferGraph.get(ToVertex, edge);
+    for (const Edge edge :
+         tables.reverseTransferGraph.edgesFrom(targetStop)) {
+      const Vertex stop = tables.reverseTransferGraph.get(ToVertex, edge);
       if (stop == sourceStop)
         addTargetLabel(sourceDepartureTime +
-                       reverseTransferGraph.get(TravelTime, edge));
-      transferToTarget[stop] = reverseTransferGraph.get(TravelTime, edge);
+                       tables.reverseTransferGraph.get(TravelTime, edge));
+      transferToTarget[stop] =
+          tables.reverseTransferGraph.get(TravelTime, edge);
     }
     lastSource = sourceStop;
     lastTarget = targetStop;
@@ -300,13 +274,14 @@ class TREXQuery {
 
 #ifdef ENABLE_PREFETCH
       if (i + 4 < routesToLoopOver.size()) {
-        __builtin_prefetch(&routeLabels[routesToLoopOver[i + 4]]);
+        __builtin_prefetch(
+            tables.departureTimesOfRoute(routesToLoopOver[i + 4]));
         __builtin_prefetch(&data.firstTripOfRoute[routesToLoopOver[i + 4]]);
         __builtin_prefetch(
             data.raptorData.stopArrayOfRoute(routesToLoopOver[i + 4]));
       }
 #endif
-      const RouteLabel &label = routeLabels[route];
+      const RouteLabel label = tables.routeLabel(route);
       const StopIndex endIndex = label.end();
       const TripId firstTrip = data.firstTripOfRoute[route];
       const StopId *stops = data.raptorData.stopArrayOfRoute(route);
@@ -390,10 +365,14 @@ class TREXQuery {
       }
       // Relax the transfers for each trip
       for (size_t i = roundBegin; i < roundEnd; i++) {
-        const EdgeRange &label = edgeRanges[i];
-        for (Edge edge = label.begin; edge < label.end; edge++) {
-          profiler.countMetric(METRIC_RELAXED_TRANSFERS);
-          enqueue(edge, i);
+        if constexpr (EdgeLayout::Compact) {
+          relaxCompactEdges(i);
+        } else {
+          const EdgeRange &label = edgeRanges[i];
+          for (Edge edge = label.begin; edge < label.end; edge++) {
+            profiler.countMetric(METRIC_RELAXED_TRANSFERS);
+            enqueue(edge, i);
+          }
         }
       }
 
@@ -416,13 +395,13 @@ class TREXQuery {
 
   inline void enqueue(const Edge edge, const size_t parent) noexcept {
     profiler.countMetric(METRIC_ENQUEUES);
-    const EdgeLabel &label = edgeLabels[edge];
+    const EdgeLabel &label = tables.edgeLabels[edge];
 
     if (reachedIndex.alreadyReached(label.trip, label.stopEvent)) [[likely]]
       return;
 
-    if (((label.cellId ^ sourceCellId) >> label.localLevel) &&
-        ((label.cellId ^ targetCellId) >> label.localLevel)) [[likely]] {
+    if (((label.cellId ^ sourceCellId) >> label.cellShift) &&
+        ((label.cellId ^ targetCellId) >> label.cellShift)) [[likely]] {
       profiler.countMetric(DISCARDED_EDGE);
       reachedIndex.update(label.trip, StopIndex(label.stopEvent));
       return;
@@ -436,6 +415,50 @@ class TREXQuery {
     reachedIndex.update(label.trip, StopIndex(label.stopEvent));
   }
 
+  // Relaxes the transfers of the trip segment queue[parent] stop event by stop
+  // event. A transfer is pruned iff (cellId ^ sourceCellId) >> cellShift and
+  // (cellId ^ targetCellId) >> cellShift are both non zero, i.e., iff its
+  // cell shift is below the bit width of both.
+  inline void relaxCompactEdges(const size_t parent) noexcept {
+    const TripLabel &label = queue[parent];
+    Edge edge = edgeRanges[parent].begin;
+    for (StopEventId j = label.begin; j < label.end; j++) {
+      const Edge end = data.stopEventGraph.beginEdgeFrom(Vertex(j + 1));
+      if (edge == end) continue;
+      const uint32_t cellId = data.getCellIdOfStop(data.getStopOfStopEvent(j));
+      const uint8_t threshold =
+          std::min(std::bit_width(uint32_t(cellId ^ sourceCellId)),
+                   std::bit_width(uint32_t(cellId ^ targetCellId)));
+      for (; edge < end; edge++) {
+        profiler.countMetric(METRIC_RELAXED_TRANSFERS);
+        enqueueCompact(edge, parent, threshold);
+      }
+    }
+  }
+
+  inline void enqueueCompact(const Edge edge, const size_t parent,
+                             const uint8_t threshold) noexcept {
+    profiler.countMetric(METRIC_ENQUEUES);
+    const CompactEdgeLabel &label = tables.compactEdgeLabels[edge];
+
+    if (reachedIndex.alreadyReached(label.trip, label.stopEvent)) [[likely]]
+      return;
+
+    if (label.cellShift < threshold) [[likely]] {
+      profiler.countMetric(DISCARDED_EDGE);
+      reachedIndex.update(label.trip, StopIndex(label.stopEvent));
+      return;
+    }
+
+    const StopEventId firstEvent = data.firstStopEventOfTrip[label.trip];
+    queue[queueSize] =
+        TripLabel(StopEventId(firstEvent + label.stopEvent),
+                  StopEventId(firstEvent + reachedIndex(label.trip)), parent);
+    ++queueSize;
+    AssertMsg(queueSize <= queue.size(), "Queue is overfull!");
+    reachedIndex.update(label.trip, StopIndex(label.stopEvent));
+  }
+
   inline void addTargetLabel(const int newArrivalTime,
                              const u_int32_t parent = -1) noexcept {
     profiler.countMetric(METRIC_ADD_JOURNEYS);
@@ -500,7 +523,8 @@ class TREXQuery {
       const StopEventId departureStopEvent) const noexcept {
     for (StopEventId i = parentLabel.begin; i < parentLabel.end; ++i) {
       for (const Edge edge : data.stopEventGraph.edgesFrom(Vertex(i))) {
-        if (edgeLabels[edge].stopEvent + edgeLabels[edge].firstEvent ==
+        if (tables.edgeLabels[edge].stopEvent +
+                tables.edgeLabels[edge].firstEvent ==
             departureStopEvent)
           return std::make_pair(i, edge);
       }
@@ -528,30 +552,28 @@ class TREXQuery {
   }
 
  private:
-  TREXData &data;
+  const DataType &data;
+
+  const QueryTables &tables;
 
-  TransferGraph reverseTransferGraph;
   std::vector<int> transferFromSource;
   std::vector<int> transferToTarget;
   StopId lastSource;
   StopId lastTarget;
 
-  uint16_t sourceCellId;
-  uint16_t targetCellId;
+  uint32_t sourceCellId;
+  uint32_t targetCellId;
 
   IndexedSet<false, RouteId> reachedRoutes;
 
   std::vector<TripLabel> queue;
   std::vector<EdgeRange> edgeRanges;
   size_t queueSize;
-  ReachedIndex reachedIndex;
+  ReachedIndexType reachedIndex;
 
   std::vector<TargetLabel> targetLabels;
   int minArrivalTime;
 
-  std::vector<EdgeLabel> edgeLabels;
-  std::vector<RouteLabel> routeLabels;
-
   StopId sourceStop;
   StopId targetStop;
   int sourceDepartureTime;
@@ -337,8 +337,8 @@ class ProfileTB {
     targetLabelChanged.assign(data.raptorData.stopData.size(),
                               emptyTargetLabelChanged);
 
-    bestTravelTime.assign(data.raptorData.numberOfStops(), 0);
-    bestMinTransfers.assign(data.raptorData.numberOfStops(), 0);
+    bestTravelTime.assign(data.raptorData.numberOfStops(), INFTY);
+    bestMinTransfers.assign(data.raptorData.numberOfStops(), 255);
 
     allJourneys.clear();
     allJourneys.reserve(1 << 8);
@@ -353,11 +353,19 @@ class ProfileTB {
       transferFromSource[stop] = INFTY;
     }
     transferFromSource[sourceStop] = 0;
+    // walking needs no trip, so these are also the lower bounds for A star
+    bestTravelTime[sourceStop] = 0;
+    bestMinTransfers[sourceStop] = 0;
     for (const Edge edge :
          data.raptorData.transferGraph.edgesFrom(sourceStop)) {
       const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
       transferFromSource[stop] =
           data.raptorData.transferGraph.get(TravelTime, edge);
+      if (data.raptorData.isStop(stop)) {
+        bestTravelTime[stop] =
+            std::min(bestTravelTime[stop], transferFromSource[stop]);
+        bestMinTransfers[stop] = 0;
+      }
     }
     lastSource = sourceStop;
     profiler.donePhase(PHASE_SCAN_INITIAL);
@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/Graph/Utils/Utils.h"
 #include "../../../DataStructures/RAPTOR/Entities/JourneyWithStopEvent.h"
 #include "../../../DataStructures/TransferPattern/Data.h"
+#include "../../../DataStructures/TransferPattern/Entities/PrefixTrie.h"
 #include "../../../DataStructures/TripBased/Data.h"
 #include "ProfileTB.h"
 
@@ -37,67 +38,60 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../Helpers/MultiThreading.h"
 #include "../../../Helpers/Vector/Vector.h"
 
-/* #include <google/dense_hash_map> */
-#include <unordered_map>
+#include <algorithm>
+#include <vector>
 
 namespace TransferPattern {
 
-struct eqVecStopid {
-  bool operator()(const std::vector<StopId> &a,
-                  const std::vector<StopId> &b) const {
-    return a == b;
-  }
-};
-
 class TransferPatternBuilder {
  public:
+  struct DAGEdge {
+    Vertex from;
+    Vertex to;
+    int travelTime;
+  };
+
   TransferPatternBuilder(TripBased::Data &data)
       : data(data),
         query(data)
         /* , query(data.raptorData) */
         ,
-        dynamicDAG(),
+        viaVertex(Vector::id<Vertex>(data.numberOfStops())),
         minDep(0),
         maxDep(24 * 60 * 60 - 1) {
-    /* seenPrefix.set_empty_key({ noStop }); */
+    dagEdges.reserve(data.numberOfStops() << 3);
+    viaVertex.reserve(data.numberOfStops() << 3);
     clear();
   }
 
-  inline const DynamicDAGTransferPattern &getDAG() const noexcept {
-    return dynamicDAG;
+  inline size_t numberOfDAGVertices() const noexcept {
+    return viaVertex.size();
   }
 
-  inline DynamicDAGTransferPattern &getDAG() noexcept { return dynamicDAG; }
-
-  inline void addPrefixToDAG(std::vector<StopId> &prefix,
-                             const int travelTime = -1) {
-    AssertMsg(prefix.size() > 0, "Prefix is empty?");
-    if (seenPrefix.find(prefix) != seenPrefix.end()) return;
-
-    std::vector<StopId> prefixBefore(prefix);
-    prefixBefore.pop_back();
-
-    // a bit ugly, but this is to allow A->B via route and A->B via foot
-    if (prefixBefore.back() == noStop) prefixBefore.pop_back();
-
-    Vertex beforeVertex = seenPrefix[prefixBefore];
-    Vertex newVertex = dynamicDAG.addVertex();
-    dynamicDAG.set(ViaVertex, newVertex, Vertex(prefix.back()));
-
-    seenPrefix[prefix] = newVertex;
+  inline const std::vector<DAGEdge> &getDAGEdges() const noexcept {
+    return dagEdges;
+  }
 
-    dynamicDAG.addEdge(newVertex, beforeVertex).set(TravelTime, travelTime);
+  // Returns the vertex of the prefix that extends the prefix of parent by
+  // stop, adding it to the DAG if it is new.
+  inline Vertex addPrefixToDAG(const Vertex parent, const StopId stop,
+                               const int travelTime = -1) {
+    AssertMsg(parent < viaVertex.size(), "Parent is not a vertex of the DAG!");
+    Vertex &newVertex = seenPrefix.child(
+        parent, stop,
+        travelTime == -1 ? PrefixTrie::ByRoute : PrefixTrie::ByFootpath);
+    if (newVertex != noVertex) return newVertex;
+
+    newVertex = Vertex(viaVertex.size());
+    viaVertex.emplace_back(Vertex(stop));
+    dagEdges.emplace_back(DAGEdge{newVertex, parent, travelTime});
+    return newVertex;
   }
 
   inline void computeTransferPatternForStop(const StopId stop = noStop) {
     AssertMsg(data.raptorData.isStop(stop), "Stop is not valid!");
     clear();
 
-    std::vector<StopId> currentPrefix;
-    currentPrefix.reserve(32);
-    currentPrefix.push_back(stop);
-    seenPrefix[currentPrefix] = Vertex(stop);
-
     // This solves one-to-all
     query.run(Vertex(stop), minDep, maxDep);
 
@@ -108,10 +102,7 @@ class TransferPatternBuilder {
 
     for (RAPTOR::Journey &j : query.getAllJourneys()) {
       /* for (RAPTOR::JourneyWithStopEvent& j : query.getAllJourneys()) { */
-      currentPrefix.clear();
-      currentPrefix.reserve(32);
-
-      currentPrefix.push_back(stop);
+      Vertex currentPrefix = Vertex(stop);
       target = StopId(j.back().to);
 
       for (size_t i(0); i < j.size(); ++i) {
@@ -132,38 +123,60 @@ class TransferPatternBuilder {
         }
         if (leg.to == j.back().to) {
           // add last leg (this is the special stop-vertex)
-          AssertMsg(seenPrefix.find(currentPrefix) != seenPrefix.end(),
-                    "Current Prefix is not in the map?");
-          if (!dynamicDAG.hasEdge(Vertex(target), seenPrefix[currentPrefix]))
-            dynamicDAG.addEdge(Vertex(target), seenPrefix[currentPrefix])
-                .set(TravelTime, travelTime);
+          Vertex &targetEdge =
+              seenPrefix.child(currentPrefix, target, PrefixTrie::ToTarget);
+          if (targetEdge == noVertex) {
+            targetEdge = Vertex(target);
+            dagEdges.emplace_back(
+                DAGEdge{Vertex(target), currentPrefix, travelTime});
+          }
           break;
         } else {
-          if (travelTime != -1) currentPrefix.push_back(noStop);
-          currentPrefix.push_back(StopId(leg.to));
-          addPrefixToDAG(currentPrefix, travelTime);
+          currentPrefix =
+              addPrefixToDAG(currentPrefix, StopId(leg.to), travelTime);
         }
       }
     }
+  }
+
+  // Writes the DAG of the last source into dag, with the outgoing edges of
+  // every vertex sorted by ToVertex. The first # of stops vertices are the
+  // stops themselves, every other vertex is a prefix.
+  inline void buildDAG(StaticDAGTransferPattern &dag) noexcept {
+    const size_t numVertices = viaVertex.size();
+    std::vector<Edge> beginOut(numVertices + 1, Edge(0));
+    for (const DAGEdge &edge : dagEdges) ++beginOut[edge.from + 1];
+    for (size_t i = 1; i <= numVertices; ++i) beginOut[i] += beginOut[i - 1];
+
+    edgeOfVertex.assign(beginOut.begin(), beginOut.end() - 1);
+    sortedEdges.resize(dagEdges.size());
+    for (const DAGEdge &edge : dagEdges) {
+      sortedEdges[edgeOfVertex[edge.from]++] = edge;
+    }
+    for (size_t i = 0; i < numVertices; ++i) {
+      if (beginOut[i + 1] - beginOut[i] < 2) continue;
+      std::sort(sortedEdges.begin() + beginOut[i],
+                sortedEdges.begin() + beginOut[i + 1],
+                [](const DAGEdge &a, const DAGEdge &b) { return a.to < b.to; });
+    }
 
-    // keep first # of stops vertices, the rest can vanish
-    dynamicDAG.deleteVertices([&](Vertex vertex) {
-      return vertex >= data.raptorData.numberOfStops() &&
-             dynamicDAG.isIsolated(vertex);
-    });
-    dynamicDAG.packEdges();
+    std::vector<Vertex> toVertex(sortedEdges.size());
+    for (size_t i = 0; i < sortedEdges.size(); ++i) {
+      toVertex[i] = sortedEdges[i].to;
+    }
+    dag.assignEdges(std::move(beginOut), std::move(toVertex));
+    dag.get(ViaVertex).assign(viaVertex.begin(), viaVertex.end());
+    for (size_t i = 0; i < sortedEdges.size(); ++i) {
+      dag.set(TravelTime, Edge(i), sortedEdges[i].travelTime);
+    }
   }
 
+  // Resets the builder for the next source. All buffers keep their capacity.
   inline void clear() noexcept {
-    dynamicDAG.clear();
-    dynamicDAG.reserve(data.numberOfStops() << 3, data.numberOfStops() << 3);
-    dynamicDAG.addVertices(data.numberOfStops());
-    for (const Vertex vertex : dynamicDAG.vertices()) {
-      dynamicDAG.set(ViaVertex, vertex, vertex);
-    }
+    // the first # of stops vertices are the stops and are never changed
+    viaVertex.resize(data.numberOfStops());
+    dagEdges.clear();
     seenPrefix.clear();
-    /* seenPrefix.resize(1 << 6); */
-    /* seenPrefix.clear_no_resize(); */
   }
 
   inline std::vector<int> &getMinTravelTimes() noexcept {
@@ -193,13 +206,15 @@ class TransferPatternBuilder {
   /* RAPTOR::RangeRAPTOR::RangeRAPTOR<RAPTOR::RangeRAPTOR::TransitiveRAPTORModule<RAPTOR::NoProfiler>>
    * query; */
 
-  DynamicDAGTransferPattern dynamicDAG;
+  // The DAG of the current source: ViaVertex per vertex and all edges
+  std::vector<Vertex> viaVertex;
+  std::vector<DAGEdge> dagEdges;
+
+  // Buffers for buildDAG
+  std::vector<Edge> edgeOfVertex;
+  std::vector<DAGEdge> sortedEdges;
 
-  /* google::dense_hash_map<std::vector<StopId>, Vertex,
-   * std::VectorHasher<StopId>, eqVecStopid> */
-  std::unordered_map<std::vector<StopId>, Vertex, std::VectorHasher<StopId>,
-                     eqVecStopid>
-      seenPrefix;
+  PrefixTrie seenPrefix;
   const int minDep;
   const int maxDep;
 };
@@ -208,23 +223,23 @@ inline void ComputeTransferPatternUsingTripBased(
     TripBased::Data &data, TransferPattern::Data &tpData) {
   Progress progress(data.numberOfStops());
   TransferPatternBuilder bobTheBuilder(data);
+  std::vector<StaticDAGTransferPattern> transferPatternOfStop(
+      data.numberOfStops());
 
   for (const StopId stop : data.stops()) {
     bobTheBuilder.computeTransferPatternForStop(stop);
+    bobTheBuilder.buildDAG(transferPatternOfStop[stop]);
     AssertMsg(
-        Graph::isAcyclic<DynamicDAGTransferPattern>(bobTheBuilder.getDAG()),
+        Graph::isAcyclic<StaticDAGTransferPattern>(transferPatternOfStop[stop]),
         "Graph is not acyclic!");
 
-    Graph::move(std::move(bobTheBuilder.getDAG()),
-                tpData.transferPatternOfStop[stop]);
-    tpData.transferPatternOfStop[stop].sortEdges(ToVertex);
-
     tpData.assignLowerBounds(stop, bobTheBuilder.getMinTravelTimes(),
                              bobTheBuilder.getMinNumberOfTransfers());
 
     ++progress;
   }
   progress.finished();
+  tpData.transferPatterns.assign(transferPatternOfStop);
 }
 
 inline void ComputeTransferPatternUsingTripBased(TripBased::Data &data,
@@ -232,6 +247,8 @@ inline void ComputeTransferPatternUsingTripBased(TripBased::Data &data,
                                                  const int numberOfThreads,
                                                  const int pinMultiplier = 1) {
   Progress progress(data.numberOfStops());
+  std::vector<StaticDAGTransferPattern> transferPatternOfStop(
+      data.numberOfStops());
 
   const int numCores = numberOfCores();
 
@@ -251,19 +268,17 @@ inline void ComputeTransferPatternUsingTripBased(TripBased::Data &data,
 #pragma omp for schedule(dynamic, 1)
     for (size_t i = 0; i < numberOfStops; ++i) {
       bobTheBuilder.computeTransferPatternForStop(StopId(i));
+      bobTheBuilder.buildDAG(transferPatternOfStop[i]);
       AssertMsg(
-          Graph::isAcyclic<DynamicDAGTransferPattern>(bobTheBuilder.getDAG()),
+          Graph::isAcyclic<StaticDAGTransferPattern>(transferPatternOfStop[i]),
           "Graph is not acyclic!");
 
-      Graph::move(std::move(bobTheBuilder.getDAG()),
-                  tpData.transferPatternOfStop[i]);
-      tpData.transferPatternOfStop[i].sortEdges(ToVertex);
-
       tpData.assignLowerBounds(StopId(i), bobTheBuilder.getMinTravelTimes(),
                                bobTheBuilder.getMinNumberOfTransfers());
       ++progress;
     }
   }
   progress.finished();
+  tpData.transferPatterns.assign(transferPatternOfStop);
 }
 }  // namespace TransferPattern
@@ -34,6 +34,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/TransferPattern/Entities/Bags.h"
 #include "../../../Helpers/Vector/Vector.h"
 #include "Profiler.h"
+#include "QueryGraph.h"
 #include "TimestampedAlreadySeen.h"
 
 namespace TransferPattern {
@@ -125,7 +126,7 @@ class Query {
         sourceStop(noVertex),
         targetStop(noVertex),
         sourceDepartureTime(0),
-        queryGraph(),
+        queryGraph(data),
         queue(data.maxNumVerticesAndNumEdgesInTP().first),
         left(0),
         right(0),
@@ -209,14 +210,7 @@ class Query {
   inline void clear() noexcept {
     profiler.startPhase();
 
-    /* profiler.startPhase(); */
     queryGraph.clear();
-    queryGraph.addVertices(data.raptorData.numberOfStops());
-
-    // should prop be evaluated which reserve size is fastest
-    queryGraph.reserve(data.raptorData.numberOfStops(),
-                       data.raptorData.numberOfStops() << 1);
-    /* profiler.donePhase(PHASE_CLEAR_QUERY_GRAPH); */
 
     left = 0;
     right = 0;
@@ -241,8 +235,8 @@ class Query {
   inline void extractQueryGraph() {
     profiler.startPhase();
 
-    const StaticDAGTransferPattern &sourceTP =
-        data.transferPatternOfStop[sourceStop];
+    const TransferPatternDAG sourceTP =
+        data.transferPatterns.dagOfStop(StopId(sourceStop));
 
     Vertex currentVertex(targetStop);
 
@@ -259,28 +253,15 @@ class Query {
         // insert into queue
         if (!alreadySeen.contains(successor)) addVertexToQueryGraph(successor);
 
-        bool hasRouteEdge = false;
-        bool hasWalkingEdge = false;
-        for (const Edge e : queryGraph.edgesFrom(viaSuccessor)) {
-          if (queryGraph.get(ToVertex, e) ==
-              sourceTP.get(ViaVertex, currentVertex)) {
-            if (queryGraph.get(TravelTime, e) == -1)
-              hasRouteEdge = true;
-            else
-              hasWalkingEdge = true;
-          }
-        }
-        if (hasWalkingEdge && hasRouteEdge) continue;
-        if ((sourceTP.get(TravelTime, edge) == -1 && !hasRouteEdge) ||
-            (!hasWalkingEdge)) {
-          queryGraph
-              .addEdge(sourceTP.get(ViaVertex, successor),
-                       sourceTP.get(ViaVertex, currentVertex))
-              .set(TravelTime, sourceTP.get(TravelTime, edge));
+        // at most one route and one walking edge per pair of stops
+        if (queryGraph.addEdge(viaSuccessor,
+                               sourceTP.get(ViaVertex, currentVertex),
+                               sourceTP.get(TravelTime, edge))) {
           profiler.countMetric(METRIC_NUM_EDGES_QUERY_GRAPH);
         }
       }
     }
+    queryGraph.build();
 
     profiler.donePhase(PHASE_EXTRACT_QUERY_GRAPH);
   }
@@ -317,7 +298,7 @@ class Query {
     if (timestampsForBags[vertex] == currentTimestamp) [[unlikely]]
       return;
 
-    dijkstraBags[vertex] = DijkstraBagType();
+    dijkstraBags[vertex].clear();
     timestampsForBags[vertex] = currentTimestamp;
   }
 
@@ -369,7 +350,7 @@ class Query {
         if (travelTime == -1) [[likely]] {
           ++newNumberOfTrips;
           std::pair<RouteId, int> pair =
-              directConnectionIntersection(u, v, uLabel.arrivalTime);
+              queryGraph.directConnection(u, edge, uLabel.arrivalTime);
           newArrivalTime = pair.second;
           usedRoute = pair.first;
         }
@@ -410,67 +391,6 @@ class Query {
 
   // ######
 
-  // * eval direct connection
-
-  inline std::pair<RouteId, int> directConnectionIntersection(
-      const Vertex from, const Vertex to, const int departureTime) {
-    AssertMsg(data.raptorData.isStop(StopId(from)),
-              "From " << from << " is not a valid stop");
-    AssertMsg(data.raptorData.isStop(StopId(to)),
-              "To " << to << "is not a valid stop");
-
-    std::vector<RAPTOR::RouteSegment> &fromLookup =
-        data.stopLookup[from].incidentLines;
-    std::vector<RAPTOR::RouteSegment> &toLookup =
-        data.stopLookup[to].incidentLines;
-
-    AssertMsg(std::is_sorted(fromLookup.begin(), fromLookup.end()),
-              "StopLookup from From is not sorted!");
-    AssertMsg(std::is_sorted(toLookup.begin(), toLookup.end()),
-              "StopLookup from From is not sorted!");
-
-    std::pair<RouteId, int> result = std::make_pair(noRouteId, INFTY);
-
-    size_t i(0);
-    size_t j(0);
-
-    size_t firstReachableTripIndex(-1);
-    int currentArrivalTime(-1);
-
-    while (i < fromLookup.size() && j < toLookup.size()) {
-      // if fromLookup[i] and toLookup[j] are on the same line ...
-      // ... *and* fromLookup[i] is before toLookup[j] ...
-      // ... then evaluate and get the intersection
-      if (fromLookup[i].routeId == toLookup[j].routeId &&
-          fromLookup[i].stopIndex < toLookup[j].stopIndex) {
-        // get the first reachable trip departing >= departureTime
-        firstReachableTripIndex = data.earliestTripIndexOfLineByStopIndex(
-            fromLookup[i].stopIndex, fromLookup[i].routeId, departureTime);
-
-        // is this firstReachableTripIndex valid? I.e., firstReachableTripIndex
-        // != (-1)
-        if (firstReachableTripIndex != (size_t)-1) {
-          currentArrivalTime = data.getArrivalTime(fromLookup[i].routeId,
-                                                   firstReachableTripIndex,
-                                                   toLookup[j].stopIndex);
-          if (currentArrivalTime < result.second) {
-            result = std::make_pair(fromLookup[i].routeId, currentArrivalTime);
-          }
-        }
-        ++i;
-        ++j;
-      } else {
-        if (fromLookup[i] < toLookup[j]) {
-          ++i;
-        } else {
-          ++j;
-        }
-      }
-    }
-
-    return result;
-  }
-
  public:
   inline Profiler &getProfiler() noexcept { return profiler; }
 
@@ -481,7 +401,7 @@ class Query {
   Vertex targetStop;
   int sourceDepartureTime;
 
-  DynamicQueryGraph queryGraph;
+  QueryGraph queryGraph;
   std::vector<Vertex> queue;
   size_t left, right;
   TimestampedAlreadySeen alreadySeen;
@@ -34,6 +34,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/TransferPattern/Entities/Bags.h"
 #include "../../../Helpers/Vector/Vector.h"
 #include "Profiler.h"
+#include "QueryGraph.h"
 #include "TimestampedAlreadySeen.h"
 
 namespace TransferPattern {
@@ -67,16 +68,6 @@ class QueryAStar {
           bestTravelTime(0),
           bestNumTrips(0) {}
 
-    DijkstraLabel(const DijkstraLabel &other)
-        : arrivalTime(other.arrivalTime + other.bestTravelTime),
-          parentDepartureTime(other.parentDepartureTime),
-          numberOfTrips(other.numberOfTrips + other.bestNumTrips),
-          routeId(other.routeId),
-          parentStop(other.parentStop),
-          parentIndex(other.parentIndex),
-          bestTravelTime(other.bestTravelTime),
-          bestNumTrips(other.bestNumTrips) {}
-
     DijkstraLabel(int newArrivalTime, int newParentDepartureTime,
                   int newNumberOfTrips, RouteId newRouteId, StopId parentStop,
                   size_t parentIndex, int newBestTravelTime,
@@ -114,6 +105,16 @@ class QueryAStar {
       bestNumTrips = newBestNumTrips;
     }
 
+    // The label with the lower bounds towards the target added (used for
+    // target pruning). This must not be the copy constructor, since the bags
+    // copy their labels when they grow.
+    inline DijkstraLabel withLowerBounds() const {
+      DijkstraLabel result(*this);
+      result.arrivalTime += bestTravelTime;
+      result.numberOfTrips += bestNumTrips;
+      return result;
+    }
+
     inline int getKey() const { return arrivalTime + bestTravelTime; }
 
     inline bool hasSmallerKey(DijkstraLabel *other) const {
@@ -149,7 +150,7 @@ class QueryAStar {
         sourceStop(noVertex),
         targetStop(noVertex),
         sourceDepartureTime(0),
-        queryGraph(),
+        queryGraph(data),
         queue(data.maxNumVerticesAndNumEdgesInTP().first),
         left(0),
         right(0),
@@ -233,14 +234,7 @@ class QueryAStar {
   inline void clear() noexcept {
     profiler.startPhase();
 
-    /* profiler.startPhase(); */
     queryGraph.clear();
-    queryGraph.addVertices(data.raptorData.numberOfStops());
-
-    // should prop be evaluated which reserve size is fastest
-    queryGraph.reserve(data.raptorData.numberOfStops(),
-                       data.raptorData.numberOfStops() << 1);
-    /* profiler.donePhase(PHASE_CLEAR_QUERY_GRAPH); */
 
     left = 0;
     right = 0;
@@ -265,8 +259,8 @@ class QueryAStar {
   inline void extractQueryGraph() {
     profiler.startPhase();
 
-    const StaticDAGTransferPattern &sourceTP =
-        data.transferPatternOfStop[sourceStop];
+    const TransferPatternDAG sourceTP =
+        data.transferPatterns.dagOfStop(StopId(sourceStop));
 
     Vertex currentVertex(targetStop);
 
@@ -283,28 +277,15 @@ class QueryAStar {
         // insert into queue
         if (!alreadySeen.contains(successor)) addVertexToQueryGraph(successor);
 
-        bool hasRouteEdge = false;
-        bool hasWalkingEdge = false;
-        for (const Edge e : queryGraph.edgesFrom(viaSuccessor)) {
-          if (queryGraph.get(ToVertex, e) ==
-              sourceTP.get(ViaVertex, currentVertex)) {
-            if (queryGraph.get(TravelTime, e) == -1)
-              hasRouteEdge = true;
-            else
-              hasWalkingEdge = true;
-          }
-        }
-        if (hasWalkingEdge && hasRouteEdge) continue;
-        if ((sourceTP.get(TravelTime, edge) == -1 && !hasRouteEdge) ||
-            (!hasWalkingEdge)) {
-          queryGraph
-              .addEdge(sourceTP.get(ViaVertex, successor),
-                       sourceTP.get(ViaVertex, currentVertex))
-              .set(TravelTime, sourceTP.get(TravelTime, edge));
+        // at most one route and one walking edge per pair of stops
+        if (queryGraph.addEdge(viaSuccessor,
+                               sourceTP.get(ViaVertex, currentVertex),
+                               sourceTP.get(TravelTime, edge))) {
           profiler.countMetric(METRIC_NUM_EDGES_QUERY_GRAPH);
         }
       }
     }
+    queryGraph.build();
 
     profiler.donePhase(PHASE_EXTRACT_QUERY_GRAPH);
   }
@@ -341,7 +322,7 @@ class QueryAStar {
     if (timestampsForBags[vertex] == currentTimestamp) [[unlikely]]
       return;
 
-    dijkstraBags[vertex] = DijkstraBagType();
+    dijkstraBags[vertex].clear();
     timestampsForBags[vertex] = currentTimestamp;
   }
 
@@ -391,7 +372,7 @@ class QueryAStar {
         if (travelTime == -1) [[likely]] {
           ++newNumberOfTrips;
           std::pair<RouteId, int> pair =
-              directConnectionIntersection(u, v, uLabel.arrivalTime);
+              queryGraph.directConnection(u, edge, uLabel.arrivalTime);
           newArrivalTime = pair.second;
           usedRoute = pair.first;
         }
@@ -422,7 +403,7 @@ class QueryAStar {
     profiler.countMetric(METRIC_RELAXED_TRANSFER_EDGES);
     // Target Pruning - adapted
     // copy label and add the lower bound for trips
-    DijkstraLabel skewedCopy(label);
+    const DijkstraLabel skewedCopy = label.withLowerBounds();
 
     if (dijkstraBags[targetStop].dominates(skewedCopy)) return false;
 
@@ -439,67 +420,6 @@ class QueryAStar {
 
   // ######
 
-  // * eval direct connection
-
-  inline std::pair<RouteId, int> directConnectionIntersection(
-      const Vertex from, const Vertex to, const int departureTime) {
-    AssertMsg(data.raptorData.isStop(StopId(from)),
-              "From " << from << " is not a valid stop");
-    AssertMsg(data.raptorData.isStop(StopId(to)),
-              "To " << to << "is not a valid stop");
-
-    std::vector<RAPTOR::RouteSegment> &fromLookup =
-        data.stopLookup[from].incidentLines;
-    std::vector<RAPTOR::RouteSegment> &toLookup =
-        data.stopLookup[to].incidentLines;
-
-    AssertMsg(std::is_sorted(fromLookup.begin(), fromLookup.end()),
-              "StopLookup from From is not sorted!");
-    AssertMsg(std::is_sorted(toLookup.begin(), toLookup.end()),
-              "StopLookup from From is not sorted!");
-
-    std::pair<RouteId, int> result = std::make_pair(noRouteId, INFTY);
-
-    size_t i(0);
-    size_t j(0);
-
-    size_t firstReachableTripIndex(-1);
-    int currentArrivalTime(-1);
-
-    while (i < fromLookup.size() && j < toLookup.size()) {
-      // if fromLookup[i] and toLookup[j] are on the same line ...
-      // ... *and* fromLookup[i] is before toLookup[j] ...
-      // ... then evaluate and get the intersection
-      if (fromLookup[i].routeId == toLookup[j].routeId &&
-          fromLookup[i].stopIndex < toLookup[j].stopIndex) {
-        // get the first reachable trip departing >= departureTime
-        firstReachableTripIndex = data.earliestTripIndexOfLineByStopIndex(
-            fromLookup[i].stopIndex, fromLookup[i].routeId, departureTime);
-
-        // is this firstReachableTripIndex valid? I.e., firstReachableTripIndex
-        // != (-1)
-        if (firstReachableTripIndex != (size_t)-1) {
-          currentArrivalTime = data.getArrivalTime(fromLookup[i].routeId,
-                                                   firstReachableTripIndex,
-                                                   toLookup[j].stopIndex);
-          if (currentArrivalTime < result.second) {
-            result = std::make_pair(fromLookup[i].routeId, currentArrivalTime);
-          }
-        }
-        ++i;
-        ++j;
-      } else {
-        if (fromLookup[i] < toLookup[j]) {
-          ++i;
-        } else {
-          ++j;
-        }
-      }
-    }
-
-    return result;
-  }
-
  public:
   inline Profiler &getProfiler() noexcept { return profiler; }
 
@@ -510,7 +430,7 @@ class QueryAStar {
   Vertex targetStop;
   int sourceDepartureTime;
 
-  DynamicQueryGraph queryGraph;
+  QueryGraph queryGraph;
   std::vector<Vertex> queue;
   size_t left, right;
   TimestampedAlreadySeen alreadySeen;
@@ -0,0 +1,242 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "../../../DataStructures/Container/TimestampedHashMap.h"
+#include "../../../DataStructures/RAPTOR/Entities/RouteSegment.h"
+#include "../../../DataStructures/TransferPattern/Data.h"
+#include "../../../Helpers/Assert.h"
+#include "../../../Helpers/Ranges/Range.h"
+#include "../../../Helpers/Types.h"
+
+namespace TransferPattern {
+
+// The query graph extracted from the transfer pattern DAG of the source. It is
+// built into flat buffers that keep their capacity across queries, so a query
+// does not allocate once the buffers have grown. Edges are collected with
+// addEdge() and turned into an adjacency array (over the stops that have
+// outgoing edges) by build().
+//
+// For route edges, the pairs of route segments that connect the two stops are
+// determined on the first relaxation of the edge and then reused for every
+// further label that relaxes it.
+class QueryGraph {
+ public:
+  struct PendingEdge {
+    Vertex from;
+    Vertex to;
+    int travelTime;
+  };
+
+  struct RouteCandidate {
+    RouteId routeId;
+    StopIndex fromIndex;
+    StopIndex toIndex;
+  };
+
+  static constexpr uint32_t NotComputed = -1;
+
+ public:
+  QueryGraph(const Data &data)
+      : data(data),
+        localIndexOfStop(data.raptorData.numberOfStops()),
+        timestampOfStop(data.raptorData.numberOfStops(), 0),
+        currentTimestamp(0) {}
+
+  inline void clear() noexcept {
+    if (++currentTimestamp == 0) [[unlikely]] {
+      std::fill(timestampOfStop.begin(), timestampOfStop.end(), 0);
+      currentTimestamp = 1;
+    }
+    fromStops.clear();
+    pendingEdges.clear();
+    edgeSet.clear();
+    beginOut.clear();
+    toVertex.clear();
+    travelTime.clear();
+    firstCandidateOfEdge.clear();
+    candidates.clear();
+  }
+
+  // Adds the edge, unless the graph already has an edge from -> to of the
+  // same kind (route or walking). Returns whether the edge was added.
+  inline bool addEdge(const Vertex from, const Vertex to,
+                      const int edgeTravelTime) noexcept {
+    AssertMsg(data.raptorData.isStop(StopId(from)), "From is not a stop!");
+    AssertMsg(data.raptorData.isStop(StopId(to)), "To is not a stop!");
+    const uint64_t key = (uint64_t(from) << 32) | (uint64_t(to) << 1) |
+                         uint64_t(edgeTravelTime != -1);
+    bool &contained = edgeSet.findOrInsert(key, false);
+    if (contained) return false;
+    contained = true;
+
+    if (timestampOfStop[from] != currentTimestamp) {
+      timestampOfStop[from] = currentTimestamp;
+      localIndexOfStop[from] = fromStops.size();
+      fromStops.emplace_back(from);
+    }
+    pendingEdges.emplace_back(PendingEdge{from, to, edgeTravelTime});
+    return true;
+  }
+
+  // Builds the adjacency array out of the added edges, keeping their order
+  inline void build() noexcept {
+    beginOut.assign(fromStops.size() + 1, 0);
+    for (const PendingEdge &edge : pendingEdges) {
+      ++beginOut[localIndexOfStop[edge.from] + 1];
+    }
+    for (size_t i = 1; i < beginOut.size(); ++i) {
+      beginOut[i] += beginOut[i - 1];
+    }
+    toVertex.resize(pendingEdges.size());
+    travelTime.resize(pendingEdges.size());
+    for (const PendingEdge &edge : pendingEdges) {
+      const uint32_t position = beginOut[localIndexOfStop[edge.from]]++;
+      toVertex[position] = edge.to;
+      travelTime[position] = edge.travelTime;
+    }
+    // shift back, beginOut[i] now holds the end of vertex i
+    for (size_t i = beginOut.size() - 1; i > 0; --i) {
+      beginOut[i] = beginOut[i - 1];
+    }
+    beginOut[0] = 0;
+    firstCandidateOfEdge.assign(pendingEdges.size(), NotComputed);
+    numberOfCandidatesOfEdge.resize(pendingEdges.size());
+  }
+
+  inline size_t numEdges() const noexcept { return toVertex.size(); }
+
+  inline Range<Edge> edgesFrom(const Vertex vertex) const noexcept {
+    if (timestampOfStop[vertex] != currentTimestamp) {
+      return Range<Edge>(Edge(0), Edge(0));
+    }
+    const uint32_t i = localIndexOfStop[vertex];
+    return Range<Edge>(Edge(beginOut[i]), Edge(beginOut[i + 1]));
+  }
+
+  inline Vertex get(const AttributeNameWrapper<ToVertex>,
+                    const Edge edge) const noexcept {
+    AssertMsg(edge < numEdges(), edge << " is not a valid edge!");
+    return toVertex[edge];
+  }
+
+  inline int get(const AttributeNameWrapper<TravelTime>,
+                 const Edge edge) const noexcept {
+    AssertMsg(edge < numEdges(), edge << " is not a valid edge!");
+    return travelTime[edge];
+  }
+
+  // Earliest arrival at the head of the route edge from -> to, when departing
+  // at departureTime, and the route that is used for it.
+  inline std::pair<RouteId, int> directConnection(
+      const Vertex from, const Edge edge, const int departureTime) noexcept {
+    AssertMsg(travelTime[edge] == -1, "Edge is not a route edge!");
+    if (firstCandidateOfEdge[edge] == NotComputed) {
+      computeRouteCandidates(from, edge);
+    }
+
+    std::pair<RouteId, int> result = std::make_pair(noRouteId, INFTY);
+    const uint32_t begin = firstCandidateOfEdge[edge];
+    const uint32_t end = begin + numberOfCandidatesOfEdge[edge];
+    for (uint32_t i = begin; i < end; ++i) {
+      const RouteCandidate &candidate = candidates[i];
+      // get the first reachable trip departing >= departureTime
+      const size_t firstReachableTripIndex =
+          data.earliestTripIndexOfLineByStopIndex(
+              candidate.fromIndex, candidate.routeId, departureTime);
+      if (firstReachableTripIndex == (size_t)-1) continue;
+      const int arrivalTime = data.getArrivalTime(
+          candidate.routeId, firstReachableTripIndex, candidate.toIndex);
+      if (arrivalTime < result.second) {
+        result = std::make_pair(candidate.routeId, arrivalTime);
+      }
+    }
+    return result;
+  }
+
+ private:
+  inline void computeRouteCandidates(const Vertex from,
+                                     const Edge edge) noexcept {
+    const std::vector<RAPTOR::RouteSegment> &fromLookup =
+        data.stopLookup[from].incidentLines;
+    const std::vector<RAPTOR::RouteSegment> &toLookup =
+        data.stopLookup[toVertex[edge]].incidentLines;
+
+    AssertMsg(std::is_sorted(fromLookup.begin(), fromLookup.end()),
+              "StopLookup from From is not sorted!");
+    AssertMsg(std::is_sorted(toLookup.begin(), toLookup.end()),
+              "StopLookup from To is not sorted!");
+
+    firstCandidateOfEdge[edge] = candidates.size();
+    size_t i(0);
+    size_t j(0);
+    while (i < fromLookup.size() && j < toLookup.size()) {
+      // if fromLookup[i] and toLookup[j] are on the same line ...
+      // ... *and* fromLookup[i] is before toLookup[j] ...
+      // ... then the line connects the two stops
+      if (fromLookup[i].routeId == toLookup[j].routeId &&
+          fromLookup[i].stopIndex < toLookup[j].stopIndex) {
+        candidates.emplace_back(RouteCandidate{
+            fromLookup[i].routeId, fromLookup[i].stopIndex,
+            toLookup[j].stopIndex});
+        ++i;
+        ++j;
+      } else if (fromLookup[i] < toLookup[j]) {
+        ++i;
+      } else {
+        ++j;
+      }
+    }
+    numberOfCandidatesOfEdge[edge] =
+        candidates.size() - firstCandidateOfEdge[edge];
+  }
+
+ private:
+  const Data &data;
+
+  // Stops with outgoing edges, and their index in beginOut
+  std::vector<uint32_t> localIndexOfStop;
+  std::vector<uint16_t> timestampOfStop;
+  uint16_t currentTimestamp;
+  std::vector<Vertex> fromStops;
+
+  std::vector<PendingEdge> pendingEdges;
+  TimestampedHashMap<bool> edgeSet;
+
+  std::vector<uint32_t> beginOut;
+  std::vector<Vertex> toVertex;
+  std::vector<int> travelTime;
+
+  std::vector<uint32_t> firstCandidateOfEdge;
+  std::vector<uint32_t> numberOfCandidatesOfEdge;
+  std::vector<RouteCandidate> candidates;
+};
+
+}  // namespace TransferPattern
@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <algorithm>
 
+#include "../../../DataStructures/Container/ShortcutSink.h"
 #include "../../../DataStructures/RAPTOR/Data.h"
 #include "../../../DataStructures/TripBased/Data.h"
 #include "../../../Helpers/Console/Progress.h"
@@ -60,8 +61,7 @@ class McULTRABuilder {
       std::cout << "Computing shortcuts with " << threadPinning.numberOfThreads
                 << " threads." << std::endl;
 
-    std::vector<Shortcut> shortcuts;
-
+    ShortcutSink sink(data.numberOfStopEvents(), threadPinning.numberOfThreads);
     Progress progress(data.numberOfStops(), verbose);
     omp_set_num_threads(threadPinning.numberOfThreads);
 #pragma omp parallel
@@ -77,37 +77,14 @@ class McULTRABuilder {
         progress++;
       }
 
-#pragma omp critical
-      {
-        const std::vector<Shortcut>& localShortcuts =
-            shortcutSearch.getShortcuts();
-        for (const Shortcut& shortcut : localShortcuts) {
-          shortcuts.emplace_back(shortcut);
-        }
+      ShortcutSink::Shard& shard = sink.shard(omp_get_thread_num());
+      for (const Shortcut& shortcut : shortcutSearch.getShortcuts()) {
+        shard.insert(Vertex(shortcut.origin), Vertex(shortcut.destination),
+                     shortcut.walkingDistance);
       }
     }
-
-    std::sort(
-        shortcuts.begin(), shortcuts.end(),
-        [](const Shortcut& a, const Shortcut& b) {
-          return (a.origin < b.origin) ||
-                 ((a.origin == b.origin) && (a.destination < b.destination));
-        });
-    stopEventGraph
-        .addEdge(Vertex(shortcuts[0].origin), Vertex(shortcuts[0].destination))
-        .set(TravelTime, shortcuts[0].walkingDistance);
-    for (size_t i = 1; i < shortcuts.size(); i++) {
-      if ((shortcuts[i].origin == shortcuts[i - 1].origin) &&
-          (shortcuts[i].destination == shortcuts[i - 1].destination))
-        continue;
-      stopEventGraph
-          .addEdge(Vertex(shortcuts[i].origin),
-                   Vertex(shortcuts[i].destination))
-          .set(TravelTime, shortcuts[i].walkingDistance);
-    }
-    stopEventGraph.sortEdges(ToVertex);
-
     progress.finished();
+    sink.build(stopEventGraph, verbose);
   }
 
   inline const DynamicTransferGraph& getStopEventGraph() const noexcept {
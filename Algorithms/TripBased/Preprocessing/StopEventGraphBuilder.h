@@ -25,6 +25,12 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <omp.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "../../../DataStructures/TripBased/Data.h"
 #include "../../../Helpers/Console/Progress.h"
 #include "../../../Helpers/MultiThreading.h"
@@ -78,7 +84,6 @@ class StopEventGraphBuilder {
   StopEventGraphBuilder(const TripBased::Data& data)
       : data(data), labels(data.numberOfStops()), timestamp(0) {
     generatedTransfers.addVertices(data.numberOfStopEvents());
-    keptTransfers.addVertices(data.numberOfStopEvents());
   }
 
  public:
@@ -209,11 +214,9 @@ class StopEventGraphBuilder {
         if (keep) keepTransfers.emplace_back(transfer);
       }
 
-      std::stable_sort(keepTransfers.begin(), keepTransfers.end(),
-                       [](const Edge a, const Edge b) { return a > b; });
       for (const Edge transfer : keepTransfers) {
-        keptTransfers.addEdge(fromVertex,
-                              generatedTransfers.get(ToVertex, transfer));
+        keptTransfers.emplace_back(fromVertex,
+                                   generatedTransfers.get(ToVertex, transfer));
       }
     }
   }
@@ -224,11 +227,10 @@ class StopEventGraphBuilder {
     }
   }
 
-  inline const SimpleDynamicGraph& getStopEventGraph() const noexcept {
-    return keptTransfers;
-  }
-
-  inline SimpleDynamicGraph& getStopEventGraph() noexcept {
+  // The kept transfers as (from, to) pairs. All transfers of a stop event are
+  // consecutive, since every stop event is reduced exactly once.
+  inline const std::vector<std::pair<Vertex, Vertex>>& getKeptTransfers()
+      const noexcept {
     return keptTransfers;
   }
 
@@ -301,31 +303,70 @@ class StopEventGraphBuilder {
   const TripBased::Data& data;
 
   SimpleDynamicGraph generatedTransfers;
-  SimpleDynamicGraph keptTransfers;
+  std::vector<std::pair<Vertex, Vertex>> keptTransfers;
 
   std::vector<StopLabel> labels;
   int timestamp;
 };
 
-inline void ComputeStopEventGraph(TripBased::Data& data) noexcept {
-  Progress progress(data.numberOfTrips());
-  StopEventGraphBuilder builder(data);
-  for (const TripId trip : data.trips()) {
-    builder.generateFullTransfers(trip);
-    builder.reduceTransfers(trip);
-    progress++;
+// Counts the transfers of every stop event of the builder's list (first pass)
+inline void CountKeptTransfers(const StopEventGraphBuilder& builder,
+                               std::vector<Edge>& beginOut) noexcept {
+  for (const auto& [from, to] : builder.getKeptTransfers()) {
+    ++beginOut[from + 1];
   }
-  Graph::move(std::move(builder.getStopEventGraph()), data.stopEventGraph);
-  data.stopEventGraph.sortEdges(ToVertex);
-  progress.finished();
 }
 
+// Writes the transfers of the builder's list to their final position in the
+// adjacency array (second pass). Only the builder that reduced a stop event
+// writes its range, so builders can run concurrently without locking.
+inline void WriteKeptTransfers(const StopEventGraphBuilder& builder,
+                               const std::vector<Edge>& beginOut,
+                               std::vector<Vertex>& toVertex) noexcept {
+  const auto& transfers = builder.getKeptTransfers();
+  size_t i = 0;
+  while (i < transfers.size()) {
+    const Vertex from = transfers[i].first;
+    const size_t begin = beginOut[from];
+    size_t j = begin;
+    for (; i < transfers.size() && transfers[i].first == from; ++i, ++j) {
+      toVertex[j] = transfers[i].second;
+    }
+    AssertMsg(j == beginOut[from + 1],
+              "Transfers of stop event " << from << " are not consecutive!");
+    std::sort(toVertex.begin() + begin, toVertex.begin() + j);
+  }
+}
+
+inline void PrefixSum(std::vector<Edge>& beginOut) noexcept {
+  for (size_t i = 1; i < beginOut.size(); i++) {
+    beginOut[i] += beginOut[i - 1];
+  }
+}
+
+inline void ComputeStopEventGraph(
+    TripBased::Data& data, const StopEventGraphBuilder& builder) noexcept {
+  std::vector<Edge> beginOut(data.numberOfStopEvents() + 1, Edge(0));
+  CountKeptTransfers(builder, beginOut);
+  PrefixSum(beginOut);
+  std::vector<Vertex> toVertex(beginOut.back());
+  WriteKeptTransfers(builder, beginOut, toVertex);
+  data.stopEventGraph.assignEdges(std::move(beginOut), std::move(toVertex));
+}
+
+// Every thread reduces its share of the tasks into a flat transfer list.
+// Afterwards, the transfers are counted per stop event, the counts are
+// prefix-summed, and every thread writes its transfers directly into the
+// final adjacency array.
+template <typename REDUCE_TASK>
 inline void ComputeStopEventGraph(TripBased::Data& data,
+                                  const size_t numberOfTasks,
                                   const int numberOfThreads,
-                                  const int pinMultiplier = 1) noexcept {
-  Progress progress(data.numberOfTrips());
-  SimpleEdgeList stopEventGraph;
-  stopEventGraph.addVertices(data.numberOfStopEvents());
+                                  const int pinMultiplier,
+                                  const REDUCE_TASK& reduceTask) noexcept {
+  Progress progress(numberOfTasks);
+  std::vector<Edge> beginOut(data.numberOfStopEvents() + 1, Edge(0));
+  std::vector<Vertex> toVertex;
 
   const int numCores = numberOfCores();
 
@@ -340,34 +381,53 @@ inline void ComputeStopEventGraph(TripBased::Data& data,
                                       << "!");
 
     StopEventGraphBuilder builder(data);
-    const size_t numberOfTrips = data.numberOfTrips();
 
 #pragma omp for schedule(dynamic, 1)
-    for (size_t i = 0; i < numberOfTrips; i++) {
-      const TripId trip = TripId(i);
-      builder.generateFullTransfers(trip);
-      builder.reduceTransfers(trip);
+    for (size_t i = 0; i < numberOfTasks; i++) {
+      reduceTask(builder, i);
       progress++;
     }
 
-#pragma omp critical
+    // Stop events are disjoint between the builders
+    CountKeptTransfers(builder, beginOut);
+
+#pragma omp barrier
+#pragma omp single
     {
-      stopEventGraph.reserve(
-          stopEventGraph.numVertices(),
-          stopEventGraph.numEdges() + builder.getStopEventGraph().numEdges());
-      for (const auto [edge, from] :
-           builder.getStopEventGraph().edgesWithFromVertex()) {
-        stopEventGraph.addEdge(from,
-                               builder.getStopEventGraph().get(ToVertex, edge));
-      }
+      PrefixSum(beginOut);
+      toVertex.resize(beginOut.back());
     }
+
+    WriteKeptTransfers(builder, beginOut, toVertex);
   }
 
-  Graph::move(std::move(stopEventGraph), data.stopEventGraph);
-  data.stopEventGraph.sortEdges(ToVertex);
+  data.stopEventGraph.assignEdges(std::move(beginOut), std::move(toVertex));
   progress.finished();
 }
 
+inline void ComputeStopEventGraph(TripBased::Data& data) noexcept {
+  Progress progress(data.numberOfTrips());
+  StopEventGraphBuilder builder(data);
+  for (const TripId trip : data.trips()) {
+    builder.generateFullTransfers(trip);
+    builder.reduceTransfers(trip);
+    progress++;
+  }
+  ComputeStopEventGraph(data, builder);
+  progress.finished();
+}
+
+inline void ComputeStopEventGraph(TripBased::Data& data,
+                                  const int numberOfThreads,
+                                  const int pinMultiplier = 1) noexcept {
+  ComputeStopEventGraph(
+      data, data.numberOfTrips(), numberOfThreads, pinMultiplier,
+      [](StopEventGraphBuilder& builder, const size_t i) {
+        builder.generateFullTransfers(TripId(i));
+        builder.reduceTransfers(TripId(i));
+      });
+}
+
 inline void ComputeStopEventGraphRouteBased(TripBased::Data& data) noexcept {
   Progress progress(data.numberOfRoutes());
   StopEventGraphBuilder builder(data);
@@ -376,54 +436,19 @@ inline void ComputeStopEventGraphRouteBased(TripBased::Data& data) noexcept {
     builder.reduceTransfers(route);
     progress++;
   }
-  Graph::move(std::move(builder.getStopEventGraph()), data.stopEventGraph);
-  data.stopEventGraph.sortEdges(ToVertex);
+  ComputeStopEventGraph(data, builder);
   progress.finished();
 }
 
 inline void ComputeStopEventGraphRouteBased(
     TripBased::Data& data, const int numberOfThreads,
     const int pinMultiplier = 1) noexcept {
-  Progress progress(data.numberOfRoutes());
-  SimpleEdgeList stopEventGraph;
-  stopEventGraph.addVertices(data.numberOfStopEvents());
-
-  const int numCores = numberOfCores();
-
-  omp_set_num_threads(numberOfThreads);
-#pragma omp parallel
-  {
-    int threadId = omp_get_thread_num();
-    pinThreadToCoreId((threadId * pinMultiplier) % numCores);
-    AssertMsg(omp_get_num_threads() == numberOfThreads,
-              "Number of threads is " << omp_get_num_threads()
-                                      << ", but should be " << numberOfThreads
-                                      << "!");
-
-    StopEventGraphBuilder builder(data);
-    const size_t numberOfRoutes = data.numberOfRoutes();
-
-#pragma omp for schedule(dynamic, 1)
-    for (size_t i = 0; i < numberOfRoutes; i++) {
-      const RouteId route = RouteId(i);
-      builder.generateRouteBasedTransfers(route);
-      builder.reduceTransfers(route);
-      progress++;
-    }
-
-#pragma omp critical
-    {
-      for (const auto [edge, from] :
-           builder.getStopEventGraph().edgesWithFromVertex()) {
-        stopEventGraph.addEdge(from,
-                               builder.getStopEventGraph().get(ToVertex, edge));
-      }
-    }
-  }
-
-  Graph::move(std::move(stopEventGraph), data.stopEventGraph);
-  data.stopEventGraph.sortEdges(ToVertex);
-  progress.finished();
+  ComputeStopEventGraph(
+      data, data.numberOfRoutes(), numberOfThreads, pinMultiplier,
+      [](StopEventGraphBuilder& builder, const size_t i) {
+        builder.generateRouteBasedTransfers(RouteId(i));
+        builder.reduceTransfers(RouteId(i));
+      });
 }
 
 }  // namespace TripBased
@@ -0,0 +1,139 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <emmintrin.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../../../DataStructures/TripBased/Data.h"
+#include "../../../ExternalLibs/aligned_allocator.h"
+
+namespace TripBased {
+
+//! Reached index for 16 independent searches (lanes), e.g., one per departure
+//! time. Every trip holds one byte per lane in an __m128i, lane l stores the
+//! first stop index of the trip that is reached by search l. A set of lanes is
+//! given as a 16 bit mask, so all lanes of a mask are checked and updated with
+//! a few SIMD instructions.
+class LaneReachedIndex {
+ public:
+  static constexpr size_t NumberOfLanes = 16;
+  using LaneMask = uint16_t;
+
+ private:
+  union alignas(16) ReachedElement {
+    ReachedElement() {}
+    __m128i mValues;
+    u_int8_t values[16];
+  };
+
+ public:
+  LaneReachedIndex(const Data& data)
+      : data(data),
+        defaultLabels(data.numberOfTrips()),
+        labels(data.numberOfTrips()) {
+    for (const TripId trip : data.trips()) {
+      if (data.numberOfStopsInTrip(trip) > 255)
+        warning("Trip ", trip, " has ", data.numberOfStopsInTrip(trip),
+                " stops!");
+      defaultLabels[trip].mValues =
+          _mm_set1_epi8(static_cast<char>(data.numberOfStopsInTrip(trip)));
+    }
+  }
+
+  inline void clear() noexcept { labels = defaultLabels; }
+
+  //! The reached stop index of every lane
+  inline __m128i operator()(const TripId trip) const noexcept {
+    AssertMsg(data.isTrip(trip), "Trip " << trip << " is out of bounds!");
+    return labels[trip].mValues;
+  }
+
+  inline u_int8_t operator()(const TripId trip,
+                             const size_t lane) const noexcept {
+    AssertMsg(data.isTrip(trip), "Trip " << trip << " is out of bounds!");
+    return labels[trip].values[lane];
+  }
+
+  //! The lanes of the mask that have not reached the trip at the index yet
+  inline LaneMask notReached(const TripId trip, const u_int8_t index,
+                             const LaneMask lanes) const noexcept {
+    AssertMsg(data.isTrip(trip), "Trip " << trip << " is out of bounds!");
+    return greaterThan(labels[trip].mValues, index) & lanes;
+  }
+
+  //! Marks the trip and all later trips of its route as reached from the
+  //! index on, for all lanes of the mask
+  inline void update(const TripId trip, const u_int8_t index,
+                     const LaneMask lanes) noexcept {
+    AssertMsg(data.isTrip(trip), "Trip " << trip << " is out of bounds!");
+    // index for the lanes of the mask, 255 (i.e., no change) otherwise
+    const __m128i filter =
+        _mm_or_si128(_mm_andnot_si128(toBytes(lanes), _mm_set1_epi8(-1)),
+                     _mm_and_si128(toBytes(lanes),
+                                   _mm_set1_epi8(static_cast<char>(index))));
+    const TripId routeEnd = data.firstTripOfRoute[data.routeOfTrip[trip] + 1];
+    for (TripId tr = trip; tr < routeEnd; tr++) {
+      const __m128i oldValues = labels[tr].mValues;
+      const __m128i newValues = _mm_min_epu8(oldValues, filter);
+      // Later trips are reached at least as early
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(oldValues, newValues)) == 0xFFFF)
+        break;
+      labels[tr].mValues = newValues;
+    }
+  }
+
+  //! The lanes whose value is greater than the index
+  inline static LaneMask greaterThan(const __m128i values,
+                                     const u_int8_t index) noexcept {
+    if (index == 255) return 0;
+    const __m128i bound = _mm_set1_epi8(static_cast<char>(index + 1));
+    return _mm_movemask_epi8(
+        _mm_cmpeq_epi8(_mm_max_epu8(values, bound), values));
+  }
+
+  //! Expands the mask to 0xFF for every set lane and 0x00 otherwise
+  inline static __m128i toBytes(const LaneMask lanes) noexcept {
+    const __m128i bits = _mm_set1_epi64x(0x8040201008040201LL);
+    const __m128i broadcast = _mm_set_epi64x(
+        static_cast<long long>(0x0101010101010101ULL * (lanes >> 8)),
+        static_cast<long long>(0x0101010101010101ULL * (lanes & 0xFF)));
+    return _mm_cmpeq_epi8(_mm_and_si128(broadcast, bits), bits);
+  }
+
+ private:
+  const Data& data;
+
+  std::vector<ReachedElement,
+              aligned_allocator<ReachedElement, alignof(ReachedElement)>>
+      defaultLabels;
+  std::vector<ReachedElement,
+              aligned_allocator<ReachedElement, alignof(ReachedElement)>>
+      labels;
+};
+
+}  // namespace TripBased
@@ -0,0 +1,521 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <vector>
+
+#include "../../../DataStructures/Container/Set.h"
+#include "../../../DataStructures/RAPTOR/Entities/ArrivalLabel.h"
+#include "../../../DataStructures/TripBased/Data.h"
+#include "../../../Helpers/String/String.h"
+#include "../../../Helpers/Vector/Vector.h"
+#include "LaneReachedIndex.h"
+#include "Profiler.h"
+
+namespace TripBased {
+
+// Transitive profile query that runs the searches of up to 16 departure times
+// at once. Every departure time is a lane of the LaneReachedIndex, and every
+// trip segment in the queue carries the mask of the lanes that reached it. So
+// a trip segment that is reached by several departures is scanned once for
+// all of them, and the reached index is checked and updated for all lanes
+// with a few SIMD instructions. The query computes the Pareto optimal
+// (arrival time, number of trips) pairs for every departure time, but no
+// journeys.
+template <typename PROFILER = NoProfiler>
+class MultiDepartureProfileQuery {
+ public:
+  using Profiler = PROFILER;
+  using Type = MultiDepartureProfileQuery<Profiler>;
+  using LaneMask = LaneReachedIndex::LaneMask;
+  static constexpr size_t NumberOfLanes = LaneReachedIndex::NumberOfLanes;
+  static constexpr size_t MaxRounds = 16;
+
+ private:
+  struct TripLabel {
+    TripLabel(const StopEventId begin = noStopEvent,
+              const StopEventId firstEvent = noStopEvent,
+              const LaneMask lanes = 0, const __m128i end = _mm_setzero_si128())
+        : begin(begin), firstEvent(firstEvent), lanes(lanes) {
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(this->end), end);
+    }
+
+    // The lanes of the mask that still scan the stop event
+    inline LaneMask activeLanes(const StopEventId event) const noexcept {
+      return LaneReachedIndex::greaterThan(
+                 _mm_loadu_si128(reinterpret_cast<const __m128i *>(end)),
+                 event - firstEvent) &
+             lanes;
+    }
+
+    StopEventId begin;
+    StopEventId firstEvent;
+    LaneMask lanes;
+    // Per lane, the stop index at which the lane had reached the trip before
+    u_int8_t end[NumberOfLanes];
+  };
+
+  struct EdgeLabel {
+    EdgeLabel(const StopEventId stopEvent = noStopEvent,
+              const TripId trip = noTripId,
+              const StopEventId firstEvent = noStopEvent)
+        : stopEvent(stopEvent), trip(trip), firstEvent(firstEvent) {}
+    StopEventId stopEvent;
+    TripId trip;
+    StopEventId firstEvent;
+  };
+
+  struct RouteLabel {
+    RouteLabel() : numberOfTrips(0) {}
+    inline StopIndex end() const noexcept {
+      return StopIndex(departureTimes.size() / numberOfTrips);
+    }
+    u_int32_t numberOfTrips;
+    std::vector<int> departureTimes;
+  };
+
+  struct InitialTrip {
+    InitialTrip(const TripId trip = noTripId,
+                const StopIndex index = StopIndex(0), const LaneMask lanes = 0)
+        : trip(trip), index(index), lanes(lanes) {}
+
+    inline bool operator<(const InitialTrip &other) const noexcept {
+      return std::tie(trip, index) < std::tie(other.trip, other.index);
+    }
+
+    TripId trip;
+    StopIndex index;
+    LaneMask lanes;
+  };
+
+  using LaneArrivals = std::array<int, NumberOfLanes>;
+
+ public:
+  struct ProfileEntry {
+    ProfileEntry(const int departureTime = never,
+                 const int arrivalTime = never, const size_t numberOfTrips = 0)
+        : departureTime(departureTime),
+          arrivalTime(arrivalTime),
+          numberOfTrips(numberOfTrips) {}
+
+    int departureTime;
+    int arrivalTime;
+    size_t numberOfTrips;
+  };
+
+ public:
+  MultiDepartureProfileQuery(const Data &data)
+      : data(data),
+        reverseTransferGraph(data.raptorData.transferGraph),
+        transferFromSource(data.numberOfStops(), INFTY),
+        transferToTarget(data.numberOfStops(), INFTY),
+        lastSource(StopId(0)),
+        lastTarget(StopId(0)),
+        reachedRoutes(data.numberOfRoutes()),
+        reachedIndex(data),
+        edgeLabels(data.stopEventGraph.numEdges()),
+        routeLabels(data.numberOfRoutes()),
+        sourceStop(noStop),
+        targetStop(noStop),
+        numberOfLanes(0) {
+    reverseTransferGraph.revert();
+    for (const Edge edge : data.stopEventGraph.edges()) {
+      edgeLabels[edge].stopEvent =
+          StopEventId(data.stopEventGraph.get(ToVertex, edge) + 1);
+      edgeLabels[edge].trip =
+          data.tripOfStopEvent[data.stopEventGraph.get(ToVertex, edge)];
+      edgeLabels[edge].firstEvent =
+          data.firstStopEventOfTrip[edgeLabels[edge].trip];
+    }
+    for (const RouteId route : data.raptorData.routes()) {
+      const size_t numberOfStops = data.numberOfStopsInRoute(route);
+      const size_t numberOfTrips = data.raptorData.numberOfTripsInRoute(route);
+      const RAPTOR::StopEvent *stopEvents =
+          data.raptorData.firstTripOfRoute(route);
+      routeLabels[route].numberOfTrips = numberOfTrips;
+      routeLabels[route].departureTimes.resize((numberOfStops - 1) *
+                                               numberOfTrips);
+      for (size_t trip = 0; trip < numberOfTrips; trip++) {
+        for (size_t stopIndex = 0; stopIndex + 1 < numberOfStops; stopIndex++) {
+          routeLabels[route]
+              .departureTimes[(stopIndex * numberOfTrips) + trip] =
+              stopEvents[(trip * numberOfStops) + stopIndex].departureTime;
+        }
+      }
+    }
+    profiler.registerPhases({PHASE_SCAN_INITIAL, PHASE_COLLECT_DEPTIMES,
+                             PHASE_EVALUATE_INITIAL, PHASE_SCAN_TRIPS});
+    profiler.registerMetrics({METRIC_ROUNDS, METRIC_SCANNED_TRIPS,
+                              METRIC_SCANNED_STOPS, METRIC_RELAXED_TRANSFERS,
+                              METRIC_ENQUEUES, METRIC_ADD_JOURNEYS});
+  }
+
+  // Profile query for all departures at the source in [minDepartureTime,
+  // maxDepartureTime), processed in batches of 16 departure times
+  inline void run(const StopId source, const StopId target,
+                  const int minDepartureTime,
+                  const int maxDepartureTime) noexcept {
+    AssertMsg(data.isStop(source), "Source " << source << " is not a stop!");
+    AssertMsg(data.isStop(target), "Target " << target << " is not a stop!");
+    profiler.start();
+    sourceStop = source;
+    targetStop = target;
+    profile.clear();
+    computeInitialAndFinalTransfers();
+    collectDepartures(minDepartureTime, maxDepartureTime);
+    for (size_t i = 0; i < departureTimes.size(); i += NumberOfLanes) {
+      const size_t end = std::min(i + NumberOfLanes, departureTimes.size());
+      runBatch(i, end);
+    }
+    profiler.done();
+  }
+
+  inline void run(const Vertex source, const Vertex target,
+                  const int minDepartureTime,
+                  const int maxDepartureTime) noexcept {
+    run(StopId(source), StopId(target), minDepartureTime, maxDepartureTime);
+  }
+
+  // Runs one search per given departure time (at most 16) simultaneously
+  inline void run(const StopId source, const StopId target,
+                  const std::vector<int> &departures) noexcept {
+    AssertMsg(departures.size() <= NumberOfLanes,
+              "At most " << NumberOfLanes << " departure times are supported!");
+    profiler.start();
+    sourceStop = source;
+    targetStop = target;
+    profile.clear();
+    computeInitialAndFinalTransfers();
+    departureTimes = departures;
+    runBatch(0, departureTimes.size());
+    profiler.done();
+  }
+
+  // The Pareto optimal (arrival time, number of trips) pairs of every
+  // departure time, ordered by departure time
+  inline const std::vector<std::vector<RAPTOR::ArrivalLabel>> &getArrivals()
+      const noexcept {
+    return profile;
+  }
+
+  inline const std::vector<int> &getDepartureTimes() const noexcept {
+    return departureTimes;
+  }
+
+  // The entries of the profile that are not dominated by a later departure
+  inline std::vector<ProfileEntry> getProfile() const noexcept {
+    std::vector<ProfileEntry> result;
+    std::vector<int> bestArrivalTime(MaxRounds + 1, INFTY);
+    for (size_t i = departureTimes.size(); i-- > 0;) {
+      for (const RAPTOR::ArrivalLabel &label : profile[i]) {
+        if (bestArrivalTime[label.numberOfTrips] <= label.arrivalTime) continue;
+        result.emplace_back(departureTimes[i], label.arrivalTime,
+                            label.numberOfTrips);
+        for (size_t k = label.numberOfTrips; k <= MaxRounds; k++) {
+          bestArrivalTime[k] = std::min(bestArrivalTime[k], label.arrivalTime);
+        }
+      }
+    }
+    Vector::reverse(result);
+    return result;
+  }
+
+  inline Profiler &getProfiler() noexcept { return profiler; }
+
+ private:
+  inline void runBatch(const size_t begin, const size_t end) noexcept {
+    numberOfLanes = end - begin;
+    clear();
+    for (size_t lane = 0; lane < numberOfLanes; lane++) {
+      laneDepartureTime[lane] = departureTimes[begin + lane];
+      const int timeToTarget = transferFromSource[targetStop];
+      if (timeToTarget != INFTY) {
+        addTargetLabel(0, lane, laneDepartureTime[lane] + timeToTarget);
+      }
+    }
+    evaluateInitialTransfers();
+    scanTrips();
+    collectArrivals();
+  }
+
+  inline void clear() noexcept {
+    queue.clear();
+    reachedIndex.clear();
+    targetArrivals.assign(1, LaneArrivals());
+    targetArrivals[0].fill(INFTY);
+    minArrivalTime.fill(INFTY);
+  }
+
+  inline void computeInitialAndFinalTransfers() noexcept {
+    profiler.startPhase();
+    transferFromSource[lastSource] = INFTY;
+    for (const Edge edge :
+         data.raptorData.transferGraph.edgesFrom(lastSource)) {
+      const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
+      transferFromSource[stop] = INFTY;
+    }
+    transferToTarget[lastTarget] = INFTY;
+    for (const Edge edge : reverseTransferGraph.edgesFrom(lastTarget)) {
+      const Vertex stop = reverseTransferGraph.get(ToVertex, edge);
+      transferToTarget[stop] = INFTY;
+    }
+    transferFromSource[sourceStop] = 0;
+    for (const Edge edge :
+         data.raptorData.transferGraph.edgesFrom(sourceStop)) {
+      const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
+      transferFromSource[stop] =
+          data.raptorData.transferGraph.get(TravelTime, edge);
+    }
+    transferToTarget[targetStop] = 0;
+    for (const Edge edge : reverseTransferGraph.edgesFrom(targetStop)) {
+      const Vertex stop = reverseTransferGraph.get(ToVertex, edge);
+      transferToTarget[stop] = reverseTransferGraph.get(TravelTime, edge);
+    }
+    lastSource = sourceStop;
+    lastTarget = targetStop;
+
+    reachedRoutes.clear();
+    for (const RAPTOR::RouteSegment &route :
+         data.raptorData.routesContainingStop(sourceStop)) {
+      reachedRoutes.insert(route.routeId);
+    }
+    for (const Edge edge :
+         data.raptorData.transferGraph.edgesFrom(sourceStop)) {
+      const Vertex stop = data.raptorData.transferGraph.get(ToVertex, edge);
+      for (const RAPTOR::RouteSegment &route :
+           data.raptorData.routesContainingStop(StopId(stop))) {
+        reachedRoutes.insert(route.routeId);
+      }
+    }
+    reachedRoutes.sort();
+    profiler.donePhase(PHASE_SCAN_INITIAL);
+  }
+
+  // All distinct departure times at the source (including the walking time to
+  // the stop of the trip) in [minDepartureTime, maxDepartureTime)
+  inline void collectDepartures(const int minDepartureTime,
+                                const int maxDepartureTime) noexcept {
+    profiler.startPhase();
+    departureTimes.clear();
+    for (const RouteId route : reachedRoutes) {
+      const RouteLabel &label = routeLabels[route];
+      const StopId *stops = data.raptorData.stopArrayOfRoute(route);
+      for (StopIndex stopIndex(0); stopIndex < label.end(); stopIndex++) {
+        const int timeFromSource = transferFromSource[stops[stopIndex]];
+        if (timeFromSource == INFTY) continue;
+        const u_int32_t labelIndex = stopIndex * label.numberOfTrips;
+        for (size_t trip = 0; trip < label.numberOfTrips; trip++) {
+          const int departureTime =
+              label.departureTimes[labelIndex + trip] - timeFromSource;
+          if (departureTime < minDepartureTime ||
+              departureTime >= maxDepartureTime)
+            continue;
+          departureTimes.emplace_back(departureTime);
+        }
+      }
+    }
+    std::sort(departureTimes.begin(), departureTimes.end());
+    departureTimes.erase(
+        std::unique(departureTimes.begin(), departureTimes.end()),
+        departureTimes.end());
+    profiler.donePhase(PHASE_COLLECT_DEPTIMES);
+  }
+
+  // Finds the earliest trip of every reached route and lane. Lanes boarding
+  // the same trip at the same stop share one queue entry.
+  inline void evaluateInitialTransfers() noexcept {
+    profiler.startPhase();
+    initialTrips.clear();
+    for (const RouteId route : reachedRoutes) {
+      const RouteLabel &label = routeLabels[route];
+      const TripId firstTrip = data.firstTripOfRoute[route];
+      const StopId *stops = data.raptorData.stopArrayOfRoute(route);
+      for (StopIndex stopIndex(0); stopIndex < label.end(); stopIndex++) {
+        const int timeFromSource = transferFromSource[stops[stopIndex]];
+        if (timeFromSource == INFTY) continue;
+        const int *times =
+            &label.departureTimes[stopIndex * label.numberOfTrips];
+        for (size_t lane = 0; lane < numberOfLanes; lane++) {
+          const int stopDepartureTime =
+              laneDepartureTime[lane] + timeFromSource;
+          const size_t tripIndex =
+              std::lower_bound(times, times + label.numberOfTrips,
+                               stopDepartureTime) -
+              times;
+          if (tripIndex >= label.numberOfTrips) continue;
+          initialTrips.emplace_back(TripId(firstTrip + tripIndex),
+                                    StopIndex(stopIndex + 1),
+                                    LaneMask(1 << lane));
+        }
+      }
+    }
+    std::sort(initialTrips.begin(), initialTrips.end());
+    for (size_t i = 0; i < initialTrips.size();) {
+      LaneMask lanes = 0;
+      size_t j = i;
+      for (; j < initialTrips.size() &&
+             initialTrips[j].trip == initialTrips[i].trip &&
+             initialTrips[j].index == initialTrips[i].index;
+           j++) {
+        lanes |= initialTrips[j].lanes;
+      }
+      enqueue(initialTrips[i].trip, initialTrips[i].index, lanes);
+      i = j;
+    }
+    profiler.donePhase(PHASE_EVALUATE_INITIAL);
+  }
+
+  inline void scanTrips() noexcept {
+    profiler.startPhase();
+    size_t roundBegin = 0;
+    size_t roundEnd = queue.size();
+    size_t n = 1;
+    while (roundBegin < roundEnd && n < MaxRounds) {
+      profiler.countMetric(METRIC_ROUNDS);
+      targetArrivals.emplace_back(targetArrivals.back());
+      // Evaluate final transfers in order to check if the target is
+      // reachable
+      for (size_t i = roundBegin; i < roundEnd; i++) {
+        const TripLabel &label = queue[i];
+        profiler.countMetric(METRIC_SCANNED_TRIPS);
+        LaneMask lanes = label.lanes;
+        for (StopEventId j = label.begin; lanes != 0; j++) {
+          lanes &= label.activeLanes(j);
+          if (lanes == 0) break;
+          profiler.countMetric(METRIC_SCANNED_STOPS);
+          const int arrivalTime = data.arrivalEvents[j].arrivalTime;
+          lanes &= lanesBefore(arrivalTime, lanes);
+          const int timeToTarget = transferToTarget[data.arrivalEvents[j].stop];
+          if (timeToTarget == INFTY) continue;
+          for (LaneMask m = lanes; m != 0; m &= m - 1) {
+            addTargetLabel(n, std::countr_zero(m), arrivalTime + timeToTarget);
+          }
+        }
+      }
+      if (n + 1 == MaxRounds) break;
+      // Relax the transfers of the stop events that improve a lane
+      for (size_t i = roundBegin; i < roundEnd; i++) {
+        const TripLabel label = queue[i];
+        LaneMask lanes = label.lanes;
+        for (StopEventId j = label.begin; lanes != 0; j++) {
+          lanes &= label.activeLanes(j);
+          lanes &= lanesBefore(data.arrivalEvents[j].arrivalTime, lanes);
+          if (lanes == 0) break;
+          for (const Edge edge : data.stopEventGraph.edgesFrom(Vertex(j))) {
+            profiler.countMetric(METRIC_RELAXED_TRANSFERS);
+            const EdgeLabel &edgeLabel = edgeLabels[edge];
+            enqueue(edgeLabel.trip,
+                    StopIndex(edgeLabel.stopEvent - edgeLabel.firstEvent),
+                    lanes);
+          }
+        }
+      }
+      roundBegin = roundEnd;
+      roundEnd = queue.size();
+      n++;
+    }
+    profiler.donePhase(PHASE_SCAN_TRIPS);
+  }
+
+  inline void enqueue(const TripId trip, const StopIndex index,
+                      const LaneMask lanes) noexcept {
+    profiler.countMetric(METRIC_ENQUEUES);
+    const LaneMask newLanes = reachedIndex.notReached(trip, index, lanes);
+    if (newLanes == 0) return;
+    const StopEventId firstEvent = data.firstStopEventOfTrip[trip];
+    queue.emplace_back(StopEventId(firstEvent + index), firstEvent, newLanes,
+                       reachedIndex(trip));
+    reachedIndex.update(trip, index, newLanes);
+  }
+
+  // The lanes of the mask that have not reached the target by the given time
+  inline LaneMask lanesBefore(const int arrivalTime,
+                              const LaneMask lanes) const noexcept {
+    LaneMask result = 0;
+    for (LaneMask m = lanes; m != 0; m &= m - 1) {
+      const size_t lane = std::countr_zero(m);
+      if (arrivalTime < minArrivalTime[lane]) result |= LaneMask(1 << lane);
+    }
+    return result;
+  }
+
+  inline void addTargetLabel(const size_t round, const size_t lane,
+                             const int arrivalTime) noexcept {
+    profiler.countMetric(METRIC_ADD_JOURNEYS);
+    if (arrivalTime >= minArrivalTime[lane]) return;
+    targetArrivals[round][lane] = arrivalTime;
+    minArrivalTime[lane] = arrivalTime;
+  }
+
+  inline void collectArrivals() noexcept {
+    for (size_t lane = 0; lane < numberOfLanes; lane++) {
+      std::vector<RAPTOR::ArrivalLabel> &arrivals = profile.emplace_back();
+      for (size_t round = 0; round < targetArrivals.size(); round++) {
+        const int arrivalTime = targetArrivals[round][lane];
+        if (arrivalTime >= INFTY) continue;
+        if (!arrivals.empty() && arrivals.back().arrivalTime <= arrivalTime)
+          continue;
+        arrivals.emplace_back(arrivalTime, round);
+      }
+    }
+  }
+
+ private:
+  const Data &data;
+
+  TransferGraph reverseTransferGraph;
+  std::vector<int> transferFromSource;
+  std::vector<int> transferToTarget;
+  StopId lastSource;
+  StopId lastTarget;
+
+  IndexedSet<false, RouteId> reachedRoutes;
+  std::vector<InitialTrip> initialTrips;
+
+  std::vector<TripLabel> queue;
+  LaneReachedIndex reachedIndex;
+
+  std::vector<LaneArrivals> targetArrivals;
+  LaneArrivals minArrivalTime;
+
+  std::vector<EdgeLabel> edgeLabels;
+  std::vector<RouteLabel> routeLabels;
+
+  StopId sourceStop;
+  StopId targetStop;
+
+  std::vector<int> departureTimes;
+  LaneArrivals laneDepartureTime;
+  size_t numberOfLanes;
+
+  std::vector<std::vector<RAPTOR::ArrivalLabel>> profile;
+
+  Profiler profiler;
+};
+
+}  // namespace TripBased
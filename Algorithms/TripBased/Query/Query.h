@@ -31,14 +31,18 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../CH/Query/BucketQuery.h"
 #include "Profiler.h"
 #include "ReachedIndex.h"
+#include "TimestampedReachedIndex.h"
 
 namespace TripBased {
 
-template <typename PROFILER = NoProfiler>
+// REACHED_INDEX is either ReachedIndex or TimestampedReachedIndex
+template <typename PROFILER = NoProfiler,
+          typename REACHED_INDEX = ReachedIndex>
 class Query {
  public:
   using Profiler = PROFILER;
-  using Type = Query<Profiler>;
+  using ReachedIndexType = REACHED_INDEX;
+  using Type = Query<Profiler, ReachedIndexType>;
 
  private:
   struct TripLabel {
@@ -420,7 +424,7 @@ class Query {
   std::vector<TripLabel> queue;
   std::vector<EdgeRange> edgeRanges;
   size_t queueSize;
-  ReachedIndex reachedIndex;
+  ReachedIndexType reachedIndex;
 
   std::vector<TargetLabel> targetLabels;
   int minArrivalTime;
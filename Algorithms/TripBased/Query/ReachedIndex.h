@@ -26,6 +26,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include <algorithm>
+#include <span>
 
 #include "../../../DataStructures/TripBased/Data.h"
 
@@ -33,8 +34,12 @@ namespace TripBased {
 
 class ReachedIndex {
  public:
-  ReachedIndex(const Data& data)
-      : data(data),
+  // DATA is a TripBased::Data or any other data providing the same trip
+  // layout (e.g., the memory mapped TREX data)
+  template <typename DATA>
+  ReachedIndex(const DATA& data)
+      : firstTripOfRoute(data.firstTripOfRoute),
+        routeOfTrip(data.routeOfTrip),
         labels(data.numberOfTrips(), -1),
         defaultLabels(data.numberOfTrips(), -1) {
     for (const TripId trip : data.trips()) {
@@ -49,8 +54,8 @@ class ReachedIndex {
   inline void clear() noexcept { labels = defaultLabels; }
 
   inline void clear(const RouteId route) noexcept {
-    const TripId start = data.firstTripOfRoute[route];
-    const TripId end = data.firstTripOfRoute[route + 1];
+    const TripId start = firstTripOfRoute[route];
+    const TripId end = firstTripOfRoute[route + 1];
     std::copy_n(defaultLabels.begin() + start, end - start,
                 labels.begin() + start);
   }
@@ -67,7 +72,7 @@ class ReachedIndex {
 
   inline void update(const TripId trip, const StopIndex index) noexcept {
     AssertMsg(trip < labels.size(), "Trip " << trip << " is out of bounds!");
-    const TripId routeEnd = data.firstTripOfRoute[data.routeOfTrip[trip] + 1];
+    const TripId routeEnd = firstTripOfRoute[routeOfTrip[trip] + 1];
     for (TripId i = trip; i < routeEnd; i++) {
       if (labels[i] <= index) break;
       labels[i] = index;
@@ -77,13 +82,14 @@ class ReachedIndex {
   inline void updateRaw(const TripId trip, const TripId tripEnd,
                         const StopIndex index) noexcept {
     AssertMsg(trip < labels.size(), "Trip " << trip << " is out of bounds!");
-    AssertMsg(tripEnd <= data.firstTripOfRoute[data.routeOfTrip[trip] + 1],
+    AssertMsg(tripEnd <= firstTripOfRoute[routeOfTrip[trip] + 1],
               "Trip end" << tripEnd << " is out of bounds!");
     std::fill(labels.begin() + trip, labels.begin() + tripEnd, index);
   }
 
  private:
-  const Data& data;
+  std::span<const TripId> firstTripOfRoute;
+  std::span<const RouteId> routeOfTrip;
 
   std::vector<u_int8_t> labels;
 
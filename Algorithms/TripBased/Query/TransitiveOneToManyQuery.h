@@ -110,7 +110,8 @@ class TransitiveOneToManyQuery {
         // targetStop(noStop),
         sourceDepartureTime(never),
         currentCell(0),
-        currentLevel(0) {
+        currentLevel(0),
+        currentShift(0) {
     reverseTransferGraph.revert();
     for (const Edge edge : data.stopEventGraph.edges()) {
       edgeLabels[edge].stopEvent =
@@ -145,7 +146,7 @@ class TransitiveOneToManyQuery {
   }
 
   inline void run(const StopId source, const int departureTime,
-                  const std::vector<StopId> &targets, const std::uint16_t cell,
+                  const std::vector<StopId> &targets, const std::uint32_t cell,
                   const int level) noexcept {
     profiler.start();
 
@@ -163,6 +164,7 @@ class TransitiveOneToManyQuery {
 
     currentCell = cell;
     currentLevel = level;
+    currentShift = data.getCellShift(level);
 
     computeInitialAndFinalTransfers();
     evaluateInitialTransfers();
@@ -427,7 +429,7 @@ class TransitiveOneToManyQuery {
       return;
 
     StopId toStop = data.getStopOfStopEvent((label.stopEvent));
-    if ((data.cellIds[toStop] >> currentLevel) != currentCell) return;
+    if ((data.cellIds[toStop] >> currentShift) != currentCell) return;
 
     queue[queueSize] = TripLabel(
         label.stopEvent,
@@ -565,8 +567,9 @@ class TransitiveOneToManyQuery {
   /* StopId targetStop; */
   int sourceDepartureTime;
 
-  std::uint16_t currentCell;
+  std::uint32_t currentCell;
   int currentLevel;
+  int currentShift;
 
   Profiler profiler;
 };
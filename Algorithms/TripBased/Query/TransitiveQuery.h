@@ -31,14 +31,18 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../../DataStructures/TripBased/Data.h"
 #include "Profiler.h"
 #include "ReachedIndex.h"
+#include "TimestampedReachedIndex.h"
 
 namespace TripBased {
 
-template <typename PROFILER = NoProfiler>
+// REACHED_INDEX is either ReachedIndex or TimestampedReachedIndex
+template <typename PROFILER = NoProfiler,
+          typename REACHED_INDEX = ReachedIndex>
 class TransitiveQuery {
  public:
   using Profiler = PROFILER;
-  using Type = TransitiveQuery<Profiler>;
+  using ReachedIndexType = REACHED_INDEX;
+  using Type = TransitiveQuery<Profiler, ReachedIndexType>;
 
  private:
   struct TripLabel {
@@ -495,7 +499,7 @@ class TransitiveQuery {
   std::vector<TripLabel> queue;
   std::vector<EdgeRange> edgeRanges;
   size_t queueSize;
-  ReachedIndex reachedIndex;
+  ReachedIndexType reachedIndex;
 
   std::vector<TargetLabel> targetLabels;
   int minArrivalTime;
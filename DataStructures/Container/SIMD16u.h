@@ -61,6 +61,10 @@ struct SIMD16u {
   SIMD16u operator-(const SIMD16u &o) const noexcept {
     return SIMD16u(_mm256_sub_epi16(v.reg, o.v.reg));
   }
+  // saturating addition, i.e., 0xFFFF + x = 0xFFFF
+  SIMD16u adds(const SIMD16u &o) const noexcept {
+    return SIMD16u(_mm256_adds_epu16(v.reg, o.v.reg));
+  }
 
   SIMD16u operator&(const SIMD16u &o) const noexcept {
     return SIMD16u(_mm256_and_si256(v.reg, o.v.reg));
@@ -0,0 +1,199 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "../../Helpers/Assert.h"
+#include "../../Helpers/MultiThreading.h"
+#include "../../Helpers/String/String.h"
+#include "../../Helpers/Timer.h"
+#include "../../Helpers/Types.h"
+#include "../Attributes/AttributeNames.h"
+#include "TimestampedHashMap.h"
+
+// Collects the shortcuts found by concurrent shortcut searches. Every thread
+// writes into its own shard, so inserting needs neither locks nor a copy of
+// the shortcut graph. Afterwards, build() groups the shortcuts of all shards
+// by origin, removes duplicates and adds them to the shortcut graph. The
+// sink measures the time from its creation (or the last clear()) until
+// build(), which is the time spent in the shortcut searches.
+class ShortcutSink {
+ public:
+  struct Entry {
+    Vertex from;
+    Vertex to;
+    int travelTime;
+  };
+
+  class alignas(64) Shard {
+    friend ShortcutSink;
+
+   public:
+    inline void insert(const Vertex from, const Vertex to,
+                       const int travelTime) noexcept {
+      const uint32_t index =
+          indexOf.findOrInsert(key(from, to), uint32_t(entries.size()));
+      if (index == entries.size()) {
+        entries.emplace_back(Entry{from, to, travelTime});
+        return;
+      }
+      AssertMsg(entries[index].travelTime == travelTime,
+                "Edge from " << from << " to " << to
+                             << " has inconclusive travel time ("
+                             << entries[index].travelTime << ", "
+                             << travelTime << ")");
+    }
+
+    inline bool contains(const Vertex from, const Vertex to) const noexcept {
+      return indexOf.contains(key(from, to));
+    }
+
+    inline size_t size() const noexcept { return entries.size(); }
+
+    inline void clear() noexcept {
+      entries.clear();
+      indexOf.clear();
+    }
+
+   private:
+    inline static uint64_t key(const Vertex from, const Vertex to) noexcept {
+      return (uint64_t(from) << 32) | uint64_t(to);
+    }
+
+   private:
+    std::vector<Entry> entries;
+    TimestampedHashMap<uint32_t> indexOf;
+  };
+
+ public:
+  ShortcutSink(const size_t numberOfVertices, const size_t numberOfShards)
+      : numberOfVertices(numberOfVertices), shards(numberOfShards) {}
+
+  inline Shard& shard(const size_t i) noexcept {
+    AssertMsg(i < shards.size(), "Shard " << i << " does not exist!");
+    return shards[i];
+  }
+
+  inline size_t numberOfShards() const noexcept { return shards.size(); }
+
+  inline size_t size() const noexcept {
+    size_t result = 0;
+    for (const Shard& shard : shards) result += shard.size();
+    return result;
+  }
+
+  inline void clear() noexcept {
+    for (Shard& shard : shards) shard.clear();
+    timer.restart();
+  }
+
+  // Adds all collected shortcuts to graph, which must have numberOfVertices
+  // vertices. The shortcuts are bucketed into a CSR array by origin, then the
+  // buckets are sorted and deduplicated in parallel. Shortcuts that are
+  // already contained in graph are not added again.
+  template <typename GRAPH>
+  inline void build(GRAPH& graph, const bool verbose = false) noexcept {
+    if (verbose)
+      std::cout << "Shortcut searches took "
+                << String::msToString(timer.elapsedMilliseconds()) << std::endl;
+    timer.restart();
+    AssertMsg(graph.numVertices() == numberOfVertices,
+              "Graph has " << graph.numVertices() << " vertices, but should have "
+                           << numberOfVertices << "!");
+    std::vector<size_t> beginOut(numberOfVertices + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < shards.size(); i++) {
+      for (const Entry& entry : shards[i].entries) {
+        atomicFetchAdd<size_t>(beginOut[entry.from + 1], 1);
+      }
+    }
+    for (size_t i = 1; i < beginOut.size(); i++) {
+      beginOut[i] += beginOut[i - 1];
+    }
+
+    std::vector<Entry> edges(beginOut.back());
+    std::vector<size_t> position(beginOut.begin(), beginOut.end() - 1);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < shards.size(); i++) {
+      for (const Entry& entry : shards[i].entries) {
+        edges[atomicFetchAdd<size_t>(position[entry.from], 1)] = entry;
+      }
+    }
+
+    std::vector<size_t>& endOut = position;
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t from = 0; from < numberOfVertices; from++) {
+      const auto begin = edges.begin() + beginOut[from];
+      const auto end = edges.begin() + beginOut[from + 1];
+      std::sort(begin, end, [](const Entry& a, const Entry& b) {
+        return a.to < b.to;
+      });
+      const auto last =
+          std::unique(begin, end, [](const Entry& a, const Entry& b) {
+            if (a.to != b.to) return false;
+            AssertMsg(a.travelTime == b.travelTime,
+                      "Edge from " << a.from << " to " << a.to
+                                   << " has inconclusive travel time ("
+                                   << a.travelTime << ", " << b.travelTime
+                                   << ")");
+            return true;
+          });
+      endOut[from] = last - edges.begin();
+    }
+
+    const bool graphHasEdges = graph.numEdges() > 0;
+    for (const Vertex from : graph.vertices()) {
+      for (size_t i = beginOut[from]; i < endOut[from]; i++) {
+        const Entry& entry = edges[i];
+        if (graphHasEdges && graph.hasEdge(from, entry.to)) {
+          AssertMsg(graph.get(TravelTime, graph.findEdge(from, entry.to)) ==
+                        entry.travelTime,
+                    "Edge from " << from << " to " << entry.to
+                                 << " has inconclusive travel time ("
+                                 << graph.get(TravelTime,
+                                              graph.findEdge(from, entry.to))
+                                 << ", " << entry.travelTime << ")");
+          continue;
+        }
+        graph.addEdge(from, entry.to).set(TravelTime, entry.travelTime);
+      }
+    }
+    if (verbose)
+      std::cout << "Collected " << String::prettyInt(graph.numEdges())
+                << " shortcuts in "
+                << String::msToString(timer.elapsedMilliseconds()) << std::endl;
+  }
+
+ private:
+  size_t numberOfVertices;
+  std::vector<Shard> shards;
+  Timer timer;
+};
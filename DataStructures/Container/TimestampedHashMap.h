@@ -0,0 +1,123 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "../../Helpers/Assert.h"
+
+// Open addressing hash map from 64 bit keys to values. clear() is O(1): the
+// entries of older rounds are invalidated by a round counter, so the map can
+// be reused for many short runs (e.g., one per query) without reallocating.
+template <typename VALUE>
+class TimestampedHashMap {
+ public:
+  using Value = VALUE;
+  using Type = TimestampedHashMap<Value>;
+
+ private:
+  struct Entry {
+    uint64_t key{0};
+    uint32_t round{0};
+    Value value{};
+  };
+
+ public:
+  TimestampedHashMap(const size_t initialCapacity = 1 << 10)
+      : entries(std::bit_ceil(std::max<size_t>(initialCapacity, 16))),
+        shift(64 - std::countr_zero(entries.size())),
+        round(1),
+        numberOfEntries(0) {}
+
+  inline void clear() noexcept {
+    numberOfEntries = 0;
+    if (++round == 0) {
+      for (Entry& entry : entries) entry.round = 0;
+      round = 1;
+    }
+  }
+
+  inline size_t size() const noexcept { return numberOfEntries; }
+
+  inline bool empty() const noexcept { return numberOfEntries == 0; }
+
+  // Returns the value of the key. If the key is not contained, it is inserted
+  // with the given value first. The reference is valid until the next
+  // insertion.
+  inline Value& findOrInsert(const uint64_t key, const Value& value) noexcept {
+    if ((numberOfEntries + 1) * 2 > entries.size()) grow();
+    const size_t mask = entries.size() - 1;
+    for (size_t i = slot(key);; i = (i + 1) & mask) {
+      Entry& entry = entries[i];
+      if (entry.round != round) {
+        entry.key = key;
+        entry.round = round;
+        entry.value = value;
+        numberOfEntries++;
+        return entry.value;
+      }
+      if (entry.key == key) return entry.value;
+    }
+  }
+
+  inline bool contains(const uint64_t key) const noexcept {
+    const size_t mask = entries.size() - 1;
+    for (size_t i = slot(key); entries[i].round == round; i = (i + 1) & mask) {
+      if (entries[i].key == key) return true;
+    }
+    return false;
+  }
+
+  inline long long byteSize() const noexcept {
+    return entries.capacity() * sizeof(Entry);
+  }
+
+ private:
+  inline size_t slot(const uint64_t key) const noexcept {
+    return (key * 0x9E3779B97F4A7C15ull) >> shift;
+  }
+
+  inline void grow() noexcept {
+    std::vector<Entry> oldEntries(entries.size() * 2);
+    oldEntries.swap(entries);
+    shift--;
+    const size_t mask = entries.size() - 1;
+    for (const Entry& entry : oldEntries) {
+      if (entry.round != round) continue;
+      size_t i = slot(entry.key);
+      while (entries[i].round == round) i = (i + 1) & mask;
+      entries[i] = entry;
+    }
+  }
+
+ private:
+  std::vector<Entry> entries;
+  int shift;
+  uint32_t round;
+  size_t numberOfEntries;
+};
@@ -1,5 +1,7 @@
 // Taken and adapted from here
 // https://github.com/iwiwi/radix-heap/blob/master/radix_heap.h
+#pragma once
+
 #include <algorithm>
 #include <array>
 #include <cassert>
@@ -265,6 +265,32 @@ class StaticGraphImplementation {
     edgeAttributes.reserve(numEdges);
   }
 
+  // Replaces all edges by the given adjacency array, i.e., the edges of vertex
+  // v are newBeginOut[v] to newBeginOut[v + 1]. The number of vertices is
+  // adjusted to the array, and all other edge attributes are set to their
+  // default value.
+  inline void assignEdges(std::vector<Edge>&& newBeginOut,
+                          std::vector<Vertex>&& toVertex) noexcept {
+    static_assert(!HasEdgeAttribute(ReverseEdge),
+                  "Reverse edges are not supported!");
+    AssertMsg(!newBeginOut.empty() && newBeginOut.back() == toVertex.size(),
+              "The adjacency array has the wrong number of edges!");
+    vertexAttributes.resize(newBeginOut.size() - 1);
+    edgeAttributes.clear();
+    edgeAttributes.resize(toVertex.size());
+    get(ToVertex).swap(toVertex);
+    beginOut.swap(newBeginOut);
+    if constexpr (HasEdgeAttribute(FromVertex)) {
+      for (const Vertex vertex : vertices()) {
+        for (const Edge edge : edgesFrom(vertex)) {
+          set(FromVertex, edge, vertex);
+        }
+      }
+    }
+    checkVectorSize();
+    AssertMsg(satisfiesInvariants(), "Invariants not satisfied!");
+  }
+
   inline Vertex addVertex() noexcept {
     addVertices();
     return Vertex(numVertices() - 1);
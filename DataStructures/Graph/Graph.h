@@ -178,14 +178,19 @@ using DynamicQueryGraph = DynamicGraph<NoVertexAttributes, WithTravelTime>;
 using WithDurationFunctionAndTravelTimeAndTransferCost = List<
     Attribute<DurationFunction, std::vector<std::pair<uint32_t, uint32_t>>>,
     Attribute<TravelTime, int>, Attribute<TransferCost, uint8_t>>;
+using WithTravelTimeAndTransferCost =
+    List<Attribute<TravelTime, int>, Attribute<TransferCost, uint8_t>>;
 using WithRouteVertex = List<Attribute<RouteVertex, RouteId>>;
 
 using DynamicTimeDependentRouteGraph =
     DynamicGraph<WithRouteVertex,
                  WithDurationFunctionAndTravelTimeAndTransferCost>;
-using TimeDependentRouteGraph =
+using StaticTimeDependentRouteGraph =
     StaticGraph<WithRouteVertex,
                 WithDurationFunctionAndTravelTimeAndTransferCost>;
+// The travel time functions of the route edges are stored in TD::Data
+using TimeDependentRouteGraph =
+    StaticGraph<WithRouteVertex, WithTravelTimeAndTransferCost>;
 
 // TE
 using WithTravelTimeAndHop =
@@ -196,9 +201,11 @@ using DynamicTimeExpandedGraph =
 using TimeExpandedGraph = StaticGraph<WithStopVertex, WithTravelTimeAndHop>;
 
 // TB-TE
-using WithCellId = List<Attribute<CellId, uint16_t>>;
+using WithCellId = List<Attribute<CellId, uint32_t>>;
+// OriginalEdge refers to the stop event graph, hence it is stored as a plain
+// integer (attributes of type Edge are remapped when the edges are reordered)
 using WithTransferCostAndOriginalEdge =
-    List<Attribute<TransferCost, uint16_t>, Attribute<OriginalEdge, Edge>>;
+    List<Attribute<TransferCost, uint16_t>, Attribute<OriginalEdge, uint32_t>>;
 
 using DynamicTBTEGraph =
     DynamicGraph<WithCellId, WithTransferCostAndOriginalEdge>;
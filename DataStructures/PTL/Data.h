@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include <algorithm>
+#include <span>
 #include <vector>
 
 #include "../TE/Data.h"
@@ -38,14 +39,18 @@ class Data {
   Data(TE::Data &teData)
       : teData(teData),
         fwdVertices(teData.numberOfTEVertices()),
-        bwdVertices(teData.numberOfTEVertices()){};
+        bwdVertices(teData.numberOfTEVertices()),
+        firstFwdHub(teData.numberOfTEVertices() + 1, 0),
+        firstBwdHub(teData.numberOfTEVertices() + 1, 0){};
 
   Data(TE::Data &teData, const std::string fileName)
       : teData(teData),
         fwdVertices(teData.numberOfTEVertices()),
-        bwdVertices(teData.numberOfTEVertices()) {
+        bwdVertices(teData.numberOfTEVertices()),
+        firstFwdHub(teData.numberOfTEVertices() + 1, 0),
+        firstBwdHub(teData.numberOfTEVertices() + 1, 0) {
     readViennotLabels(fileName);
-    sortLabels();
+    buildFlatLabels();
   };
 
   inline static Data FromBinary(const std::string &fileName) noexcept {
@@ -154,15 +159,12 @@ class Data {
   }
 
   inline void clear() noexcept {
-    AssertMsg(fwdVertices.size() == (teData.numberOfTEVertices()),
-              "Not the same size!");
-    AssertMsg(bwdVertices.size() == (teData.numberOfTEVertices()),
-              "Not the same size!");
-
-    for (Vertex v = Vertex(0); v < (teData.numberOfTEVertices()); ++v) {
-      fwdVertices.clear();
-      bwdVertices.clear();
-    }
+    fwdVertices.assign(teData.numberOfTEVertices(), {});
+    bwdVertices.assign(teData.numberOfTEVertices(), {});
+    firstFwdHub.assign(teData.numberOfTEVertices() + 1, 0);
+    firstBwdHub.assign(teData.numberOfTEVertices() + 1, 0);
+    fwdHubs.clear();
+    bwdHubs.clear();
   }
 
   inline void sortLabels() noexcept {
@@ -177,6 +179,15 @@ class Data {
     }
   }
 
+  // Sorts the labels collected in fwdVertices / bwdVertices and moves them into
+  // the flat (CSR) layout used by the queries. The per vertex vectors are
+  // released afterwards.
+  inline void buildFlatLabels() noexcept {
+    sortLabels();
+    flatten(fwdVertices, firstFwdHub, fwdHubs);
+    flatten(bwdVertices, firstBwdHub, bwdHubs);
+  }
+
   inline size_t numberOfStops() const noexcept {
     return teData.numberOfStops();
   }
@@ -196,7 +207,7 @@ class Data {
   }
 
   inline size_t numberOfStopEvents() const noexcept {
-    return teData.events.size();
+    return teData.numberOfStopEvents();
   }
 
   inline bool isEvent(const Vertex event) const noexcept {
@@ -220,28 +231,30 @@ class Data {
     size_t totalSizeBWD = 0;
     Vertex maxBwdVertex = noVertex;
 
-    AssertMsg(fwdVertices.size() == (teData.numberOfTEVertices()),
+    AssertMsg(firstFwdHub.size() == (teData.numberOfTEVertices() + 1),
               "Not the same size!");
-    AssertMsg(bwdVertices.size() == (teData.numberOfTEVertices()),
+    AssertMsg(firstBwdHub.size() == (teData.numberOfTEVertices() + 1),
               "Not the same size!");
 
     for (Vertex v = Vertex(0); v < teData.numberOfTEVertices(); ++v) {
-      minSizeFWD = std::min(minSizeFWD, fwdVertices[v].size());
-      maxSizeFWD = std::max(maxSizeFWD, fwdVertices[v].size());
+      const size_t fwdSize = firstFwdHub[v + 1] - firstFwdHub[v];
+      minSizeFWD = std::min(minSizeFWD, fwdSize);
+      maxSizeFWD = std::max(maxSizeFWD, fwdSize);
 
-      if (maxSizeFWD == fwdVertices[v].size()) {
+      if (maxSizeFWD == fwdSize) {
         maxFwdVertex = v;
       }
 
-      totalSizeFWD += fwdVertices[v].size();
+      totalSizeFWD += fwdSize;
 
-      minSizeBWD = std::min(minSizeBWD, bwdVertices[v].size());
-      maxSizeBWD = std::max(maxSizeBWD, bwdVertices[v].size());
+      const size_t bwdSize = firstBwdHub[v + 1] - firstBwdHub[v];
+      minSizeBWD = std::min(minSizeBWD, bwdSize);
+      maxSizeBWD = std::max(maxSizeBWD, bwdSize);
 
-      if (maxSizeBWD == bwdVertices[v].size()) {
+      if (maxSizeBWD == bwdSize) {
         maxBwdVertex = v;
       }
-      totalSizeBWD += bwdVertices[v].size();
+      totalSizeBWD += bwdSize;
     }
 
     std::cout << "PTL public transit data:" << std::endl;
@@ -282,36 +295,76 @@ class Data {
   }
 
   inline void serialize(const std::string &fileName) const noexcept {
-    IO::serialize(fileName, fwdVertices, bwdVertices);
+    IO::serialize(fileName, firstFwdHub, fwdHubs, firstBwdHub, bwdHubs);
     teData.serialize(fileName + ".te");
   }
 
   inline void deserialize(const std::string &fileName) noexcept {
-    IO::deserialize(fileName, fwdVertices, bwdVertices);
+    IO::deserialize(fileName, firstFwdHub, fwdHubs, firstBwdHub, bwdHubs);
     teData.deserialize(fileName + ".te");
   }
 
   inline long long byteSize() const noexcept {
-    long long result = Vector::byteSize(fwdVertices);
-    result += Vector::byteSize(bwdVertices);
+    long long result = labelByteSize();
     result += teData.byteSize();
     return result;
   }
 
-  inline std::vector<Vertex> &getFwdHubs(const Vertex vertex) noexcept {
+  inline long long labelByteSize() const noexcept {
+    long long result = Vector::byteSize(firstFwdHub);
+    result += Vector::byteSize(fwdHubs);
+    result += Vector::byteSize(firstBwdHub);
+    result += Vector::byteSize(bwdHubs);
+    return result;
+  }
+
+  inline size_t numberOfLabelEntries() const noexcept {
+    return fwdHubs.size() + bwdHubs.size();
+  }
+
+  // Hubs reachable from the vertex, sorted by id
+  inline std::span<const Vertex> getFwdHubs(const Vertex vertex) const noexcept {
     AssertMsg(teData.isEvent(vertex), "Vertex is not valid!");
 
-    return fwdVertices[vertex];
+    return std::span<const Vertex>(fwdHubs.data() + firstFwdHub[vertex],
+                                   fwdHubs.data() + firstFwdHub[vertex + 1]);
   }
 
-  inline std::vector<Vertex> &getBwdHubs(const Vertex vertex) noexcept {
+  // Hubs reaching the vertex, sorted by id
+  inline std::span<const Vertex> getBwdHubs(const Vertex vertex) const noexcept {
     AssertMsg(teData.isEvent(vertex), "Vertex is not valid!");
 
-    return bwdVertices[vertex];
+    return std::span<const Vertex>(bwdHubs.data() + firstBwdHub[vertex],
+                                   bwdHubs.data() + firstBwdHub[vertex + 1]);
+  }
+
+ private:
+  inline static void flatten(std::vector<std::vector<Vertex>> &labels,
+                             std::vector<size_t> &firstHub,
+                             std::vector<Vertex> &hubs) noexcept {
+    firstHub.assign(labels.size() + 1, 0);
+    for (size_t v = 0; v < labels.size(); ++v) {
+      firstHub[v + 1] = firstHub[v] + labels[v].size();
+    }
+    hubs.clear();
+    hubs.reserve(firstHub.back());
+    for (std::vector<Vertex> &label : labels) {
+      hubs.insert(hubs.end(), label.begin(), label.end());
+      std::vector<Vertex>().swap(label);
+    }
   }
 
+ public:
   TE::Data teData;
+
+  // Labels while they are built or read, see buildFlatLabels()
   std::vector<std::vector<Vertex>> fwdVertices;
   std::vector<std::vector<Vertex>> bwdVertices;
+
+  // The hubs of vertex v are hubs[firstHub[v]] ... hubs[firstHub[v + 1] - 1]
+  std::vector<size_t> firstFwdHub;
+  std::vector<Vertex> fwdHubs;
+  std::vector<size_t> firstBwdHub;
+  std::vector<Vertex> bwdHubs;
 };
 }  // namespace PTL
@@ -25,7 +25,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <fstream>
+#include <iostream>
 #include <random>
+#include <string>
 #include <vector>
 
 #include "../../Helpers/Types.h"
@@ -113,3 +116,38 @@ inline std::vector<StopQuery> generateRandomStopQueries(
   }
   return queries;
 }
+
+// Reads stop queries from a plain text file, one query per line in the form
+// "source target departureTime". Queries with invalid stops are skipped.
+inline std::vector<StopQuery> readStopQueries(const std::string& fileName,
+                                              const size_t numStops) noexcept {
+  std::vector<StopQuery> queries;
+  std::ifstream file(fileName);
+  if (!file.is_open()) {
+    std::cerr << "Unable to open the file: " << fileName << std::endl;
+    return queries;
+  }
+  size_t source, target;
+  int departureTime;
+  size_t skipped = 0;
+  while (file >> source >> target >> departureTime) {
+    if (source >= numStops || target >= numStops) {
+      ++skipped;
+      continue;
+    }
+    queries.emplace_back(StopId(source), StopId(target), departureTime);
+  }
+  if (skipped > 0)
+    std::cout << "Skipped " << skipped << " queries with invalid stops!"
+              << std::endl;
+  return queries;
+}
+
+inline void writeStopQueries(const std::string& fileName,
+                             const std::vector<StopQuery>& queries) noexcept {
+  std::ofstream file(fileName);
+  for (const StopQuery& query : queries) {
+    file << query.source << " " << query.target << " " << query.departureTime
+         << "\n";
+  }
+}
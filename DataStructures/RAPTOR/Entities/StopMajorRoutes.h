@@ -0,0 +1,151 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "../../../ExternalLibs/aligned_allocator.h"
+#include "../../../Helpers/Assert.h"
+#include "../../../Helpers/Types.h"
+#include "../../../Helpers/Vector/Vector.h"
+
+namespace RAPTOR {
+
+// Copy of the stop event times of all routes in stop-major order: for every
+// stop index of a route, the departure times of all trips are followed by the
+// arrival times of all trips. Every row is padded to a multiple of BlockSize
+// trips and starts 32 byte aligned, so the earliest trip at a stop can be
+// found with vectorized compares over BlockSize trips (if USE_SIMD is set),
+// and scanning a route reads consecutive rows instead of hopping between
+// trips.
+class StopMajorRoutes {
+ public:
+  static constexpr size_t BlockSize = 8;
+
+ private:
+  using Times = std::vector<int, aligned_allocator<int, 32>>;
+
+ public:
+  StopMajorRoutes() {}
+
+  template <typename DATA>
+  StopMajorRoutes(const DATA& data)
+      : firstRowOfRoute(data.numberOfRoutes() + 1, 0),
+        rowSize(data.numberOfRoutes(), 0) {
+    for (const RouteId route : data.routes()) {
+      const size_t numberOfTrips = data.numberOfTripsInRoute(route);
+      rowSize[route] =
+          ((numberOfTrips + BlockSize - 1) / BlockSize) * BlockSize;
+      firstRowOfRoute[route + 1] =
+          firstRowOfRoute[route] +
+          2 * data.numberOfStopsInRoute(route) * rowSize[route];
+    }
+    times.assign(firstRowOfRoute.back(), intMax);
+    for (const RouteId route : data.routes()) {
+      const size_t numberOfStops = data.numberOfStopsInRoute(route);
+      const size_t numberOfTrips = data.numberOfTripsInRoute(route);
+      for (size_t trip = 0; trip < numberOfTrips; trip++) {
+        const auto* stopEvents = data.tripOfRoute(route, trip);
+        for (size_t stopIndex = 0; stopIndex < numberOfStops; stopIndex++) {
+          departureRow(route, StopIndex(stopIndex))[trip] =
+              stopEvents[stopIndex].departureTime;
+          arrivalRow(route, StopIndex(stopIndex))[trip] =
+              stopEvents[stopIndex].arrivalTime;
+        }
+      }
+    }
+  }
+
+  inline size_t numberOfRoutes() const noexcept { return rowSize.size(); }
+
+  inline const int* departureTimes(const RouteId route,
+                                   const StopIndex stopIndex) const noexcept {
+    return &times[firstRowOfRoute[route] + 2 * stopIndex * rowSize[route]];
+  }
+
+  inline const int* arrivalTimes(const RouteId route,
+                                 const StopIndex stopIndex) const noexcept {
+    return departureTimes(route, stopIndex) + rowSize[route];
+  }
+
+  // Starting from the given trip, moves to earlier trips as long as they
+  // depart at the stop index no earlier than the given time. This is the same
+  // trip the backwards search of the RAPTOR route scan finds.
+  inline uint32_t earliestTrip(const RouteId route, const StopIndex stopIndex,
+                               uint32_t trip, const int time) const noexcept {
+    const int* departures = departureTimes(route, stopIndex);
+    if (trip == 0 || departures[trip - 1] < time) return trip;
+#ifdef USE_SIMD
+    const __m256i limit = _mm256_set1_epi32(time);
+    while (trip >= BlockSize) {
+      const __m256i values = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(departures + trip - BlockSize));
+      const uint32_t earlier = uint32_t(_mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_cmpgt_epi32(limit, values))));
+      if (earlier) return trip - BlockSize + std::bit_width(earlier);
+      trip -= BlockSize;
+    }
+    const __m256i values =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(departures));
+    const uint32_t earlier =
+        uint32_t(_mm256_movemask_ps(
+            _mm256_castsi256_ps(_mm256_cmpgt_epi32(limit, values)))) &
+        ((1u << trip) - 1);
+    return std::bit_width(earlier);
+#else
+    while (trip > 0 && departures[trip - 1] >= time) trip--;
+    return trip;
+#endif
+  }
+
+  inline long long byteSize() const noexcept {
+    return Vector::byteSize(firstRowOfRoute) + Vector::byteSize(rowSize) +
+           times.size() * sizeof(int);
+  }
+
+ private:
+  inline int* departureRow(const RouteId route,
+                           const StopIndex stopIndex) noexcept {
+    return &times[firstRowOfRoute[route] + 2 * stopIndex * rowSize[route]];
+  }
+
+  inline int* arrivalRow(const RouteId route,
+                         const StopIndex stopIndex) noexcept {
+    return departureRow(route, stopIndex) + rowSize[route];
+  }
+
+ private:
+  std::vector<size_t> firstRowOfRoute;
+  std::vector<size_t> rowSize;
+  Times times;
+};
+
+}  // namespace RAPTOR
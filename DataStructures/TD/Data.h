@@ -28,6 +28,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -49,6 +50,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace TD {
 
+struct Breakpoint {
+  Breakpoint(const int departureTime = intMax, const int duration = intMax)
+      : departureTime(departureTime), duration(duration) {}
+
+  int departureTime;
+  int duration;
+};
+
+constexpr int SecondsPerBucket = 60 * 60;
+
 class Data {
  public:
   Data() {}
@@ -152,13 +163,12 @@ class Data {
           .set(TravelTime, inter.transferGraph.get(TravelTime, edge));
     }
 
-    for (auto &val : builderGraph[DurationFunction]) {
-      val.emplace_back(intMax, intMax);
-    }
-
     builderGraph.sortEdges(ToVertex);
 
-    Graph::move(std::move(builderGraph), data.timeDependentGraph);
+    StaticTimeDependentRouteGraph staticGraph;
+    Graph::move(std::move(builderGraph), staticGraph);
+    data.buildTravelTimeFunctions(staticGraph);
+    Graph::move(std::move(staticGraph), data.timeDependentGraph);
 
     return data;
   }
@@ -196,20 +206,55 @@ class Data {
     return stopsOfRoute[route];
   }
 
+  inline bool isRouteEdge(const Edge edge) const noexcept {
+    return firstBreakpointOfEdge[edge] != firstBreakpointOfEdge[edge + 1];
+  }
+
+  // Breakpoints of the travel time function of the edge, sorted by departure
+  // time and terminated by the sentinel (intMax, intMax)
+  inline std::span<const Breakpoint> getBreakpointsOfEdge(
+      const Edge edge) const noexcept {
+    return std::span<const Breakpoint>(
+        breakpoints.data() + firstBreakpointOfEdge[edge],
+        firstBreakpointOfEdge[edge + 1] - firstBreakpointOfEdge[edge]);
+  }
+
+  // Earliest arrival at the head of the route edge when being at its tail at
+  // the given time, or intMax if no trip departs afterwards. The hour bucket of
+  // the time points to the first breakpoint departing in that hour, so only the
+  // departures within the hour are scanned.
+  inline int getArrivalTime(const Edge edge, const int time) const noexcept {
+    AssertMsg(isRouteEdge(edge), "Edge " << edge << " is not a route edge!");
+    AssertMsg(time >= 0 && time < intMax, "Time " << time << " is invalid!");
+    const uint32_t firstBucket = firstBucketOfEdge[edge];
+    const int bucket = time / SecondsPerBucket - firstHourOfEdge[edge];
+    uint32_t i;
+    if (bucket < 0) [[unlikely]] {
+      i = firstBreakpointOfEdge[edge];
+    } else if (static_cast<uint32_t>(bucket) >=
+               firstBucketOfEdge[edge + 1] - firstBucket) [[unlikely]] {
+      i = firstBreakpointOfEdge[edge + 1] - 1;
+    } else {
+      i = firstBreakpointOfBucket[firstBucket + bucket];
+    }
+    while (breakpoints[i].departureTime < time) ++i;
+    const Breakpoint &breakpoint = breakpoints[i];
+    if (breakpoint.departureTime == intMax) [[unlikely]]
+      return intMax;
+    return breakpoint.departureTime + breakpoint.duration;
+  }
+
   inline void printInfo() const noexcept {
     size_t totalNumOfEntries = 0;
     size_t maxNumOfEntries = 0;
     size_t totalNumOfRouteEdges = 0;
 
     for (const auto edge : timeDependentGraph.edges()) {
-      totalNumOfEntries +=
-          timeDependentGraph.get(DurationFunction, edge).size();
-      maxNumOfEntries =
-          std::max(maxNumOfEntries,
-                   timeDependentGraph.get(DurationFunction, edge).size());
-
-      totalNumOfRouteEdges +=
-          (timeDependentGraph.get(DurationFunction, edge).size() > 1);
+      if (!isRouteEdge(edge)) continue;
+      const size_t numEntries = getBreakpointsOfEdge(edge).size() - 1;
+      totalNumOfEntries += numEntries;
+      maxNumOfEntries = std::max(maxNumOfEntries, numEntries);
+      ++totalNumOfRouteEdges;
     }
 
     std::cout << "TD public transit data:" << std::endl;
@@ -232,18 +277,22 @@ class Data {
               << std::endl;
     std::cout << "   Max # entries on edge:    " << std::setw(12)
               << String::prettyInt(maxNumOfEntries) << std::endl;
+    std::cout << "   Number of hour buckets:   " << std::setw(12)
+              << String::prettyInt(firstBreakpointOfBucket.size())
+              << std::endl;
   }
 
   inline void serialize(const std::string &fileName) const noexcept {
     IO::serialize(fileName, stopData, routeData, stopsOfRoute,
-                  numberOfStopEvents);
+                  numberOfStopEvents, firstBreakpointOfEdge, breakpoints);
     timeDependentGraph.writeBinary(fileName + ".graph");
   }
 
   inline void deserialize(const std::string &fileName) noexcept {
     IO::deserialize(fileName, stopData, routeData, stopsOfRoute,
-                    numberOfStopEvents);
+                    numberOfStopEvents, firstBreakpointOfEdge, breakpoints);
     timeDependentGraph.readBinary(fileName + ".graph");
+    buildHourBuckets();
   }
 
   inline long long byteSize() const noexcept {
@@ -252,9 +301,70 @@ class Data {
     result += Vector::byteSize(stopsOfRoute);
     result += sizeof(size_t);
     result += timeDependentGraph.byteSize();
+    result += Vector::byteSize(firstBreakpointOfEdge);
+    result += Vector::byteSize(breakpoints);
+    result += Vector::byteSize(firstHourOfEdge);
+    result += Vector::byteSize(firstBucketOfEdge);
+    result += Vector::byteSize(firstBreakpointOfBucket);
     return result;
   }
 
+ private:
+  // Moves the duration functions of the (final) graph into one contiguous
+  // breakpoint array
+  inline void buildTravelTimeFunctions(
+      const StaticTimeDependentRouteGraph &graph) noexcept {
+    firstBreakpointOfEdge.assign(1, 0);
+    firstBreakpointOfEdge.reserve(graph.numEdges() + 1);
+    breakpoints.clear();
+    for (const Edge edge : graph.edges()) {
+      const auto &function = graph.get(DurationFunction, edge);
+      if (graph.get(TravelTime, edge) == -1) {
+        AssertMsg(!function.empty(), "Route edge without departures!");
+        const size_t begin = breakpoints.size();
+        for (const auto &[departureTime, duration] : function) {
+          breakpoints.emplace_back(static_cast<int>(departureTime),
+                                   static_cast<int>(duration));
+        }
+        std::sort(breakpoints.begin() + begin, breakpoints.end(),
+                  [](const Breakpoint &a, const Breakpoint &b) {
+                    return a.departureTime < b.departureTime;
+                  });
+        breakpoints.emplace_back(intMax, intMax);
+      }
+      firstBreakpointOfEdge.emplace_back(breakpoints.size());
+    }
+    buildHourBuckets();
+  }
+
+  // For every route edge and every hour between its first and last departure,
+  // stores the first breakpoint departing at or after the start of the hour
+  inline void buildHourBuckets() noexcept {
+    const size_t numEdges = firstBreakpointOfEdge.size() - 1;
+    firstHourOfEdge.assign(numEdges, 0);
+    firstBucketOfEdge.assign(1, 0);
+    firstBucketOfEdge.reserve(numEdges + 1);
+    firstBreakpointOfBucket.clear();
+    for (size_t edge = 0; edge < numEdges; ++edge) {
+      const uint32_t begin = firstBreakpointOfEdge[edge];
+      const uint32_t end = firstBreakpointOfEdge[edge + 1];
+      if (begin != end) {
+        // the last entry is the sentinel
+        const int firstHour =
+            breakpoints[begin].departureTime / SecondsPerBucket;
+        const int lastHour =
+            breakpoints[end - 2].departureTime / SecondsPerBucket;
+        firstHourOfEdge[edge] = firstHour;
+        uint32_t i = begin;
+        for (int hour = firstHour; hour <= lastHour; ++hour) {
+          while (breakpoints[i].departureTime < hour * SecondsPerBucket) ++i;
+          firstBreakpointOfBucket.emplace_back(i);
+        }
+      }
+      firstBucketOfEdge.emplace_back(firstBreakpointOfBucket.size());
+    }
+  }
+
  public:
   std::vector<RAPTOR::Stop> stopData;
   std::vector<RAPTOR::Route> routeData;
@@ -263,6 +373,16 @@ class Data {
   size_t numberOfStopEvents;
 
   TimeDependentRouteGraph timeDependentGraph;
+
+  // Travel time functions of the route edges in CSR layout, transfer edges
+  // have an empty range
+  std::vector<uint32_t> firstBreakpointOfEdge;
+  std::vector<Breakpoint> breakpoints;
+
+  // Hour buckets, rebuilt after loading
+  std::vector<int> firstHourOfEdge;
+  std::vector<uint32_t> firstBucketOfEdge;
+  std::vector<uint32_t> firstBreakpointOfBucket;
 };
 
 }  // namespace TD
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #pragma once
 
 #include <algorithm>
+#include <span>
 #include <unordered_map>
 
 #include "../../Helpers/Assert.h"
@@ -42,18 +43,6 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 namespace TE {
 
 class Data {
- private:
-  struct Event {
-    size_t id;
-    StopId stop;
-    int time;
-    TripId trip;
-
-    Event(size_t id = -1, StopId stop = noStop, int time = -1,
-          TripId trip = noTripId)
-        : id(id), stop(stop), time(time), trip(trip){};
-  };
-
  public:
   Data(){};
 
@@ -72,11 +61,9 @@ class Data {
     data.stopData.clear();
     data.stopData.reserve(inter.stops.size());
 
-    data.depEventsAtStop.clear();
-    data.depEventsAtStop.assign(inter.stops.size(), {});
-
-    data.arrEventsAtStop.clear();
-    data.arrEventsAtStop.assign(inter.stops.size(), {});
+    // events at every stop, moved into the flat layout at the end
+    std::vector<std::vector<Vertex>> depEventsAtStop(inter.stops.size());
+    std::vector<std::vector<Vertex>> arrEventsAtStop(inter.stops.size());
 
     for (const Intermediate::Stop &stop : inter.stops) {
       data.stopData.emplace_back(stop);
@@ -112,8 +99,12 @@ class Data {
     std::vector<size_t> lastArrivalEventOfTrip(inter.trips.size(),
                                                numberOfEvents);
 
-    data.events.clear();
-    data.events.reserve(numberOfEvents);
+    data.timeOfEvent.clear();
+    data.timeOfEvent.reserve(numberOfEvents);
+    data.stopOfEvent.clear();
+    data.stopOfEvent.reserve(numberOfEvents);
+    data.tripOfEvent.clear();
+    data.tripOfEvent.reserve(numberOfEvents);
 
     for (size_t i = 0; i < connections.size(); ++i) {
       // first departure event, then arrival
@@ -121,16 +112,14 @@ class Data {
 
       size_t id = (i << 1);
 
-      data.events.emplace_back(id, conn.departureStopId, conn.departureTime,
-                               conn.tripId);
-      data.events.emplace_back(id + 1, conn.arrivalStopId, conn.arrivalTime,
-                               conn.tripId);
+      data.addEvent(conn.departureStopId, conn.departureTime, conn.tripId);
+      data.addEvent(conn.arrivalStopId, conn.arrivalTime, conn.tripId);
 
       bobTheBuilder.set(StopVertex, Vertex(id), conn.departureStopId);
       bobTheBuilder.set(StopVertex, Vertex(id + 1), conn.arrivalStopId);
 
       // add the arrival event to arrEventsAtStop
-      data.arrEventsAtStop[conn.arrivalStopId].emplace_back(id + 1);
+      arrEventsAtStop[conn.arrivalStopId].emplace_back(id + 1);
 
       // check if can create an edge to the previous arrival event
       // ** Trip Edge **
@@ -152,9 +141,8 @@ class Data {
       AssertMsg(conn.departureStopId < data.stopData.size(),
                 "Departure StopId is out of bounds!");
 
-      if (!data.depEventsAtStop[conn.departureStopId].empty()) {
-        Vertex prevDep =
-            Vertex(data.depEventsAtStop[conn.departureStopId].back());
+      if (!depEventsAtStop[conn.departureStopId].empty()) {
+        Vertex prevDep = depEventsAtStop[conn.departureStopId].back();
         AssertMsg(prevDep < numberOfEvents,
                   "Previous Departure Event is out of bounds!");
 
@@ -162,7 +150,7 @@ class Data {
       }
 
       // also add departure vertex to stop
-      data.depEventsAtStop[conn.departureStopId].emplace_back(id);
+      depEventsAtStop[conn.departureStopId].emplace_back(id);
 
       // add the edge from departure => arrival vertex
       bobTheBuilder.addEdge(Vertex(id), Vertex(id + 1)).set(Hop, 0);
@@ -177,21 +165,22 @@ class Data {
           AssertMsg(fromVertex < numberOfEvents,
                     "From Event is out of bounds!");
           AssertMsg(data.isStop(toStop), "To Stop is out of bounds!");
-          AssertMsg(data.events[fromVertex].time <= timeAtStop, "Time travel!");
+          AssertMsg(data.timeOfEvent[fromVertex] <= timeAtStop,
+                    "Time travel!");
 
-          const auto &departureEventAtToStop = data.depEventsAtStop[toStop];
+          const auto &departureEventAtToStop = depEventsAtStop[toStop];
 
           if (departureEventAtToStop.empty()) {
             return;
           }
 
-          if (timeAtStop > data.events[departureEventAtToStop.back()].time) {
+          if (timeAtStop > data.timeOfEvent[departureEventAtToStop.back()]) {
             return;
           }
 
-          for (auto &event : departureEventAtToStop) {
-            if (timeAtStop <= data.events[event].time) {
-              bobTheBuilder.addEdge(fromVertex, Vertex(event))
+          for (const Vertex event : departureEventAtToStop) {
+            if (timeAtStop <= data.timeOfEvent[event]) {
+              bobTheBuilder.addEdge(fromVertex, event)
                   .set(Hop, transferEdge);
               return;
             }
@@ -206,9 +195,9 @@ class Data {
       AssertMsg(data.isArrivalEvent(arrEvent),
                 "Arrival Event is not an arrival event!");
 
-      StopId fromStop = data.events[arrEvent].stop;
+      StopId fromStop = data.stopOfEvent[arrEvent];
 
-      int time = data.events[arrEvent].time;
+      int time = data.timeOfEvent[arrEvent];
 
       addEdgeToReachableDepartureEvent(
           arrEvent, fromStop, time + data.stopData[fromStop].minTransferTime,
@@ -232,8 +221,8 @@ class Data {
       AssertMsg(data.isEvent(fromVertex), "FromVertex is not valid!");
       AssertMsg(data.isEvent(toVertex), "ToVertex is not valid!");
 
-      int fromTime = data.events[fromVertex].time;
-      int toTime = data.events[toVertex].time;
+      int fromTime = data.timeOfEvent[fromVertex];
+      int toTime = data.timeOfEvent[toVertex];
 
       AssertMsg(fromTime <= toTime, "Time travel!");
 
@@ -246,29 +235,26 @@ class Data {
     Graph::printInfo(data.timeExpandedGraph);
 
     for (StopId stop(0); stop < data.stopData.size(); ++stop) {
-      std::sort(data.arrEventsAtStop[stop].begin(),
-                data.arrEventsAtStop[stop].end(),
-                [&](const size_t left, const size_t right) {
-                  return data.events[left].time < data.events[right].time;
+      std::sort(arrEventsAtStop[stop].begin(), arrEventsAtStop[stop].end(),
+                [&](const Vertex left, const Vertex right) {
+                  return data.timeOfEvent[left] < data.timeOfEvent[right];
                 });
 
-      AssertMsg(std::is_sorted(data.arrEventsAtStop[stop].begin(),
-                               data.arrEventsAtStop[stop].end(),
-                               [&](const size_t left, const size_t right) {
-                                 return data.events[left].time <
-                                        data.events[right].time;
-                               }),
-                "Arrival Events are not sorted correctly!");
-
-      AssertMsg(std::is_sorted(data.depEventsAtStop[stop].begin(),
-                               data.depEventsAtStop[stop].end(),
-                               [&](const size_t left, const size_t right) {
-                                 return data.events[left].time <
-                                        data.events[right].time;
+      AssertMsg(std::is_sorted(depEventsAtStop[stop].begin(),
+                               depEventsAtStop[stop].end(),
+                               [&](const Vertex left, const Vertex right) {
+                                 return data.timeOfEvent[left] <
+                                        data.timeOfEvent[right];
                                }),
                 "Departure Events are not sorted correctly!");
     }
 
+    flatten(depEventsAtStop, data.timeOfEvent, data.firstDepartureOfStop,
+            data.departureEvents, data.departureTimes);
+    flatten(arrEventsAtStop, data.timeOfEvent, data.firstArrivalOfStop,
+            data.arrivalEvents, data.arrivalTimes);
+    data.buildDepartureIndex();
+
     return data;
   }
 
@@ -289,10 +275,14 @@ class Data {
     return Range<TripId>(TripId(0), TripId(numberOfTrips()));
   }
 
-  inline size_t numberOfStopEvents() const noexcept { return events.size(); }
-  inline size_t numberOfTEVertices() const noexcept { return events.size(); }
+  inline size_t numberOfStopEvents() const noexcept {
+    return timeOfEvent.size();
+  }
+  inline size_t numberOfTEVertices() const noexcept {
+    return timeOfEvent.size();
+  }
   inline bool isEvent(const Vertex event) const noexcept {
-    return event < events.size();
+    return event < timeOfEvent.size();
   }
   inline bool isDepartureEvent(const Vertex event) const noexcept {
     return !isArrivalEvent(event);
@@ -304,27 +294,32 @@ class Data {
   inline int getTimeOfVertex(Vertex vertex) const noexcept {
     AssertMsg(isEvent(vertex), "Vertex " << vertex << " is not valid!");
 
-    return events[vertex].time;
+    return timeOfEvent[vertex];
   }
 
+  // Returns the first departure event at the stop not before the given time,
+  // or numberOfTEVertices() if there is none. The bucket of the time points
+  // directly to the first departure of the bucket, hence only the departures
+  // within one bucket are scanned.
   inline Vertex getFirstReachableDepartureVertexAtStop(
       const StopId stop, const int time) const noexcept {
     AssertMsg(isStop(stop), "Stop is not valid");
 
-    const auto &departureEventAtToStop = depEventsAtStop[stop];
+    const uint32_t begin = firstDepartureOfStop[stop];
+    const uint32_t end = firstDepartureOfStop[stop + 1];
 
-    if ((departureEventAtToStop.empty()) ||
-        (time > events[departureEventAtToStop.back()].time)) {
+    if ((begin == end) || (time > departureTimes[end - 1])) {
       return Vertex(numberOfTEVertices());
     }
-
-    for (auto &event : departureEventAtToStop) {
-      if (time <= events[event].time) {
-        return Vertex(event);
-      }
-    }
-    AssertMsg(false, "No edge added??");
-    return Vertex(numberOfTEVertices());
+    if (time <= departureTimes[begin]) return departureEvents[begin];
+
+    const uint32_t bucket =
+        firstBucketOfStop[stop] +
+        (time - departureTimes[begin]) / bucketWidthOfStop[stop];
+    uint32_t i = firstDepartureOfBucket[bucket];
+    while (departureTimes[i] < time) ++i;
+    AssertMsg(i < end, "No departure found??");
+    return departureEvents[i];
   }
 
   inline void printInfo() const noexcept {
@@ -340,38 +335,70 @@ class Data {
               << std::endl;
     std::cout << "   Number of TE Edges:       " << std::setw(12)
               << String::prettyInt(timeExpandedGraph.numEdges()) << std::endl;
+    std::cout << "   Total size:               " << std::setw(12)
+              << String::bytesToString(byteSize()) << std::endl;
   }
 
+  // Serialization, the bucket index is cheap to recompute and hence not stored
   inline void serialize(const std::string &fileName) const noexcept {
-    IO::serialize(fileName, stopData, events, depEventsAtStop, arrEventsAtStop,
-                  numTrips);
+    IO::serialize(fileName, stopData, timeOfEvent, stopOfEvent, tripOfEvent,
+                  firstDepartureOfStop, departureEvents, departureTimes,
+                  firstArrivalOfStop, arrivalEvents, arrivalTimes, numTrips);
     timeExpandedGraph.writeBinary(fileName + ".graph");
   }
 
   inline void deserialize(const std::string &fileName) noexcept {
-    IO::deserialize(fileName, stopData, events, depEventsAtStop,
-                    arrEventsAtStop, numTrips);
+    IO::deserialize(fileName, stopData, timeOfEvent, stopOfEvent, tripOfEvent,
+                    firstDepartureOfStop, departureEvents, departureTimes,
+                    firstArrivalOfStop, arrivalEvents, arrivalTimes, numTrips);
     timeExpandedGraph.readBinary(fileName + ".graph");
+    buildDepartureIndex();
   }
 
   inline long long byteSize() const noexcept {
     long long result = Vector::byteSize(stopData);
-    result += Vector::byteSize(events);
-    result += Vector::byteSize(depEventsAtStop);
-    result += Vector::byteSize(arrEventsAtStop);
+    result += Vector::byteSize(timeOfEvent);
+    result += Vector::byteSize(stopOfEvent);
+    result += Vector::byteSize(tripOfEvent);
+    result += Vector::byteSize(firstDepartureOfStop);
+    result += Vector::byteSize(departureEvents);
+    result += Vector::byteSize(departureTimes);
+    result += Vector::byteSize(firstArrivalOfStop);
+    result += Vector::byteSize(arrivalEvents);
+    result += Vector::byteSize(arrivalTimes);
+    result += Vector::byteSize(firstBucketOfStop);
+    result += Vector::byteSize(bucketWidthOfStop);
+    result += Vector::byteSize(firstDepartureOfBucket);
     result += sizeof(numTrips);
     result += timeExpandedGraph.byteSize();
     return result;
   }
 
-  inline std::vector<size_t> &getDeparturesOfStop(const StopId stop) noexcept {
+  // Departure events at the stop, sorted by time
+  inline std::span<const Vertex> getDeparturesOfStop(
+      const StopId stop) const noexcept {
     AssertMsg(isStop(stop), "Stop is not a stop!");
-    return depEventsAtStop[stop];
+    return std::span<const Vertex>(
+        departureEvents.data() + firstDepartureOfStop[stop],
+        departureEvents.data() + firstDepartureOfStop[stop + 1]);
   }
 
-  inline std::vector<size_t> &getArrivalsOfStop(const StopId stop) noexcept {
+  // Arrival events at the stop, sorted by time
+  inline std::span<const Vertex> getArrivalsOfStop(
+      const StopId stop) const noexcept {
     AssertMsg(isStop(stop), "Stop is not a stop!");
-    return arrEventsAtStop[stop];
+    return std::span<const Vertex>(
+        arrivalEvents.data() + firstArrivalOfStop[stop],
+        arrivalEvents.data() + firstArrivalOfStop[stop + 1]);
+  }
+
+  // Times of getArrivalsOfStop(stop)
+  inline std::span<const int> getArrivalTimesOfStop(
+      const StopId stop) const noexcept {
+    AssertMsg(isStop(stop), "Stop is not a stop!");
+    return std::span<const int>(
+        arrivalTimes.data() + firstArrivalOfStop[stop],
+        arrivalTimes.data() + firstArrivalOfStop[stop + 1]);
   }
 
   inline void writeAdditionalInfoOfVertex(
@@ -382,7 +409,7 @@ class Data {
     file << numberOfTEVertices() << std::endl;
 
     for (size_t i = 0; i < numberOfTEVertices(); ++i) {
-      file << events[i].time << " " << events[i].stop << " " << events[i].trip
+      file << timeOfEvent[i] << " " << stopOfEvent[i] << " " << tripOfEvent[i]
            << std::endl;
     }
 
@@ -390,22 +417,25 @@ class Data {
     AssertMsg(file.good(), "Something went wrong!");
   }
 
-  inline void writeOrderForAkiba(const std::string &fileName) const noexcept {
+  // Vertex order used for the hub labeling, the most important vertex first
+  inline std::vector<size_t> getOrderForAkiba() const noexcept {
     std::vector<size_t> order;
     order.reserve(numberOfStopEvents());
 
     // first all departure events in reverse order
     for (StopId stop(0); stop < numberOfStops(); ++stop) {
-      order.insert(order.end(), depEventsAtStop[stop].begin(),
-                   depEventsAtStop[stop].end());
-      order.insert(order.end(), arrEventsAtStop[stop].begin(),
-                   arrEventsAtStop[stop].end());
+      for (const Vertex event : getDeparturesOfStop(stop)) {
+        order.emplace_back(event);
+      }
+      for (const Vertex event : getArrivalsOfStop(stop)) {
+        order.emplace_back(event);
+      }
     }
-    // // then all arrival events in reverse order
-    // for (StopId stop(0); stop < numberOfStops(); ++stop) {
-    //     order.insert(order.end(), arrEventsAtStop[stop].begin(),
-    //     arrEventsAtStop[stop].end());
-    // }
+    return order;
+  }
+
+  inline void writeOrderForAkiba(const std::string &fileName) const noexcept {
+    const std::vector<size_t> order = getOrderForAkiba();
 
     std::ofstream file;
 
@@ -424,14 +454,14 @@ class Data {
     std::ofstream file;
     file.open(fileName);
 
-    file << depEventsAtStop.size() << std::endl;
+    file << numberOfStops() << std::endl;
 
-    for (std::size_t s = 0; s < depEventsAtStop.size(); ++s) {
-      for (auto v : depEventsAtStop[s]) {
+    for (StopId stop(0); stop < numberOfStops(); ++stop) {
+      for (const Vertex v : getDeparturesOfStop(stop)) {
         file << v << " ";
       }
       file << std::endl;
-      for (auto v : arrEventsAtStop[s]) {
+      for (const Vertex v : getArrivalsOfStop(stop)) {
         file << v << " ";
       }
       file << std::endl;
@@ -441,13 +471,84 @@ class Data {
     AssertMsg(file.good(), "Something went wrong!");
   }
 
+ private:
+  inline void addEvent(const StopId stop, const int time,
+                       const TripId trip) noexcept {
+    timeOfEvent.emplace_back(time);
+    stopOfEvent.emplace_back(stop);
+    tripOfEvent.emplace_back(trip);
+  }
+
+  inline static void flatten(const std::vector<std::vector<Vertex>> &eventsAtStop,
+                             const std::vector<int> &timeOfEvent,
+                             std::vector<uint32_t> &firstEventOfStop,
+                             std::vector<Vertex> &events,
+                             std::vector<int> &times) noexcept {
+    firstEventOfStop.assign(eventsAtStop.size() + 1, 0);
+    events.clear();
+    times.clear();
+    for (size_t stop = 0; stop < eventsAtStop.size(); ++stop) {
+      for (const Vertex event : eventsAtStop[stop]) {
+        events.emplace_back(event);
+        times.emplace_back(timeOfEvent[event]);
+      }
+      firstEventOfStop[stop + 1] = events.size();
+    }
+  }
+
+  // Every stop gets as many buckets as it has departures, covering the time
+  // span of its departures in buckets of equal width. Each bucket stores the
+  // first departure not before the bucket start.
+  inline void buildDepartureIndex() noexcept {
+    firstBucketOfStop.assign(numberOfStops() + 1, 0);
+    bucketWidthOfStop.assign(numberOfStops(), 1);
+    firstDepartureOfBucket.clear();
+    firstDepartureOfBucket.reserve(departureEvents.size());
+    for (StopId stop(0); stop < numberOfStops(); ++stop) {
+      const uint32_t begin = firstDepartureOfStop[stop];
+      const uint32_t end = firstDepartureOfStop[stop + 1];
+      if (begin < end) {
+        const int64_t span =
+            int64_t(departureTimes[end - 1]) - departureTimes[begin] + 1;
+        const int64_t numberOfBuckets = end - begin;
+        const int width =
+            std::max<int64_t>(1, (span + numberOfBuckets - 1) / numberOfBuckets);
+        bucketWidthOfStop[stop] = width;
+        uint32_t i = begin;
+        for (int64_t bucket = 0; bucket * width < span; ++bucket) {
+          const int64_t bucketStart = departureTimes[begin] + bucket * width;
+          while (departureTimes[i] < bucketStart) ++i;
+          firstDepartureOfBucket.emplace_back(i);
+        }
+      }
+      firstBucketOfStop[stop + 1] = firstDepartureOfBucket.size();
+    }
+  }
+
  public:
   std::vector<RAPTOR::Stop> stopData;
-  std::vector<Event> events;
-  std::vector<std::vector<size_t>> depEventsAtStop;
-  std::vector<std::vector<size_t>> arrEventsAtStop;
   size_t numTrips;
 
+  // the events (= vertices of the time expanded graph), the departure event of
+  // a connection is followed by its arrival event
+  std::vector<int> timeOfEvent;
+  std::vector<StopId> stopOfEvent;
+  std::vector<TripId> tripOfEvent;
+
+  // departure and arrival events of every stop, sorted by time, together with
+  // their times
+  std::vector<uint32_t> firstDepartureOfStop;
+  std::vector<Vertex> departureEvents;
+  std::vector<int> departureTimes;
+  std::vector<uint32_t> firstArrivalOfStop;
+  std::vector<Vertex> arrivalEvents;
+  std::vector<int> arrivalTimes;
+
+  // bucket index of the departures, see buildDepartureIndex()
+  std::vector<uint32_t> firstBucketOfStop;
+  std::vector<int> bucketWidthOfStop;
+  std::vector<uint32_t> firstDepartureOfBucket;
+
   TimeExpandedGraph timeExpandedGraph;
 };
 }  // namespace TE
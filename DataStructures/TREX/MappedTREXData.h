@@ -0,0 +1,511 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../Helpers/Assert.h"
+#include "../../Helpers/FileSystem/FileSystem.h"
+#include "../../Helpers/IO/MemoryMappedFile.h"
+#include "../../Helpers/IO/Serialization.h"
+#include "../../Helpers/Ranges/Range.h"
+#include "../../Helpers/Ranges/SubRange.h"
+#include "../../Helpers/String/String.h"
+#include "../Graph/Graph.h"
+#include "../RAPTOR/Entities/RouteSegment.h"
+#include "../RAPTOR/Entities/StopEvent.h"
+#include "TREXData.h"
+#include "TREXQueryTables.h"
+
+namespace TripBased {
+
+// Static graph whose arrays point into a memory mapped file. Provides the
+// subset of the StaticGraph interface that the queries use.
+class MappedStaticGraph {
+ public:
+  inline size_t numVertices() const noexcept {
+    return beginOut.empty() ? 0 : beginOut.size() - 1;
+  }
+  inline size_t numEdges() const noexcept { return toVertex.size(); }
+
+  inline bool isVertex(const Vertex vertex) const noexcept {
+    return vertex < numVertices();
+  }
+  inline bool isEdge(const Edge edge) const noexcept {
+    return edge < numEdges();
+  }
+
+  inline Range<Edge> edgesFrom(const Vertex vertex) const noexcept {
+    AssertMsg(isVertex(vertex), vertex << " is not a valid vertex!");
+    return Range<Edge>(beginOut[vertex], beginOut[vertex + 1]);
+  }
+
+  inline Edge beginEdgeFrom(const Vertex vertex) const noexcept {
+    AssertMsg(isVertex(vertex) || vertex == numVertices(),
+              vertex << " is not a valid vertex!");
+    return beginOut[vertex];
+  }
+
+  template <AttributeNameType ATTRIBUTE_NAME>
+  inline auto get(const AttributeNameWrapper<ATTRIBUTE_NAME>,
+                  const Edge edge) const noexcept {
+    AssertMsg(isEdge(edge), edge << " is not a valid edge!");
+    if constexpr (ATTRIBUTE_NAME == ToVertex) {
+      return toVertex[edge];
+    } else if constexpr (ATTRIBUTE_NAME == TravelTime) {
+      return travelTime[edge];
+    } else {
+      static_assert(ATTRIBUTE_NAME == LocalLevel,
+                    "Attribute is not stored in the mapped graph!");
+      AssertMsg(!localLevel.empty(), "The graph has no local levels!");
+      return localLevel[edge];
+    }
+  }
+
+  inline long long byteSize() const noexcept {
+    return beginOut.size_bytes() + toVertex.size_bytes() +
+           travelTime.size_bytes() + localLevel.size_bytes();
+  }
+
+ public:
+  std::span<const Edge> beginOut;
+  std::span<const Vertex> toVertex;
+  std::span<const int> travelTime;
+  std::span<const uint8_t> localLevel;
+};
+
+// Same interface as TREXQueryTables, but reading out of the mapping.
+class MappedTREXQueryTables {
+ public:
+  using EdgeLabel = TREXQueryTables::EdgeLabel;
+  using CompactEdgeLabel = TREXQueryTables::CompactEdgeLabel;
+  using RouteLabel = TREXQueryTables::RouteLabel;
+
+  inline bool isBuilt() const noexcept {
+    return !firstDepartureTimeOfRoute.empty();
+  }
+
+  inline RouteLabel routeLabel(const RouteId route) const noexcept {
+    AssertMsg(route < numberOfTripsOfRoute.size(),
+              "Route " << route << " is out of bounds!");
+    const u_int32_t numberOfTrips = numberOfTripsOfRoute[route];
+    const size_t begin = firstDepartureTimeOfRoute[route];
+    const size_t end = firstDepartureTimeOfRoute[route + 1];
+    const StopIndex endIndex(numberOfTrips ? (end - begin) / numberOfTrips : 0);
+    return RouteLabel(numberOfTrips, endIndex, departureTimes.data() + begin);
+  }
+
+  inline const int *departureTimesOfRoute(const RouteId route) const noexcept {
+    return departureTimes.data() + firstDepartureTimeOfRoute[route];
+  }
+
+  inline long long byteSize() const noexcept {
+    return edgeLabels.size_bytes() + compactEdgeLabels.size_bytes() +
+           numberOfTripsOfRoute.size_bytes() +
+           firstDepartureTimeOfRoute.size_bytes() +
+           departureTimes.size_bytes() + reverseTransferGraph.byteSize();
+  }
+
+ public:
+  std::span<const EdgeLabel> edgeLabels;
+  std::span<const CompactEdgeLabel> compactEdgeLabels;
+
+  std::span<const u_int32_t> numberOfTripsOfRoute;
+  std::span<const size_t> firstDepartureTimeOfRoute;
+  std::span<const int> departureTimes;
+
+  MappedStaticGraph reverseTransferGraph;
+};
+
+// Read-only TREX data, which is loaded by mapping a single file (written with
+// MappedTREXData::write) into memory instead of deserializing it. Loading is
+// (almost) free, pages are read on first access, and all processes mapping the
+// same file share the page cache. Provides the part of the TREXData interface
+// that TREXQuery needs.
+class MappedTREXData {
+ public:
+  using QueryTables = MappedTREXQueryTables;
+
+  static constexpr uint64_t Magic = 0x3150414d58455254;  // "TREXMAP1"
+  static constexpr uint64_t Version = 3;
+  static constexpr size_t Alignment = 64;
+
+  enum Section : size_t {
+    STOP_EVENTS,
+    STOP_IDS,
+    FIRST_STOP_ID_OF_ROUTE,
+    ROUTE_SEGMENTS,
+    FIRST_ROUTE_SEGMENT_OF_STOP,
+    TRANSFER_GRAPH_BEGIN_OUT,
+    TRANSFER_GRAPH_TO_VERTEX,
+    TRANSFER_GRAPH_TRAVEL_TIME,
+    FIRST_TRIP_OF_ROUTE,
+    ROUTE_OF_TRIP,
+    FIRST_STOP_ID_OF_TRIP,
+    FIRST_STOP_EVENT_OF_TRIP,
+    TRIP_OF_STOP_EVENT,
+    INDEX_OF_STOP_EVENT,
+    ARRIVAL_EVENTS,
+    EVENT_GRAPH_BEGIN_OUT,
+    EVENT_GRAPH_TO_VERTEX,
+    EVENT_GRAPH_TRAVEL_TIME,
+    EVENT_GRAPH_LOCAL_LEVEL,
+    CELL_IDS,
+    EDGE_LABELS,
+    COMPACT_EDGE_LABELS,
+    NUMBER_OF_TRIPS_OF_ROUTE,
+    FIRST_DEPARTURE_TIME_OF_ROUTE,
+    DEPARTURE_TIMES,
+    REVERSE_TRANSFER_GRAPH_BEGIN_OUT,
+    REVERSE_TRANSFER_GRAPH_TO_VERTEX,
+    REVERSE_TRANSFER_GRAPH_TRAVEL_TIME,
+    NUMBER_OF_SECTIONS
+  };
+
+  struct SectionEntry {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t elementSize;
+  };
+
+  struct Header {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t numberOfStops;
+    uint64_t numberOfLevels;
+    uint64_t numberOfCellsPerLevel;
+    SectionEntry sections[NUMBER_OF_SECTIONS];
+  };
+
+  // Stores the raptor data the TREX query reads
+  class MappedRAPTORData {
+   public:
+    inline size_t numberOfStops() const noexcept {
+      return firstRouteSegmentOfStop.size() - 1;
+    }
+    inline size_t numberOfRoutes() const noexcept {
+      return firstStopIdOfRoute.size() - 1;
+    }
+
+    inline SubRange<std::span<const RAPTOR::RouteSegment>> routesContainingStop(
+        const StopId stop) const noexcept {
+      AssertMsg(stop < numberOfStops(),
+                "The id " << stop << " does not represent a stop!");
+      return SubRange<std::span<const RAPTOR::RouteSegment>>(
+          routeSegments, firstRouteSegmentOfStop[stop],
+          firstRouteSegmentOfStop[stop + 1]);
+    }
+
+    inline const StopId *stopArrayOfRoute(const RouteId route) const noexcept {
+      AssertMsg(route < numberOfRoutes(),
+                "The id " << route << " does not represent a route!");
+      return &(stopIds[firstStopIdOfRoute[route]]);
+    }
+
+   public:
+    std::span<const RAPTOR::StopEvent> stopEvents;
+    std::span<const StopId> stopIds;
+    std::span<const size_t> firstStopIdOfRoute;
+    std::span<const RAPTOR::RouteSegment> routeSegments;
+    std::span<const size_t> firstRouteSegmentOfStop;
+    MappedStaticGraph transferGraph;
+  };
+
+ public:
+  MappedTREXData(const std::string &fileName) : file(fileName) { load(); }
+
+  // The spans point into the mapping and the sub ranges into this object.
+  MappedTREXData(const MappedTREXData &) = delete;
+  MappedTREXData &operator=(const MappedTREXData &) = delete;
+
+ public:
+  inline size_t numberOfStops() const noexcept {
+    return raptorData.numberOfStops();
+  }
+  inline bool isStop(const Vertex stop) const noexcept {
+    return stop < numberOfStops();
+  }
+
+  inline size_t numberOfTrips() const noexcept { return routeOfTrip.size(); }
+  inline bool isTrip(const TripId trip) const noexcept {
+    return trip < numberOfTrips();
+  }
+  inline Range<TripId> trips() const noexcept {
+    return Range<TripId>(TripId(0), TripId(numberOfTrips()));
+  }
+
+  inline size_t numberOfRoutes() const noexcept {
+    return raptorData.numberOfRoutes();
+  }
+  inline size_t numberOfStopEvents() const noexcept {
+    return raptorData.stopEvents.size();
+  }
+
+  inline size_t numberOfStopsInTrip(const TripId trip) const noexcept {
+    AssertMsg(isTrip(trip), "The id " << trip << " does not represent a trip!");
+    return firstStopEventOfTrip[trip + 1] - firstStopEventOfTrip[trip];
+  }
+
+  inline RouteId getRouteOfStopEvent(
+      const StopEventId stopEvent) const noexcept {
+    return routeOfTrip[tripOfStopEvent[stopEvent]];
+  }
+
+  inline StopId getStopOfStopEvent(const StopEventId stopEvent) const noexcept {
+    return raptorData.stopIds[firstStopIdOfTrip[tripOfStopEvent[stopEvent]] +
+                              indexOfStopEvent[stopEvent]];
+  }
+
+  inline int getNumberOfLevels() const noexcept { return numberOfLevels; }
+
+  inline int getNumberOfCellsPerLevel() const noexcept {
+    return numberOfCellsPerLevel;
+  }
+
+  inline int getNumberOfBitsPerLevel() const noexcept {
+    return std::countr_zero(static_cast<uint32_t>(numberOfCellsPerLevel));
+  }
+
+  inline int getCellShift(const int level) const noexcept {
+    return level * getNumberOfBitsPerLevel();
+  }
+
+  inline uint64_t getCellIdOfStop(const StopId &stop) const noexcept {
+    AssertMsg(isStop(stop), "Stop is not a stop!");
+    return cellIds[stop];
+  }
+
+  // Hints the OS to read the whole file, e.g., directly after loading
+  inline void prefetch() const noexcept { file.prefetch(); }
+
+  inline long long byteSize() const noexcept { return file.size(); }
+
+  inline void printInfo() const noexcept {
+    std::cout << "Memory mapped TREX data (" << file.getFileName()
+              << "):" << std::endl;
+    std::cout << "   Number of Stops:          " << std::setw(12)
+              << String::prettyInt(numberOfStops()) << std::endl;
+    std::cout << "   Number of Routes:         " << std::setw(12)
+              << String::prettyInt(numberOfRoutes()) << std::endl;
+    std::cout << "   Number of Trips:          " << std::setw(12)
+              << String::prettyInt(numberOfTrips()) << std::endl;
+    std::cout << "   Number of Stop Events:    " << std::setw(12)
+              << String::prettyInt(numberOfStopEvents()) << std::endl;
+    std::cout << "   Number of Transfers:      " << std::setw(12)
+              << String::prettyInt(stopEventGraph.numEdges()) << std::endl;
+    std::cout << "   Number of Levels:         " << std::setw(12)
+              << numberOfLevels << std::endl;
+    std::cout << "   Cells per Level:          " << std::setw(12)
+              << numberOfCellsPerLevel << std::endl;
+    std::cout << "   Mapped file size:         " << std::setw(12)
+              << String::bytesToString(byteSize()) << std::endl;
+  }
+
+  // Writes the data (including the query tables) in the mapped layout
+  inline static void write(const TREXData &data,
+                           const std::string &fileName) noexcept {
+    Ensure(data.queryTables.isBuilt(),
+           "The query tables have not been built!");
+    std::ofstream os(FileSystem::ensureDirectoryExists(fileName),
+                     std::ios::binary);
+    IO::checkStream(os, fileName);
+
+    // the header is written last, so an aborted write leaves no valid file
+    Header header{};
+    os.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    auto writeSection = [&](const Section section, const auto &array) {
+      using T = typename std::decay_t<decltype(array)>::value_type;
+      static_assert(std::is_trivially_copyable_v<T>,
+                    "Only trivially copyable types can be mapped!");
+      const size_t position = os.tellp();
+      const size_t offset =
+          ((position + Alignment - 1) / Alignment) * Alignment;
+      const std::vector<char> padding(offset - position, 0);
+      os.write(padding.data(), padding.size());
+      header.sections[section] = {offset, array.size(), sizeof(T)};
+      os.write(reinterpret_cast<const char *>(array.data()),
+               array.size() * sizeof(T));
+    };
+
+    auto writeGraph = [&](const Section beginOut, const auto &graph) {
+      std::vector<Edge> firstEdge;
+      firstEdge.reserve(graph.numVertices() + 1);
+      for (Vertex vertex(0); vertex <= graph.numVertices(); ++vertex) {
+        firstEdge.emplace_back(graph.beginEdgeFrom(vertex));
+      }
+      writeSection(beginOut, firstEdge);
+      writeSection(Section(beginOut + 1), graph.get(ToVertex));
+      writeSection(Section(beginOut + 2), graph.get(TravelTime));
+    };
+
+    const RAPTOR::Data &raptorData = data.raptorData;
+    writeSection(STOP_EVENTS, raptorData.stopEvents);
+    writeSection(STOP_IDS, raptorData.stopIds);
+    writeSection(FIRST_STOP_ID_OF_ROUTE, raptorData.firstStopIdOfRoute);
+    writeSection(ROUTE_SEGMENTS, raptorData.routeSegments);
+    writeSection(FIRST_ROUTE_SEGMENT_OF_STOP,
+                 raptorData.firstRouteSegmentOfStop);
+    writeGraph(TRANSFER_GRAPH_BEGIN_OUT, raptorData.transferGraph);
+
+    writeSection(FIRST_TRIP_OF_ROUTE, data.firstTripOfRoute);
+    writeSection(ROUTE_OF_TRIP, data.routeOfTrip);
+    writeSection(FIRST_STOP_ID_OF_TRIP, data.firstStopIdOfTrip);
+    writeSection(FIRST_STOP_EVENT_OF_TRIP, data.firstStopEventOfTrip);
+    writeSection(TRIP_OF_STOP_EVENT, data.tripOfStopEvent);
+    writeSection(INDEX_OF_STOP_EVENT, data.indexOfStopEvent);
+    writeSection(ARRIVAL_EVENTS, data.arrivalEvents);
+    writeGraph(EVENT_GRAPH_BEGIN_OUT, data.stopEventGraph);
+    writeSection(EVENT_GRAPH_LOCAL_LEVEL, data.stopEventGraph.get(LocalLevel));
+    writeSection(CELL_IDS, data.cellIds);
+
+    const TREXQueryTables &tables = data.queryTables;
+    writeSection(EDGE_LABELS, tables.edgeLabels);
+    writeSection(COMPACT_EDGE_LABELS, tables.compactEdgeLabels);
+    writeSection(NUMBER_OF_TRIPS_OF_ROUTE, tables.numberOfTripsOfRoute);
+    writeSection(FIRST_DEPARTURE_TIME_OF_ROUTE,
+                 tables.firstDepartureTimeOfRoute);
+    writeSection(DEPARTURE_TIMES, tables.departureTimes);
+    writeGraph(REVERSE_TRANSFER_GRAPH_BEGIN_OUT, tables.reverseTransferGraph);
+
+    header.magic = Magic;
+    header.version = Version;
+    header.numberOfStops = data.numberOfStops();
+    header.numberOfLevels = data.getNumberOfLevels();
+    header.numberOfCellsPerLevel = data.getNumberOfCellsPerLevel();
+    os.seekp(0);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    Ensure(os.good(), "Could not write file: " << fileName);
+  }
+
+ private:
+  inline void load() noexcept {
+    Ensure(file.size() >= sizeof(Header),
+           "File " << file.getFileName() << " is too small!");
+    header = &file.get<Header>(0);
+    Ensure(header->magic == Magic, "File " << file.getFileName()
+                                           << " is not a mapped TREX file!");
+    Ensure(header->version == Version,
+           "Expected version " << Version << ", but file "
+                               << file.getFileName() << " has version "
+                               << header->version);
+    numberOfLevels = header->numberOfLevels;
+    numberOfCellsPerLevel = header->numberOfCellsPerLevel;
+
+    raptorData.stopEvents = section<RAPTOR::StopEvent>(STOP_EVENTS);
+    raptorData.stopIds = section<StopId>(STOP_IDS);
+    raptorData.firstStopIdOfRoute = section<size_t>(FIRST_STOP_ID_OF_ROUTE);
+    raptorData.routeSegments = section<RAPTOR::RouteSegment>(ROUTE_SEGMENTS);
+    raptorData.firstRouteSegmentOfStop =
+        section<size_t>(FIRST_ROUTE_SEGMENT_OF_STOP);
+    raptorData.transferGraph = graph(TRANSFER_GRAPH_BEGIN_OUT);
+
+    firstTripOfRoute = section<TripId>(FIRST_TRIP_OF_ROUTE);
+    routeOfTrip = section<RouteId>(ROUTE_OF_TRIP);
+    firstStopIdOfTrip = section<size_t>(FIRST_STOP_ID_OF_TRIP);
+    firstStopEventOfTrip = section<StopEventId>(FIRST_STOP_EVENT_OF_TRIP);
+    tripOfStopEvent = section<TripId>(TRIP_OF_STOP_EVENT);
+    indexOfStopEvent = section<StopIndex>(INDEX_OF_STOP_EVENT);
+    arrivalEvents = section<ArrivalEvent>(ARRIVAL_EVENTS);
+    stopEventGraph = graph(EVENT_GRAPH_BEGIN_OUT);
+    stopEventGraph.localLevel = section<uint8_t>(EVENT_GRAPH_LOCAL_LEVEL);
+    cellIds = section<uint32_t>(CELL_IDS);
+
+    queryTables.edgeLabels =
+        section<MappedTREXQueryTables::EdgeLabel>(EDGE_LABELS);
+    queryTables.compactEdgeLabels =
+        section<MappedTREXQueryTables::CompactEdgeLabel>(COMPACT_EDGE_LABELS);
+    queryTables.numberOfTripsOfRoute =
+        section<u_int32_t>(NUMBER_OF_TRIPS_OF_ROUTE);
+    queryTables.firstDepartureTimeOfRoute =
+        section<size_t>(FIRST_DEPARTURE_TIME_OF_ROUTE);
+    queryTables.departureTimes = section<int>(DEPARTURE_TIMES);
+    queryTables.reverseTransferGraph = graph(REVERSE_TRANSFER_GRAPH_BEGIN_OUT);
+
+    Ensure(numberOfStops() == header->numberOfStops,
+           "File " << file.getFileName() << " is corrupted!");
+    Ensure(cellIds.size() == numberOfStops(),
+           "File " << file.getFileName() << " is corrupted!");
+    Ensure(firstTripOfRoute.size() == numberOfRoutes() + 1,
+           "File " << file.getFileName() << " is corrupted!");
+    Ensure(queryTables.edgeLabels.size() == stopEventGraph.numEdges(),
+           "File " << file.getFileName() << " is corrupted!");
+    Ensure(queryTables.compactEdgeLabels.size() == stopEventGraph.numEdges(),
+           "File " << file.getFileName() << " is corrupted!");
+  }
+
+  template <typename T>
+  inline std::span<const T> section(const Section section) const noexcept {
+    const SectionEntry &entry = header->sections[section];
+    Ensure(entry.elementSize == sizeof(T),
+           "Section " << section << " of file " << file.getFileName()
+                      << " has elements of size " << entry.elementSize
+                      << ", but expected " << sizeof(T) << "!");
+    return file.array<T>(entry.offset, entry.count);
+  }
+
+  inline MappedStaticGraph graph(const Section beginOut) const noexcept {
+    MappedStaticGraph result;
+    result.beginOut = section<Edge>(beginOut);
+    result.toVertex = section<Vertex>(Section(beginOut + 1));
+    result.travelTime = section<int>(Section(beginOut + 2));
+    Ensure(result.travelTime.size() == result.toVertex.size(),
+           "File " << file.getFileName() << " is corrupted!");
+    return result;
+  }
+
+ private:
+  IO::MemoryMappedFile file;
+  const Header *header;
+  int numberOfLevels;
+  int numberOfCellsPerLevel;
+
+ public:
+  MappedRAPTORData raptorData;
+
+  std::span<const TripId> firstTripOfRoute;
+
+  std::span<const RouteId> routeOfTrip;
+  std::span<const size_t> firstStopIdOfTrip;
+  std::span<const StopEventId> firstStopEventOfTrip;
+
+  std::span<const TripId> tripOfStopEvent;
+  std::span<const StopIndex> indexOfStopEvent;
+
+  std::span<const ArrivalEvent> arrivalEvents;
+  MappedStaticGraph stopEventGraph;
+
+  std::span<const uint32_t> cellIds;
+
+  MappedTREXQueryTables queryTables;
+};
+
+}  // namespace TripBased
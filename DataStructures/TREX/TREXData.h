@@ -24,6 +24,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **********************************************************************************/
 #pragma once
 
+#include <bit>
 #include <cmath>
 #include <numeric>
 #include <string>
@@ -35,18 +36,26 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RAPTOR/Data.h"
 #include "../RAPTOR/Entities/RouteSegment.h"
 #include "../TripBased/Data.h"
+#include "TREXQueryTables.h"
 
 namespace TripBased {
 
 class TREXData : public Data {
  public:
-  TREXData(const RAPTOR::Data &raptor, const int numLevels)
+  using QueryTables = TREXQueryTables;
+
+  TREXData(const RAPTOR::Data &raptor, const int numLevels,
+           const int numCellsPerLevel = 2)
       : Data(raptor),
         numberOfLevels(numLevels),
+        numberOfCellsPerLevel(numCellsPerLevel),
         unionFind(numberOfStops()),
         layoutGraph(),
         localLevelOfEvent(raptor.numberOfStopEvents(), 0),
-        cellIds(raptor.numberOfStops(), 0) {}
+        cellIds(raptor.numberOfStops(), 0),
+        queryTables() {
+    checkHierarchy();
+  }
 
   TREXData(const std::string &fileName) { deserialize(fileName); }
 
@@ -54,6 +63,7 @@ class TREXData : public Data {
   inline void addInformationToStopEventGraph() noexcept {
     std::vector<uint8_t> zeroLevels(stopEventGraph.numEdges(), 0);
     stopEventGraph.get(LocalLevel).swap(zeroLevels);
+    localLevelOfEvent.assign(numberOfStopEvents(), 0);
 
     /* std::vector<uint8_t> initHops(stopEventGraph.numEdges(), 1); */
     /* stopEventGraph.get(Hop).swap(initHops); */
@@ -105,10 +115,22 @@ class TREXData : public Data {
                 "unionFind is out of bounds!");
       AssertMsg(layoutGraph.get(Weight, Vertex(unionFind(i))) > 0,
                 "The corresponding vertex weight is zero?");
+      AssertMsg(globalIds[unionFind(i)] <= UINT32_MAX,
+                "Cell id " << globalIds[unionFind(i)]
+                           << " does not fit into 32 bits!");
       cellIds[i] = globalIds[unionFind(i)];
     }
 
     AssertMsg(assertNoCutTransfers(), "Footpath has been cut!");
+
+    // the cell ids are part of the query tables
+    buildQueryTables();
+  }
+
+  // Builds the tables which are shared by all TREX queries, needs to be called
+  // whenever the cell ids or the local levels change
+  inline void buildQueryTables() noexcept {
+    queryTables.build(*this, cellIds, getNumberOfBitsPerLevel());
   }
 
   inline void createCompactLayoutGraph() {
@@ -296,7 +318,25 @@ class TREXData : public Data {
   // Getter
   inline int getNumberOfLevels() const noexcept { return numberOfLevels; }
 
-  inline int getNumberOfCellsPerLevel() const noexcept { return 2; }
+  inline int getNumberOfCellsPerLevel() const noexcept {
+    return numberOfCellsPerLevel;
+  }
+
+  // Every level occupies log2(cells per level) bits of the cell ids, the
+  // lowest level being the least significant bits
+  inline int getNumberOfBitsPerLevel() const noexcept {
+    return std::countr_zero(static_cast<uint32_t>(numberOfCellsPerLevel));
+  }
+
+  // The cell of a stop on the given level is cellId >> getCellShift(level)
+  inline int getCellShift(const int level) const noexcept {
+    return level * getNumberOfBitsPerLevel();
+  }
+
+  inline uint32_t getCellOfStop(const StopId stop,
+                                const int level) const noexcept {
+    return cellIds[stop] >> getCellShift(level);
+  }
 
   inline uint64_t getCellIdOfStop(const StopId &stop) const noexcept {
     AssertMsg(isStop(stop), "Stop is not a stop!");
@@ -338,23 +378,38 @@ class TREXData : public Data {
     Data::printInfo();
     std::cout << "   Number of Levels:         " << std::setw(12)
               << (int)numberOfLevels << std::endl;
-    std::cout << "   Cells per Level:          " << std::setw(12) << "2"
-              << std::endl;
+    std::cout << "   Cells per Level:          " << std::setw(12)
+              << numberOfCellsPerLevel << std::endl;
   }
 
   // Serialization
   inline void serialize(const std::string &fileName) const noexcept {
     Data::serialize(fileName + ".trip");
-    IO::serialize(fileName, numberOfLevels, unionFind, layoutGraph,
-                  localLevelOfEvent, cellIds);
+    IO::serialize(fileName, numberOfLevels, numberOfCellsPerLevel, unionFind,
+                  layoutGraph, localLevelOfEvent, cellIds);
     stopEventGraph.writeBinary(fileName + ".trip.graph");
+    if (queryTables.isBuilt()) {
+      queryTables.serialize(fileName + ".tables");
+    } else {
+      // do not keep tables of an older version of this data
+      FileSystem::deleteFile(fileName + ".tables");
+    }
   }
 
   inline void deserialize(const std::string &fileName) noexcept {
     Data::deserialize(fileName + ".trip");
-    IO::deserialize(fileName, numberOfLevels, unionFind, layoutGraph,
-                    localLevelOfEvent, cellIds);
+    IO::deserialize(fileName, numberOfLevels, numberOfCellsPerLevel, unionFind,
+                    layoutGraph, localLevelOfEvent, cellIds);
+    checkHierarchy();
     stopEventGraph.readBinary(fileName + ".trip.graph");
+    if (FileSystem::isFile(fileName + ".tables")) {
+      queryTables.deserialize(fileName + ".tables", raptorData.transferGraph);
+    }
+    if (!queryTables.matches(*this, cellIds, getNumberOfBitsPerLevel())) {
+      std::cout << "Query tables are missing or outdated, rebuilding them!"
+                << std::endl;
+      buildQueryTables();
+    }
   }
 
   inline void writePartitionToCSV(const std::string &fileName) noexcept {
@@ -398,7 +453,29 @@ class TREXData : public Data {
 
   inline bool isLevel(int level) const { return level < numberOfLevels; }
 
-  inline void setNumberOfLevels(int level) noexcept { numberOfLevels = level; }
+  inline void setNumberOfLevels(int level) noexcept {
+    setHierarchy(level, numberOfCellsPerLevel);
+  }
+
+  inline void setHierarchy(const int numLevels,
+                           const int numCellsPerLevel) noexcept {
+    numberOfLevels = numLevels;
+    numberOfCellsPerLevel = numCellsPerLevel;
+    checkHierarchy();
+  }
+
+  // The cell ids have 32 bits, and the query shifts them by up to
+  // numberOfLevels * bits per level
+  inline void checkHierarchy() const noexcept {
+    Ensure(numberOfCellsPerLevel >= 2 &&
+               std::has_single_bit(static_cast<uint32_t>(numberOfCellsPerLevel)),
+           "The number of cells per level (" << numberOfCellsPerLevel
+                                             << ") has to be a power of two!");
+    Ensure(numberOfLevels * getNumberOfBitsPerLevel() < 32,
+           "A hierarchy with " << numberOfLevels << " levels of "
+                               << numberOfCellsPerLevel
+                               << " cells does not fit into 32 bit cell ids!");
+  }
 
   inline void writeLocalLevelOfTripsToCSV(
       const std::string &fileName) const noexcept {
@@ -451,14 +528,18 @@ class TREXData : public Data {
 
  public:
   int numberOfLevels;
+  int numberOfCellsPerLevel;
   UnionFind unionFind;
   StaticGraphWithWeightsAndCoordinates layoutGraph;
 
   // we also keep track of the highest locallevel of an event
   std::vector<uint8_t> localLevelOfEvent;
 
-  // for the 2' cell ids
-  std::vector<uint16_t> cellIds;
+  // the cell id of every stop, the cell on level l is cellId >> getCellShift(l)
+  std::vector<uint32_t> cellIds;
+
+  // edge and route labels used by the queries
+  TREXQueryTables queryTables;
 };
 
 }  // namespace TripBased
@@ -0,0 +1,254 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../../Helpers/Assert.h"
+#include "../../Helpers/FileSystem/FileSystem.h"
+#include "../../Helpers/IO/Serialization.h"
+#include "../../Helpers/Types.h"
+#include "../../Helpers/Vector/Vector.h"
+#include "../Graph/Graph.h"
+#include "../TripBased/Data.h"
+
+namespace TripBased {
+
+// Read-only tables derived from the TREX data, which every query needs. They
+// are part of the TREXData (and serialized with it), hence any number of query
+// objects (and threads) can share them.
+class TREXQueryTables {
+ public:
+  struct EdgeLabel {
+    EdgeLabel(const StopEventId firstEvent = noStopEvent,
+              const TripId trip = noTripId,
+              const StopIndex stopEvent = noStopIndex,
+              const uint32_t cellId = 0, const uint8_t cellShift = 0)
+        : firstEvent(firstEvent),
+          trip(trip),
+          stopEvent(stopEvent),
+          cellId(cellId),
+          cellShift(cellShift) {}
+    StopEventId firstEvent;
+    TripId trip;
+    StopIndex stopEvent;
+    uint32_t cellId;
+    // local level of the transfer times the number of bits per level, i.e.,
+    // the transfer is relevant for all cell ids sharing the prefix cellId >>
+    // cellShift
+    uint8_t cellShift;
+  };
+
+  // Same information as the EdgeLabel, packed into 8 bytes (the reached index
+  // stores stop indices in one byte anyway). The first event of the trip is
+  // only needed for transfers, which are not pruned, hence it is looked up in
+  // the data instead. The cell id is the same for all transfers of a stop
+  // event, hence the query looks it up once per event.
+  struct CompactEdgeLabel {
+    CompactEdgeLabel(const TripId trip = noTripId,
+                     const uint8_t stopEvent = 0, const uint8_t cellShift = 0)
+        : trip(trip), stopEvent(stopEvent), cellShift(cellShift) {}
+    TripId trip;
+    uint8_t stopEvent;
+    uint8_t cellShift;
+  };
+  static_assert(sizeof(CompactEdgeLabel) == 8,
+                "CompactEdgeLabel should fit into 8 bytes!");
+
+  // View onto the departure times of one route, stored stop-major, i.e., the
+  // departure of trip t at stop index i is departureTimes[i * numberOfTrips +
+  // t]
+  struct RouteLabel {
+    RouteLabel(const u_int32_t numberOfTrips = 0,
+               const StopIndex endIndex = StopIndex(0),
+               const int *departureTimes = nullptr)
+        : numberOfTrips(numberOfTrips),
+          endIndex(endIndex),
+          departureTimes(departureTimes) {}
+    inline StopIndex end() const noexcept { return endIndex; }
+    u_int32_t numberOfTrips;
+    StopIndex endIndex;
+    const int *departureTimes;
+  };
+
+ public:
+  TREXQueryTables() {}
+
+  inline void build(const Data &data, const std::vector<uint32_t> &cellIds,
+                    const int bitsPerLevel) noexcept {
+    edgeLabels.assign(data.stopEventGraph.numEdges(), EdgeLabel());
+    for (const auto [edge, from] : data.stopEventGraph.edgesWithFromVertex()) {
+      edgeLabels[edge].trip =
+          data.tripOfStopEvent[data.stopEventGraph.get(ToVertex, edge)];
+      edgeLabels[edge].firstEvent =
+          data.firstStopEventOfTrip[edgeLabels[edge].trip];
+      edgeLabels[edge].stopEvent =
+          StopIndex(StopEventId(data.stopEventGraph.get(ToVertex, edge) + 1) -
+                    edgeLabels[edge].firstEvent);
+      edgeLabels[edge].cellShift =
+          data.stopEventGraph.get(LocalLevel, edge) * bitsPerLevel;
+      edgeLabels[edge].cellId =
+          cellIds[data.getStopOfStopEvent(StopEventId(from))];
+    }
+
+    buildCompactEdgeLabels();
+
+    numberOfTripsOfRoute.assign(data.numberOfRoutes(), 0);
+    firstDepartureTimeOfRoute.assign(data.numberOfRoutes() + 1, 0);
+    departureTimes.clear();
+    for (const RouteId route : data.raptorData.routes()) {
+      const size_t numberOfStops = data.numberOfStopsInRoute(route);
+      const size_t numberOfTrips = data.raptorData.numberOfTripsInRoute(route);
+      const RAPTOR::StopEvent *stopEvents =
+          data.raptorData.firstTripOfRoute(route);
+      const size_t offset = departureTimes.size();
+      numberOfTripsOfRoute[route] = numberOfTrips;
+      firstDepartureTimeOfRoute[route] = offset;
+      departureTimes.resize(offset + ((numberOfStops - 1) * numberOfTrips));
+      for (size_t trip = 0; trip < numberOfTrips; trip++) {
+        for (size_t stopIndex = 0; stopIndex + 1 < numberOfStops; stopIndex++) {
+          departureTimes[offset + (stopIndex * numberOfTrips) + trip] =
+              stopEvents[(trip * numberOfStops) + stopIndex].departureTime;
+        }
+      }
+    }
+    firstDepartureTimeOfRoute.back() = departureTimes.size();
+
+    buildReverseTransferGraph(data.raptorData.transferGraph);
+    fingerprint = computeFingerprint(data, cellIds, bitsPerLevel);
+  }
+
+  // Hash of the cell ids and the local levels, which the edge labels are
+  // derived from. A tables file left over from an older partition or
+  // customization of the same network has the same sizes, but not the same
+  // fingerprint.
+  inline static uint64_t computeFingerprint(
+      const Data &data, const std::vector<uint32_t> &cellIds,
+      const int bitsPerLevel) noexcept {
+    uint64_t result = 0xcbf29ce484222325ull;
+    const auto mix = [&](const uint64_t value) {
+      result ^= value;
+      result *= 0x100000001b3ull;
+    };
+    mix(uint64_t(bitsPerLevel));
+    mix(cellIds.size());
+    for (const uint32_t cellId : cellIds) mix(cellId);
+    mix(data.stopEventGraph.numEdges());
+    for (const Edge edge : data.stopEventGraph.edges()) {
+      mix(uint64_t(data.stopEventGraph.get(LocalLevel, edge)));
+    }
+    // never equal to the fingerprint of tables without one
+    return result ? result : 1;
+  }
+
+  inline void buildCompactEdgeLabels() noexcept {
+    compactEdgeLabels.resize(edgeLabels.size());
+    for (size_t edge = 0; edge < edgeLabels.size(); ++edge) {
+      const EdgeLabel &label = edgeLabels[edge];
+      AssertMsg(label.stopEvent < 256, "Stop index does not fit into a byte!");
+      compactEdgeLabels[edge] = CompactEdgeLabel(
+          label.trip, uint8_t(label.stopEvent), label.cellShift);
+    }
+  }
+
+  inline void buildReverseTransferGraph(
+      const TransferGraph &transferGraph) noexcept {
+    reverseTransferGraph = transferGraph;
+    reverseTransferGraph.revert();
+  }
+
+  inline bool isBuilt() const noexcept {
+    return !firstDepartureTimeOfRoute.empty();
+  }
+
+  // Checks that the tables fit to the given data (e.g., after loading them from
+  // a file)
+  inline bool matches(const Data &data, const std::vector<uint32_t> &cellIds,
+                      const int bitsPerLevel) const noexcept {
+    return (edgeLabels.size() == data.stopEventGraph.numEdges()) &&
+           (compactEdgeLabels.size() == edgeLabels.size()) &&
+           (numberOfTripsOfRoute.size() == data.numberOfRoutes()) &&
+           (firstDepartureTimeOfRoute.size() == data.numberOfRoutes() + 1) &&
+           (departureTimes.size() ==
+            data.numberOfStopEvents() - data.numberOfTrips()) &&
+           (fingerprint == computeFingerprint(data, cellIds, bitsPerLevel));
+  }
+
+  inline RouteLabel routeLabel(const RouteId route) const noexcept {
+    AssertMsg(route < numberOfTripsOfRoute.size(),
+              "Route " << route << " is out of bounds!");
+    const u_int32_t numberOfTrips = numberOfTripsOfRoute[route];
+    const size_t begin = firstDepartureTimeOfRoute[route];
+    const size_t end = firstDepartureTimeOfRoute[route + 1];
+    const StopIndex endIndex(numberOfTrips ? (end - begin) / numberOfTrips : 0);
+    return RouteLabel(numberOfTrips, endIndex, departureTimes.data() + begin);
+  }
+
+  inline const int *departureTimesOfRoute(const RouteId route) const noexcept {
+    return departureTimes.data() + firstDepartureTimeOfRoute[route];
+  }
+
+  inline long long byteSize() const noexcept {
+    long long result = Vector::byteSize(edgeLabels);
+    result += Vector::byteSize(compactEdgeLabels);
+    result += Vector::byteSize(numberOfTripsOfRoute);
+    result += Vector::byteSize(firstDepartureTimeOfRoute);
+    result += Vector::byteSize(departureTimes);
+    result += reverseTransferGraph.byteSize();
+    return result;
+  }
+
+  // Serialization, the compact edge labels and the reverse transfer graph are
+  // cheap to recompute and hence not stored
+  inline void serialize(const std::string &fileName) const noexcept {
+    IO::serialize(fileName, edgeLabels, numberOfTripsOfRoute,
+                  firstDepartureTimeOfRoute, departureTimes, fingerprint);
+  }
+
+  inline void deserialize(const std::string &fileName,
+                          const TransferGraph &transferGraph) noexcept {
+    // files written without a fingerprint keep it at 0, i.e., never match
+    fingerprint = 0;
+    IO::deserialize(fileName, edgeLabels, numberOfTripsOfRoute,
+                    firstDepartureTimeOfRoute, departureTimes, fingerprint);
+    buildCompactEdgeLabels();
+    buildReverseTransferGraph(transferGraph);
+  }
+
+ public:
+  std::vector<EdgeLabel> edgeLabels;
+  std::vector<CompactEdgeLabel> compactEdgeLabels;
+
+  std::vector<u_int32_t> numberOfTripsOfRoute;
+  std::vector<size_t> firstDepartureTimeOfRoute;
+  std::vector<int> departureTimes;
+
+  TransferGraph reverseTransferGraph;
+
+  uint64_t fingerprint{0};
+};
+
+}  // namespace TripBased
@@ -32,8 +32,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../RAPTOR/Data.h"
 #include "../RAPTOR/Entities/RouteSegment.h"
 #include "../RAPTOR/Entities/StopEvent.h"
+#include "Entities/CompactLowerBounds.h"
 #include "Entities/Lookups.h"
 #include "Entities/LowerBound.h"
+#include "Entities/TransferPatternStore.h"
 
 namespace TransferPattern {
 
@@ -41,16 +43,21 @@ class Data {
  public:
   Data() {}
 
-  Data(const RAPTOR::Data& data)
+  // With numberOfLowerBoundCells > 0, the lower bounds are kept per pair of
+  // cells (see CompactLowerBounds) instead of per pair of stops.
+  Data(const RAPTOR::Data& data, const size_t numberOfLowerBoundCells = 0)
       : raptorData(data),
         lineLookup(data.numberOfRoutes()),
         stopLookup(data.numberOfStops()),
-        firstTripIdOfLine(data.numberOfRoutes() + 1, noTripId),
-        transferPatternOfStop(data.numberOfStops()),
-        lowerBounds(data.numberOfStops()) {
-    // fill all the lowerBounds with enough space
-    for (size_t stop(0); stop < data.numberOfStops(); ++stop) {
-      lowerBounds[stop].resize(data.numberOfStops());
+        firstTripIdOfLine(data.numberOfRoutes() + 1, noTripId) {
+    if (numberOfLowerBoundCells > 0) {
+      compactLowerBounds = CompactLowerBounds(data, numberOfLowerBoundCells);
+    } else {
+      // fill all the lowerBounds with enough space
+      lowerBounds.resize(data.numberOfStops());
+      for (size_t stop(0); stop < data.numberOfStops(); ++stop) {
+        lowerBounds[stop].resize(data.numberOfStops());
+      }
     }
 
     buildLineLookup();
@@ -142,6 +149,11 @@ class Data {
     AssertMsg(bestMinNumberOfTrips.size() == raptorData.numberOfStops(),
               "BestMinNumberOfTrips has not the right amount of elements!");
 
+    if (hasCompactLowerBounds()) {
+      compactLowerBounds.update(stop, bestTravelTimes, bestMinNumberOfTrips);
+      return;
+    }
+
     for (size_t i(0); i < raptorData.numberOfStops(); ++i) {
       AssertMsg(stop < lowerBounds[i].travelTimes.size(),
                 "Size is not correct!");
@@ -157,6 +169,8 @@ class Data {
     AssertMsg(raptorData.isStop(target), "Target is not a stop!");
     AssertMsg(raptorData.isStop(u), "Stop u is not a stop!");
 
+    if (hasCompactLowerBounds())
+      return compactLowerBounds.getTravelTime(target, u);
     return lowerBounds[target].travelTimes[u];
   }
 
@@ -164,9 +178,44 @@ class Data {
     AssertMsg(raptorData.isStop(target), "Target is not a stop!");
     AssertMsg(raptorData.isStop(u), "Stop u is not a stop!");
 
+    if (hasCompactLowerBounds())
+      return compactLowerBounds.getNumberOfTrips(target, u);
     return lowerBounds[target].numberOfTrips[u];
   }
 
+  inline bool hasCompactLowerBounds() const noexcept {
+    return !compactLowerBounds.empty();
+  }
+
+  // Replaces the dense stop-to-stop lower bounds by cell-to-cell bounds.
+  inline void useCompactLowerBounds(const size_t numberOfCells) {
+    AssertMsg(!hasCompactLowerBounds(), "Lower bounds are already compact!");
+    AssertMsg(lowerBounds.size() == raptorData.numberOfStops(),
+              "Dense lower bounds are missing!");
+
+    compactLowerBounds = CompactLowerBounds(raptorData, numberOfCells);
+    std::vector<int> travelTimes(raptorData.numberOfStops());
+    std::vector<uint8_t> numberOfTrips(raptorData.numberOfStops());
+    for (const StopId source : raptorData.stops()) {
+      for (const StopId target : raptorData.stops()) {
+        travelTimes[target] = lowerBounds[target].travelTimes[source];
+        numberOfTrips[target] = lowerBounds[target].numberOfTrips[source];
+      }
+      compactLowerBounds.update(source, travelTimes, numberOfTrips);
+    }
+    std::vector<LowerBound>().swap(lowerBounds);
+  }
+
+  inline long long lowerBoundsByteSize() const noexcept {
+    if (hasCompactLowerBounds()) return compactLowerBounds.byteSize();
+    long long result = 0;
+    for (const LowerBound& bound : lowerBounds) {
+      result += Vector::byteSize(bound.travelTimes);
+      result += Vector::byteSize(bound.numberOfTrips);
+    }
+    return result;
+  }
+
   inline RAPTOR::StopEvent getStopEvent(
       const RouteId routeId = noRouteId, const size_t tripIndex = (size_t)-1,
       const StopIndex stopIndex = StopIndex(0)) const {
@@ -216,7 +265,8 @@ class Data {
 
   inline std::pair<size_t, size_t> maxNumVerticesAndNumEdgesInTP() const {
     std::pair<size_t, size_t> result(0, 0);
-    for (auto& tp : transferPatternOfStop) {
+    for (size_t stop(0); stop < transferPatterns.numberOfStops(); ++stop) {
+      const TransferPatternDAG tp = transferPatterns.dagOfStop(StopId(stop));
       result.first = std::max(result.first, tp.numVertices());
       result.second = std::max(result.second, tp.numEdges());
     }
@@ -225,14 +275,9 @@ class Data {
   }
 
   inline void printStatsAboutTP() const {
-    size_t sumVertices(0), sumEdges(0), maxVertices(0), maxEdges(0);
-    for (auto& tp : transferPatternOfStop) {
-      maxVertices = std::max(tp.numVertices(), maxVertices);
-      maxEdges = std::max(tp.numEdges(), maxEdges);
-
-      sumVertices += tp.numVertices();
-      sumEdges += tp.numEdges();
-    }
+    const size_t sumVertices = transferPatterns.numVertices();
+    const size_t sumEdges = transferPatterns.numEdges();
+    const auto [maxVertices, maxEdges] = maxNumVerticesAndNumEdgesInTP();
 
     std::cout << "   Total # of vertices:      " << std::setw(12)
               << String::prettyInt(sumVertices) << std::endl;
@@ -248,9 +293,8 @@ class Data {
     long long result = Vector::byteSize(lineLookup);
     result += Vector::byteSize(stopLookup);
     result += raptorData.byteSize();
-
-    for (size_t stop(0); stop < transferPatternOfStop.size(); ++stop)
-      result += transferPatternOfStop[stop].byteSize();
+    result += lowerBoundsByteSize();
+    result += transferPatterns.byteSize();
 
     return result;
   }
@@ -265,23 +309,28 @@ class Data {
     printStatsAboutTP();
     std::cout << "   Storage usage of all TP:  " << std::setw(12)
               << String::bytesToString(byteSize()) << std::endl;
+    std::cout << "   Storage of lower bounds:  " << std::setw(12)
+              << String::bytesToString(lowerBoundsByteSize());
+    if (hasCompactLowerBounds())
+      std::cout << " (" << compactLowerBounds.numberOfCells() << " cells)";
+    std::cout << std::endl;
   }
 
   inline void serialize(const std::string& fileName) {
     raptorData.serialize(fileName + ".raptor");
     IO::serialize(fileName, lineLookup, stopLookup, firstTripIdOfLine,
-                  lowerBounds);
-    IO::serialize(fileName + ".transferPattern", transferPatternOfStop);
+                  lowerBounds, compactLowerBounds);
+    transferPatterns.write(fileName + ".transferPattern");
   }
 
   inline void deserialize(const std::string& fileName) {
     raptorData.deserialize(fileName + ".raptor");
     IO::deserialize(fileName, lineLookup, stopLookup, firstTripIdOfLine,
-                    lowerBounds);
+                    lowerBounds, compactLowerBounds);
 
-    std::cout << "Loading all transfer patterns from " << fileName
+    std::cout << "Mapping all transfer patterns from " << fileName
               << ".transferPattern!" << std::endl;
-    IO::deserialize(fileName + ".transferPattern", transferPatternOfStop);
+    transferPatterns.map(fileName + ".transferPattern");
   }
 
  public:
@@ -291,11 +340,13 @@ class Data {
   std::vector<StopLookup> stopLookup;
   std::vector<TripId> firstTripIdOfLine;
 
-  // StaticDAGTransferPattern holds ViaVertex == points to the correct StopId
-  // and holds TravelTime == if negative, the edge is a trip edge
-  std::vector<StaticDAGTransferPattern> transferPatternOfStop;
+  // The DAG of every stop; ViaVertex points to the correct StopId and
+  // TravelTime is negative if the edge is a trip edge
+  TransferPatternStore transferPatterns;
 
+  // Exactly one of these holds the lower bounds
   std::vector<LowerBound> lowerBounds;
+  CompactLowerBounds compactLowerBounds;
 };
 
 }  // namespace TransferPattern
@@ -63,6 +63,12 @@ class DijkstraBag : public ExternalKHeapElement {
     return false;
   }
 
+  // Removes all labels, but keeps the allocated memory
+  inline void clear() noexcept {
+    labels.clear();
+    nonHeapLabels.clear();
+  }
+
   inline size_t size() const noexcept { return labels.size(); }
 
   inline size_t nonHeapSize() const noexcept { return nonHeapLabels.size(); }
@@ -0,0 +1,165 @@
+/**********************************************************************************
+
+ Copyright (c) 2023-2025 Patrick Steil
+ Copyright (c) 2019-2022 KIT ITI Algorithmics Group
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "../../../Helpers/Assert.h"
+#include "../../../Helpers/IO/Serialization.h"
+#include "../../../Helpers/MultiThreading.h"
+#include "../../../Helpers/Types.h"
+#include "../../../Helpers/Vector/Vector.h"
+#include "../../RAPTOR/Data.h"
+
+namespace TransferPattern {
+
+// Lower bounds for the A* Transfer Pattern query that need O(c^2) instead of
+// O(n^2) space. The stops are partitioned into c geographic cells (by
+// recursively splitting at the median coordinate), and for every pair of cells
+// the minimum bound over all pairs of stops in them is kept. Travel times are
+// stored in whole minutes (rounded down, saturating at MaxMinutes), so a bound
+// takes three bytes per pair of cells and is never larger than the exact one.
+class CompactLowerBounds {
+ public:
+  static constexpr uint16_t MaxMinutes = 0xFFFF;
+
+  CompactLowerBounds() : numCells(0) {}
+
+  CompactLowerBounds(const RAPTOR::Data& data, const size_t numberOfCells)
+      : numCells(std::max<size_t>(1, std::min(numberOfCells,
+                                              data.numberOfStops()))),
+        cellOfStop(data.numberOfStops(), 0),
+        minutes(numCells * numCells, MaxMinutes),
+        numberOfTrips(numCells * numCells, 255) {
+    std::vector<StopId> stops(data.numberOfStops());
+    std::iota(stops.begin(), stops.end(), StopId(0));
+    uint32_t nextCell = 0;
+    partition(data, stops.begin(), stops.end(), numCells, nextCell);
+    AssertMsg(nextCell == numCells, "Partition created " << nextCell
+                                                         << " instead of "
+                                                         << numCells
+                                                         << " cells!");
+  }
+
+  inline bool empty() const noexcept { return numCells == 0; }
+
+  inline size_t numberOfCells() const noexcept { return numCells; }
+
+  inline uint32_t cell(const StopId stop) const noexcept {
+    return cellOfStop[stop];
+  }
+
+  // Incorporates the bounds from the given source to every stop (indexed by
+  // the target stop). Several threads may call this concurrently.
+  inline void update(const StopId source, const std::vector<int>& travelTimes,
+                     const std::vector<uint8_t>& minNumberOfTrips) noexcept {
+    AssertMsg(travelTimes.size() == cellOfStop.size(),
+              "Travel times have the wrong size!");
+    AssertMsg(minNumberOfTrips.size() == cellOfStop.size(),
+              "Number of trips have the wrong size!");
+    const size_t sourceCell = cellOfStop[source];
+    for (size_t target = 0; target < cellOfStop.size(); target++) {
+      const size_t i = cellOfStop[target] * numCells + sourceCell;
+      atomicMin(minutes[i], toMinutes(travelTimes[target]));
+      atomicMin(numberOfTrips[i], minNumberOfTrips[target]);
+    }
+  }
+
+  inline int getTravelTime(const StopId target, const StopId u) const noexcept {
+    return int(minutes[index(target, u)]) * 60;
+  }
+
+  inline int getNumberOfTrips(const StopId target,
+                              const StopId u) const noexcept {
+    return numberOfTrips[index(target, u)];
+  }
+
+  inline long long byteSize() const noexcept {
+    return Vector::byteSize(cellOfStop) + Vector::byteSize(minutes) +
+           Vector::byteSize(numberOfTrips);
+  }
+
+  inline void serialize(IO::Serialization& serialize) const {
+    serialize(numCells, cellOfStop, minutes, numberOfTrips);
+  }
+
+  inline void deserialize(IO::Deserialization& deserialize) {
+    deserialize(numCells, cellOfStop, minutes, numberOfTrips);
+  }
+
+ private:
+  inline size_t index(const StopId target, const StopId u) const noexcept {
+    AssertMsg(target < cellOfStop.size(), "Target is not a stop!");
+    AssertMsg(u < cellOfStop.size(), "Stop u is not a stop!");
+    return cellOfStop[target] * numCells + cellOfStop[u];
+  }
+
+  inline static uint16_t toMinutes(const int travelTime) noexcept {
+    if (travelTime <= 0) return 0;
+    return uint16_t(std::min<int>(travelTime / 60, MaxMinutes));
+  }
+
+  template <typename ITERATOR>
+  inline void partition(const RAPTOR::Data& data, const ITERATOR begin,
+                        const ITERATOR end, const size_t cells,
+                        uint32_t& nextCell) noexcept {
+    if (cells == 1) {
+      for (ITERATOR i = begin; i != end; i++) cellOfStop[*i] = nextCell;
+      nextCell++;
+      return;
+    }
+    double minX = intMax, maxX = -intMax, minY = intMax, maxY = -intMax;
+    for (ITERATOR i = begin; i != end; i++) {
+      const Geometry::Point& point = data.stopData[*i].coordinates;
+      minX = std::min(minX, point.x);
+      maxX = std::max(maxX, point.x);
+      minY = std::min(minY, point.y);
+      maxY = std::max(maxY, point.y);
+    }
+    const bool splitX = (maxX - minX) >= (maxY - minY);
+    const size_t leftCells = cells / 2;
+    const ITERATOR middle = begin + ((end - begin) * leftCells) / cells;
+    std::nth_element(begin, middle, end, [&](const StopId a, const StopId b) {
+      const Geometry::Point& pa = data.stopData[a].coordinates;
+      const Geometry::Point& pb = data.stopData[b].coordinates;
+      return splitX ? (pa.x < pb.x) : (pa.y < pb.y);
+    });
+    partition(data, begin, middle, leftCells, nextCell);
+    partition(data, middle, end, cells - leftCells, nextCell);
+  }
+
+ private:
+  size_t numCells;
+  std::vector<uint32_t> cellOfStop;
+  // Indexed by cell(target) * numCells + cell(u)
+  std::vector<uint16_t> minutes;
+  std::vector<uint8_t> numberOfTrips;
+};
+
+}  // namespace TransferPattern
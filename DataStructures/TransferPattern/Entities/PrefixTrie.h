@@ -0,0 +1,70 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <cstdint>
+
+#include "../../../Helpers/Assert.h"
+#include "../../../Helpers/Types.h"
+#include "../../Container/TimestampedHashMap.h"
+
+namespace TransferPattern {
+
+// Deduplicates the prefixes of the journeys inserted into a transfer pattern
+// DAG. A prefix is identified by the DAG vertex of its parent prefix, the stop
+// it was extended by, and how that stop was reached. Hence, extending a prefix
+// by one leg is a single hash table lookup, and no prefix vectors are copied
+// or hashed. clear() is O(1), so the table can be reused for every source
+// without reallocating.
+class PrefixTrie {
+ public:
+  enum Mode : uint8_t { ByRoute = 0, ByFootpath = 1, ToTarget = 2 };
+
+  PrefixTrie(const size_t initialCapacity = 1 << 10)
+      : children(initialCapacity) {}
+
+  inline void clear() noexcept { children.clear(); }
+
+  inline size_t size() const noexcept { return children.size(); }
+
+  // Returns the vertex of the prefix that extends parent by stop. If there is
+  // no such prefix yet, noVertex is returned and the reference can be used to
+  // store the vertex of the new prefix.
+  inline Vertex& child(const Vertex parent, const StopId stop,
+                       const Mode mode) noexcept {
+    AssertMsg(parent != noVertex, "Parent is not a vertex!");
+    AssertMsg(size_t(stop) < (size_t(1) << 30), "Stop id is too large!");
+    const uint64_t key =
+        (uint64_t(parent) << 32) | (uint64_t(stop) << 2) | uint64_t(mode);
+    return children.findOrInsert(key, noVertex);
+  }
+
+  inline long long byteSize() const noexcept { return children.byteSize(); }
+
+ private:
+  TimestampedHashMap<Vertex> children;
+};
+
+}  // namespace TransferPattern
@@ -0,0 +1,351 @@
+/**********************************************************************************
+
+ Copyright (c) 2023 Patrick Steil
+
+ MIT License
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../../../Helpers/Assert.h"
+#include "../../../Helpers/FileSystem/FileSystem.h"
+#include "../../../Helpers/IO/MemoryMappedFile.h"
+#include "../../../Helpers/IO/Serialization.h"
+#include "../../../Helpers/Ranges/Range.h"
+#include "../../../Helpers/Types.h"
+#include "../../Graph/Graph.h"
+
+namespace TransferPattern {
+
+struct TransferPatternEdge {
+  Vertex toVertex;
+  // negative (-1) if the edge is a trip edge
+  int travelTime;
+};
+
+// One transfer pattern DAG inside a TransferPatternStore. Provides the subset
+// of the StaticGraph interface that the queries use.
+class TransferPatternDAG {
+ public:
+  TransferPatternDAG(const Edge* beginOut, const Vertex* viaVertex,
+                     const TransferPatternEdge* edges,
+                     const size_t numberOfVertices) noexcept
+      : beginOut(beginOut),
+        viaVertex(viaVertex),
+        edges(edges),
+        numberOfVertices(numberOfVertices) {}
+
+  inline size_t numVertices() const noexcept { return numberOfVertices; }
+  inline size_t numEdges() const noexcept {
+    return beginOut[numberOfVertices];
+  }
+
+  inline bool isVertex(const Vertex vertex) const noexcept {
+    return vertex < numberOfVertices;
+  }
+  inline bool isEdge(const Edge edge) const noexcept {
+    return edge < numEdges();
+  }
+
+  inline Range<Vertex> vertices() const noexcept {
+    return Range<Vertex>(Vertex(0), Vertex(numberOfVertices));
+  }
+
+  inline Range<Edge> edgesFrom(const Vertex vertex) const noexcept {
+    AssertMsg(isVertex(vertex), vertex << " is not a valid vertex!");
+    return Range<Edge>(beginOut[vertex], beginOut[vertex + 1]);
+  }
+
+  inline Edge beginEdgeFrom(const Vertex vertex) const noexcept {
+    AssertMsg(isVertex(vertex) || vertex == numberOfVertices,
+              vertex << " is not a valid vertex!");
+    return beginOut[vertex];
+  }
+
+  inline Vertex get(const AttributeNameWrapper<ViaVertex>,
+                    const Vertex vertex) const noexcept {
+    AssertMsg(isVertex(vertex), vertex << " is not a valid vertex!");
+    return viaVertex[vertex];
+  }
+
+  inline Vertex get(const AttributeNameWrapper<ToVertex>,
+                    const Edge edge) const noexcept {
+    AssertMsg(isEdge(edge), edge << " is not a valid edge!");
+    return edges[edge].toVertex;
+  }
+
+  inline int get(const AttributeNameWrapper<TravelTime>,
+                 const Edge edge) const noexcept {
+    AssertMsg(isEdge(edge), edge << " is not a valid edge!");
+    return edges[edge].travelTime;
+  }
+
+ private:
+  const Edge* beginOut;
+  const Vertex* viaVertex;
+  const TransferPatternEdge* edges;
+  size_t numberOfVertices;
+};
+
+// The transfer pattern DAGs of all stops in one contiguous CSR arena. The DAG
+// of a stop occupies the vertex range [firstVertexOfStop[stop],
+// firstVertexOfStop[stop + 1]) and the analogous edge range; vertex and edge
+// ids inside a DAG are local. The arrays are written in a layout that can be
+// memory mapped, so loading the store takes constant time.
+class TransferPatternStore {
+ public:
+  static constexpr uint64_t Magic = 0x31504d4741445054;  // "TPDAGMP1"
+  static constexpr uint64_t Version = 1;
+  static constexpr size_t Alignment = 64;
+
+  enum Section : size_t {
+    FIRST_VERTEX_OF_STOP,
+    FIRST_EDGE_OF_STOP,
+    BEGIN_OUT,
+    VIA_VERTEX,
+    EDGES,
+    NUMBER_OF_SECTIONS
+  };
+
+  struct SectionEntry {
+    uint64_t offset;
+    uint64_t count;
+    uint64_t elementSize;
+  };
+
+  struct Header {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t numberOfStops;
+    SectionEntry sections[NUMBER_OF_SECTIONS];
+  };
+
+ public:
+  TransferPatternStore() : firstVertexOfStop(1, 0), firstEdgeOfStop(1, 0) {
+    bind();
+  }
+
+  TransferPatternStore(const TransferPatternStore&) = delete;
+  TransferPatternStore& operator=(const TransferPatternStore&) = delete;
+  // Moving the vectors keeps their buffers, so the spans stay valid
+  TransferPatternStore(TransferPatternStore&&) = default;
+  TransferPatternStore& operator=(TransferPatternStore&&) = default;
+
+  inline size_t numberOfStops() const noexcept {
+    return firstVertexOfStopSpan.size() - 1;
+  }
+
+  inline size_t numVertices() const noexcept { return viaVertexSpan.size(); }
+
+  inline size_t numEdges() const noexcept { return edgesSpan.size(); }
+
+  inline bool isMapped() const noexcept { return file.isOpen(); }
+
+  inline TransferPatternDAG dagOfStop(const StopId stop) const noexcept {
+    AssertMsg(stop < numberOfStops(), stop << " is not a valid stop!");
+    const size_t firstVertex = firstVertexOfStopSpan[stop];
+    return TransferPatternDAG(beginOutSpan.data() + firstVertex + stop,
+                              viaVertexSpan.data() + firstVertex,
+                              edgesSpan.data() + firstEdgeOfStopSpan[stop],
+                              firstVertexOfStopSpan[stop + 1] - firstVertex);
+  }
+
+  // Moves the DAGs (indexed by stop) into the store, the DAGs are cleared.
+  inline void assign(std::vector<StaticDAGTransferPattern>& dags) noexcept {
+    file.close();
+    firstVertexOfStop.assign(1, 0);
+    firstEdgeOfStop.assign(1, 0);
+    size_t numberOfVertices = 0;
+    size_t numberOfEdges = 0;
+    for (const StaticDAGTransferPattern& dag : dags) {
+      numberOfVertices += dag.numVertices();
+      numberOfEdges += dag.numEdges();
+    }
+    beginOut.clear();
+    beginOut.reserve(numberOfVertices + dags.size());
+    viaVertex.clear();
+    viaVertex.reserve(numberOfVertices);
+    edges.clear();
+    edges.reserve(numberOfEdges);
+    for (StaticDAGTransferPattern& dag : dags) {
+      for (const Vertex vertex : dag.vertices()) {
+        beginOut.emplace_back(dag.beginEdgeFrom(vertex));
+        viaVertex.emplace_back(dag.get(ViaVertex, vertex));
+      }
+      beginOut.emplace_back(Edge(dag.numEdges()));
+      for (const Edge edge : dag.edges()) {
+        edges.emplace_back(TransferPatternEdge{dag.get(ToVertex, edge),
+                                               dag.get(TravelTime, edge)});
+      }
+      firstVertexOfStop.emplace_back(viaVertex.size());
+      firstEdgeOfStop.emplace_back(edges.size());
+      dag.clear();
+    }
+    bind();
+  }
+
+  // Copies the DAG of the stop into a StaticGraph, e.g., for exporting it
+  inline void copyDAG(const StopId stop,
+                      StaticDAGTransferPattern& graph) const noexcept {
+    const TransferPatternDAG dag = dagOfStop(stop);
+    std::vector<Edge> firstEdge;
+    firstEdge.reserve(dag.numVertices() + 1);
+    for (Vertex vertex(0); vertex <= dag.numVertices(); ++vertex) {
+      firstEdge.emplace_back(dag.beginEdgeFrom(vertex));
+    }
+    std::vector<Vertex> toVertex;
+    toVertex.reserve(dag.numEdges());
+    for (Edge edge(0); edge < dag.numEdges(); ++edge) {
+      toVertex.emplace_back(dag.get(ToVertex, edge));
+    }
+    graph.assignEdges(std::move(firstEdge), std::move(toVertex));
+    for (const Vertex vertex : dag.vertices()) {
+      graph.set(ViaVertex, vertex, dag.get(ViaVertex, vertex));
+    }
+    for (Edge edge(0); edge < dag.numEdges(); ++edge) {
+      graph.set(TravelTime, edge, dag.get(TravelTime, edge));
+    }
+  }
+
+  inline long long byteSize() const noexcept {
+    return firstVertexOfStopSpan.size_bytes() +
+           firstEdgeOfStopSpan.size_bytes() + beginOutSpan.size_bytes() +
+           viaVertexSpan.size_bytes() + edgesSpan.size_bytes();
+  }
+
+  // Asks the OS to read the whole mapping ahead, e.g., before measuring
+  // queries
+  inline void prefetch() const noexcept { file.prefetch(); }
+
+  inline void write(const std::string& fileName) const noexcept {
+    std::ofstream os(FileSystem::ensureDirectoryExists(fileName),
+                     std::ios::binary);
+    IO::checkStream(os, fileName);
+
+    // the header is written last, so an aborted write leaves no valid file
+    Header header{};
+    os.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+    auto writeSection = [&](const Section section, const auto& array) {
+      using T = typename std::decay_t<decltype(array)>::value_type;
+      static_assert(std::is_trivially_copyable_v<T>,
+                    "Only trivially copyable types can be mapped!");
+      const size_t position = os.tellp();
+      const size_t offset =
+          ((position + Alignment - 1) / Alignment) * Alignment;
+      const std::vector<char> padding(offset - position, 0);
+      os.write(padding.data(), padding.size());
+      header.sections[section] = {offset, array.size(), sizeof(T)};
+      os.write(reinterpret_cast<const char*>(array.data()),
+               array.size() * sizeof(T));
+    };
+
+    writeSection(FIRST_VERTEX_OF_STOP, firstVertexOfStopSpan);
+    writeSection(FIRST_EDGE_OF_STOP, firstEdgeOfStopSpan);
+    writeSection(BEGIN_OUT, beginOutSpan);
+    writeSection(VIA_VERTEX, viaVertexSpan);
+    writeSection(EDGES, edgesSpan);
+
+    header.magic = Magic;
+    header.version = Version;
+    header.numberOfStops = numberOfStops();
+    os.seekp(0);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    Ensure(os.good(), "Could not write file: " << fileName);
+  }
+
+  // Maps the file instead of reading it; the DAGs are paged in on demand
+  inline void map(const std::string& fileName) noexcept {
+    firstVertexOfStop.clear();
+    firstEdgeOfStop.clear();
+    beginOut.clear();
+    viaVertex.clear();
+    edges.clear();
+    file.open(fileName);
+    Ensure(file.size() >= sizeof(Header),
+           "File " << fileName << " is too small!");
+    const Header& header = file.get<Header>(0);
+    Ensure(header.magic == Magic,
+           "File " << fileName << " is not a mapped transfer pattern file!");
+    Ensure(header.version == Version, "Expected version "
+                                          << Version << ", but file "
+                                          << fileName << " has version "
+                                          << header.version);
+
+    firstVertexOfStopSpan = section<uint64_t>(header, FIRST_VERTEX_OF_STOP);
+    firstEdgeOfStopSpan = section<uint64_t>(header, FIRST_EDGE_OF_STOP);
+    beginOutSpan = section<Edge>(header, BEGIN_OUT);
+    viaVertexSpan = section<Vertex>(header, VIA_VERTEX);
+    edgesSpan = section<TransferPatternEdge>(header, EDGES);
+
+    Ensure(firstVertexOfStopSpan.size() == header.numberOfStops + 1 &&
+               firstEdgeOfStopSpan.size() == header.numberOfStops + 1 &&
+               firstVertexOfStopSpan.back() == viaVertexSpan.size() &&
+               firstEdgeOfStopSpan.back() == edgesSpan.size() &&
+               beginOutSpan.size() == viaVertexSpan.size() + numberOfStops(),
+           "File " << fileName << " is corrupted!");
+  }
+
+ private:
+  inline void bind() noexcept {
+    firstVertexOfStopSpan = firstVertexOfStop;
+    firstEdgeOfStopSpan = firstEdgeOfStop;
+    beginOutSpan = beginOut;
+    viaVertexSpan = viaVertex;
+    edgesSpan = edges;
+  }
+
+  template <typename T>
+  inline std::span<const T> section(const Header& header,
+                                    const Section section) const noexcept {
+    const SectionEntry& entry = header.sections[section];
+    Ensure(entry.elementSize == sizeof(T),
+           "Section " << section << " of file " << file.getFileName()
+                      << " has elements of size " << entry.elementSize
+                      << ", but expected " << sizeof(T) << "!");
+    return file.array<T>(entry.offset, entry.count);
+  }
+
+ private:
+  // Owned storage (after assign), empty if the store is mapped
+  std::vector<uint64_t> firstVertexOfStop;
+  std::vector<uint64_t> firstEdgeOfStop;
+  std::vector<Edge> beginOut;
+  std::vector<Vertex> viaVertex;
+  std::vector<TransferPatternEdge> edges;
+
+  IO::MemoryMappedFile file;
+
+  // Point either into the owned storage or into the mapping
+  std::span<const uint64_t> firstVertexOfStopSpan;
+  std::span<const uint64_t> firstEdgeOfStopSpan;
+  std::span<const Edge> beginOutSpan;
+  std::span<const Vertex> viaVertexSpan;
+  std::span<const TransferPatternEdge> edgesSpan;
+};
+
+}  // namespace TransferPattern
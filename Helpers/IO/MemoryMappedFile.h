@@ -0,0 +1,111 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <span>
+#include <string>
+#include <utility>
+
+#include "../Assert.h"
+
+namespace IO {
+
+// Read-only mapping of a whole file into memory. Pages are loaded lazily by the
+// OS and shared (via the page cache) between all processes mapping the same
+// file.
+class MemoryMappedFile {
+ public:
+  MemoryMappedFile() : address(nullptr), fileSize(0) {}
+
+  MemoryMappedFile(const std::string& fileName)
+      : address(nullptr), fileSize(0) {
+    open(fileName);
+  }
+
+  MemoryMappedFile(const MemoryMappedFile&) = delete;
+  MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+  MemoryMappedFile(MemoryMappedFile&& other) noexcept
+      : fileName(std::move(other.fileName)),
+        address(std::exchange(other.address, nullptr)),
+        fileSize(std::exchange(other.fileSize, 0)) {}
+
+  MemoryMappedFile& operator=(MemoryMappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      fileName = std::move(other.fileName);
+      address = std::exchange(other.address, nullptr);
+      fileSize = std::exchange(other.fileSize, 0);
+    }
+    return *this;
+  }
+
+  ~MemoryMappedFile() { close(); }
+
+ public:
+  inline void open(const std::string& newFileName) noexcept {
+    close();
+    fileName = newFileName;
+    const int fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+    Ensure(fileDescriptor >= 0, "cannot open file: " << fileName);
+    struct stat fileInfo;
+    Ensure(::fstat(fileDescriptor, &fileInfo) == 0,
+           "cannot read the size of file: " << fileName);
+    fileSize = fileInfo.st_size;
+    if (fileSize > 0) {
+      void* mapping = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED,
+                             fileDescriptor, 0);
+      Ensure(mapping != MAP_FAILED, "cannot map file: " << fileName);
+      address = static_cast<const char*>(mapping);
+    }
+    ::close(fileDescriptor);
+  }
+
+  inline void close() noexcept {
+    if (address) ::munmap(const_cast<char*>(address), fileSize);
+    address = nullptr;
+    fileSize = 0;
+  }
+
+  // Asks the OS to read the whole file ahead, e.g., to warm up the page cache
+  inline void prefetch() const noexcept {
+    if (address) ::madvise(const_cast<char*>(address), fileSize, MADV_WILLNEED);
+  }
+
+  inline bool isOpen() const noexcept { return address != nullptr; }
+
+  inline size_t size() const noexcept { return fileSize; }
+
+  inline const char* data() const noexcept { return address; }
+
+  inline const std::string& getFileName() const noexcept { return fileName; }
+
+  template <typename T>
+  inline const T& get(const size_t offset) const noexcept {
+    AssertMsg(offset + sizeof(T) <= fileSize,
+              "Offset " << offset << " is out of bounds!");
+    return *reinterpret_cast<const T*>(address + offset);
+  }
+
+  template <typename T>
+  inline std::span<const T> array(const size_t offset,
+                                  const size_t count) const noexcept {
+    Ensure(offset + (count * sizeof(T)) <= fileSize,
+           "Array at offset " << offset << " exceeds the size of file "
+                              << fileName << "!");
+    Ensure(offset % alignof(T) == 0,
+           "Array at offset " << offset << " is not aligned!");
+    return std::span<const T>(reinterpret_cast<const T*>(address + offset),
+                              count);
+  }
+
+ private:
+  std::string fileName;
+  const char* address;
+  size_t fileSize;
+};
+
+}  // namespace IO
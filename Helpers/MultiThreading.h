@@ -4,6 +4,7 @@
 #include <omp.h>
 #include <sched.h>
 
+#include <atomic>
 #include <cmath>
 #include <iomanip>
 #include <iostream>
@@ -151,6 +152,48 @@ inline size_t numberOfCores() noexcept {
   return std::thread::hardware_concurrency();
 }
 
+// Raises value to newValue (if it is smaller). Several threads may update the
+// same value concurrently, the result does not depend on their order. Returns
+// true if this call changed the value.
+template <typename T>
+inline bool atomicMax(T& value, const T newValue) noexcept {
+  std::atomic_ref<T> reference(value);
+  T current = reference.load(std::memory_order_relaxed);
+  while (current < newValue) {
+    if (reference.compare_exchange_weak(current, newValue,
+                                        std::memory_order_relaxed))
+      return true;
+  }
+  return false;
+}
+
+// Lowers value to newValue (if it is larger); the counterpart of atomicMax.
+template <typename T>
+inline bool atomicMin(T& value, const T newValue) noexcept {
+  std::atomic_ref<T> reference(value);
+  T current = reference.load(std::memory_order_relaxed);
+  while (newValue < current) {
+    if (reference.compare_exchange_weak(current, newValue,
+                                        std::memory_order_relaxed))
+      return true;
+  }
+  return false;
+}
+
+// Reads a value, which other threads may update with atomicMax or atomicMin
+template <typename T>
+inline T atomicLoad(T& value) noexcept {
+  return std::atomic_ref<T>(value).load(std::memory_order_relaxed);
+}
+
+// Adds increment to value and returns the previous value, e.g., to claim
+// slots of a shared array from several threads.
+template <typename T>
+inline T atomicFetchAdd(T& value, const T increment) noexcept {
+  return std::atomic_ref<T>(value).fetch_add(increment,
+                                             std::memory_order_relaxed);
+}
+
 class ThreadPinning {
  public:
   ThreadPinning(const size_t numberOfThreads, const size_t pinMultiplier)
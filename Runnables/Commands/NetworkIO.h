@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include <string>
 
+#include "../../Algorithms/PTL/Builder.h"
 #include "../../DataStructures/CSA/Data.h"
 #include "../../DataStructures/GTFS/Data.h"
 #include "../../DataStructures/Graph/Graph.h"
@@ -226,7 +227,7 @@ class TEToPTL : public ParameterizedCommand {
 
     if (inputFileLabels != "") {
       ptl.readViennotLabels(inputFileLabels);
-      ptl.sortLabels();
+      ptl.buildFlatLabels();
     }
 
     ptl.printInfo();
@@ -234,6 +235,56 @@ class TEToPTL : public ParameterizedCommand {
     ptl.serialize(outputFile);
   }
 };
+
+class BuildPTL : public ParameterizedCommand {
+ public:
+  BuildPTL(BasicShell &shell)
+      : ParameterizedCommand(shell, "buildPTL",
+                             "Computes the PTL hub labels of the TE data and "
+                             "writes the PTL data.") {
+    addParameter("Input file (TE Data)");
+    addParameter("Output file (PTL Data)");
+    addParameter("Number of threads", "max");
+    addParameter("Pin multiplier", "1");
+    addParameter("Max batch size", "256");
+  }
+
+  virtual void execute() noexcept {
+    const std::string inputFile = getParameter("Input file (TE Data)");
+    const std::string outputFile = getParameter("Output file (PTL Data)");
+    const int numberOfThreads = getNumberOfThreads();
+    const int pinMultiplier = getParameter<int>("Pin multiplier");
+    const size_t maxBatchSize = getParameter<size_t>("Max batch size");
+
+    TE::Data data = TE::Data(inputFile);
+    data.printInfo();
+
+    PTL::Data ptl(data);
+    PTL::Builder builder(ptl, numberOfThreads, pinMultiplier, maxBatchSize);
+    builder.run(ptl.teData.getOrderForAkiba());
+
+    std::cout << "Build time:           "
+              << String::msToString(builder.getBuildTime()) << std::endl;
+    std::cout << "Label entries:        "
+              << String::prettyInt(builder.getNumberOfLabelEntries())
+              << std::endl;
+    std::cout << "Label size:           "
+              << String::bytesToString(builder.getLabelByteSize())
+              << std::endl;
+    ptl.printInfo();
+
+    ptl.serialize(outputFile);
+  }
+
+ private:
+  inline int getNumberOfThreads() const noexcept {
+    if (getParameter("Number of threads") == "max") {
+      return numberOfCores();
+    } else {
+      return getParameter<int>("Number of threads");
+    }
+  }
+};
 class BuildMultimodalRAPTORData : public ParameterizedCommand {
  public:
   BuildMultimodalRAPTORData(BasicShell &shell)
@@ -32,9 +32,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <string>
 #include <vector>
 
+#include "../../Algorithms/CSA/BitPackedCSA.h"
 #include "../../Algorithms/CSA/CSA.h"
 #include "../../Algorithms/CSA/DijkstraCSA.h"
 #include "../../Algorithms/CSA/HLCSA.h"
+#include "../../Algorithms/CSA/MultiDepartureCSA.h"
 #include "../../Algorithms/CSA/ProfileCSA.h"
 #include "../../Algorithms/CSA/ULTRACSA.h"
 #include "../../Algorithms/PTL/Query.h"
@@ -54,9 +56,11 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../Algorithms/RAPTOR/ULTRAMcRAPTOR.h"
 #include "../../Algorithms/RAPTOR/ULTRARAPTOR.h"
 #include "../../Algorithms/TD/Query.h"
+#include "../../Algorithms/TD/RadixQuery.h"
 #include "../../Algorithms/TE/Query.h"
 #include "../../Algorithms/TripBased/BoundedMcQuery/BoundedMcQuery.h"
 #include "../../Algorithms/TripBased/Query/McQuery.h"
+#include "../../Algorithms/TripBased/Query/MultiDepartureProfileQuery.h"
 #include "../../Algorithms/TripBased/Query/ProfileOneToAllQuery.h"
 #include "../../Algorithms/TripBased/Query/ProfileQuery.h"
 #include "../../Algorithms/TripBased/Query/Query.h"
@@ -83,17 +87,28 @@ class RunTransitiveRAPTORQueries : public ParameterizedCommand {
     addParameter("RAPTOR input file");
     addParameter("Number of queries");
     addParameter("Number of rounds", "32");
+    addParameter("Stop-major routes", "false");
   }
 
   virtual void execute() noexcept {
+    if (getParameter<bool>("Stop-major routes")) {
+      run<RAPTOR::RAPTOR<true, RAPTOR::AggregateProfiler, true, false, false,
+                         true>>();
+    } else {
+      run<RAPTOR::RAPTOR<true, RAPTOR::AggregateProfiler, true, false>>();
+    }
+  }
+
+ private:
+  template <typename ALGORITHM>
+  inline void run() noexcept {
     const int maxRounds = getParameter<int>("Number of rounds");
 
     RAPTOR::Data raptorData =
         RAPTOR::Data::FromBinary(getParameter("RAPTOR input file"));
     raptorData.useImplicitDepartureBufferTimes();
     raptorData.printInfo();
-    RAPTOR::RAPTOR<true, RAPTOR::AggregateProfiler, true, false> algorithm(
-        raptorData);
+    ALGORITHM algorithm(raptorData);
 
     const size_t n = getParameter<size_t>("Number of queries");
     const std::vector<StopQuery> queries =
@@ -751,13 +766,24 @@ class RunTransitiveCSAQueries : public ParameterizedCommand {
     addParameter("CSA input file");
     addParameter("Number of queries");
     addParameter("Target pruning?");
+    addParameter("Bit-packed connection scan", "false");
   }
 
   virtual void execute() noexcept {
+    if (getParameter<bool>("Bit-packed connection scan")) {
+      run<CSA::BitPackedCSA<true, CSA::AggregateProfiler>>();
+    } else {
+      run<CSA::CSA<true, CSA::AggregateProfiler>>();
+    }
+  }
+
+ private:
+  template <typename ALGORITHM>
+  inline void run() noexcept {
     CSA::Data csaData = CSA::Data::FromBinary(getParameter("CSA input file"));
     csaData.sortConnectionsAscending();
     csaData.printInfo();
-    CSA::CSA<true, CSA::AggregateProfiler> algorithm(csaData);
+    ALGORITHM algorithm(csaData);
 
     const size_t n = getParameter<size_t>("Number of queries");
     const std::vector<StopQuery> queries =
@@ -804,6 +830,65 @@ class RunTransitiveProfileCSAQueries : public ParameterizedCommand {
   }
 };
 
+class RunMultiDepartureCSAQueries : public ParameterizedCommand {
+ public:
+  RunMultiDepartureCSAQueries(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "runMultiDepartureCSAQueries",
+            "Runs the given number of random one-to-all CSA queries, each for "
+            "all departure times every interval seconds within the time "
+            "window.") {
+    addParameter("CSA input file");
+    addParameter("Number of queries");
+    addParameter("Departure interval", "300");
+    addParameter("Time window", "10800");
+    addParameter("Verify with CSA", "false");
+  }
+
+  virtual void execute() noexcept {
+    CSA::Data csaData = CSA::Data::FromBinary(getParameter("CSA input file"));
+    csaData.sortConnectionsAscending();
+    csaData.printInfo();
+    CSA::MultiDepartureCSA<CSA::AggregateProfiler> algorithm(csaData);
+    CSA::CSA<false, CSA::AggregateProfiler> csa(csaData);
+
+    const size_t n = getParameter<size_t>("Number of queries");
+    const int interval = getParameter<int>("Departure interval");
+    const int window = getParameter<int>("Time window");
+    const bool verify = getParameter<bool>("Verify with CSA");
+    const std::vector<StopQuery> queries =
+        generateRandomStopQueries(csaData.numberOfStops(), n);
+
+    size_t numberOfDepartureTimes = 0;
+    size_t numberOfMismatches = 0;
+    for (const StopQuery &query : queries) {
+      algorithm.run(query.source, query.departureTime,
+                    query.departureTime + window, interval);
+      numberOfDepartureTimes += algorithm.numberOfDepartureTimes();
+      if (!verify) continue;
+      for (size_t i = 0; i < algorithm.numberOfDepartureTimes(); i++) {
+        csa.run(query.source, algorithm.getDepartureTimes()[i]);
+        for (const StopId stop : csaData.stops()) {
+          if (csa.getEarliestArrivalTime(stop) !=
+              algorithm.getEarliestArrivalTime(stop, i)) {
+            numberOfMismatches++;
+          }
+        }
+      }
+    }
+    algorithm.getProfiler().printStatistics();
+    std::cout << "Avg. departure times: "
+              << String::prettyDouble(numberOfDepartureTimes / double(n))
+              << std::endl;
+    if (verify) {
+      std::cout << "CSA for each departure time:" << std::endl;
+      csa.getProfiler().printStatistics();
+      std::cout << "Mismatching arrival times: "
+                << String::prettyInt(numberOfMismatches) << std::endl;
+    }
+  }
+};
+
 class RunDijkstraCSAQueries : public ParameterizedCommand {
  public:
   RunDijkstraCSAQueries(BasicShell &shell)
@@ -1001,6 +1086,73 @@ class RunTransitiveProfileTripBasedQueries : public ParameterizedCommand {
   }
 };
 
+class RunMultiDepartureProfileTripBasedQueries : public ParameterizedCommand {
+ public:
+  RunMultiDepartureProfileTripBasedQueries(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "runMultiDepartureProfileTripBasedQueries",
+            "Runs the given number of random transitive TripBased profile "
+            "queries with a time range of [0, 24 hours), once with the "
+            "ProfileQuery and once with 16 departure times per search.") {
+    addParameter("Trip-Based input file");
+    addParameter("Number of queries");
+    addParameter("Verify with transitive queries", "false");
+  }
+
+  virtual void execute() noexcept {
+    TripBased::Data tripBasedData(getParameter("Trip-Based input file"));
+    tripBasedData.printInfo();
+    TripBased::ProfileQuery<TripBased::AggregateProfiler> profileQuery(
+        tripBasedData);
+    TripBased::MultiDepartureProfileQuery<TripBased::AggregateProfiler>
+        algorithm(tripBasedData);
+    TripBased::TransitiveQuery<TripBased::NoProfiler> transitiveQuery(
+        tripBasedData);
+    const bool verify = getParameter<bool>("Verify with transitive queries");
+
+    const size_t n = getParameter<size_t>("Number of queries");
+    const std::vector<StopQuery> queries =
+        generateRandomStopQueries(tripBasedData.numberOfStops(), n);
+
+    double numJourneys = 0;
+    for (const StopQuery &query : queries) {
+      profileQuery.run(query.source, query.target, 0, 24 * 60 * 60 - 1);
+      numJourneys += profileQuery.getAllJourneys().size();
+    }
+    std::cout << "ProfileQuery:" << std::endl;
+    profileQuery.getProfiler().printStatistics();
+    std::cout << "Avg. journeys: " << String::prettyDouble(numJourneys / n)
+              << std::endl;
+
+    double numEntries = 0;
+    size_t mismatches = 0;
+    for (const StopQuery &query : queries) {
+      algorithm.run(query.source, query.target, 0, 24 * 60 * 60 - 1);
+      numEntries += algorithm.getProfile().size();
+      if (!verify) continue;
+      const std::vector<int> &departureTimes = algorithm.getDepartureTimes();
+      for (size_t i = 0; i < departureTimes.size(); i++) {
+        transitiveQuery.run(query.source, departureTimes[i], query.target);
+        std::vector<RAPTOR::ArrivalLabel> expected;
+        for (const RAPTOR::ArrivalLabel &label :
+             transitiveQuery.getArrivals()) {
+          if (label.numberOfTrips >= algorithm.MaxRounds) break;
+          expected.emplace_back(label);
+        }
+        mismatches += (expected != algorithm.getArrivals()[i]);
+      }
+    }
+    std::cout << "MultiDepartureProfileQuery:" << std::endl;
+    algorithm.getProfiler().printStatistics();
+    std::cout << "Avg. profile entries: "
+              << String::prettyDouble(numEntries / n) << std::endl;
+    if (verify) {
+      std::cout << "Departure times with different arrivals: " << mismatches
+                << std::endl;
+    }
+  }
+};
+
 class RunTransitiveProfileOneToAllTripBasedQueries
     : public ParameterizedCommand {
  public:
@@ -1468,16 +1620,36 @@ class RunTDDijkstraQueries : public ParameterizedCommand {
     TD::Data data = TD::Data::FromBinary(getParameter("TD input file"));
     data.printInfo();
     TD::EADijkstra<TimeDependentRouteGraph, TD::AggregateProfiler> algorithm(
-        data.timeDependentGraph, DurationFunction);
+        data);
+    TD::RadixEADijkstra<TimeDependentRouteGraph, TD::AggregateProfiler>
+        radixAlgorithm(data);
 
     const size_t n = getParameter<size_t>("Number of queries");
     const std::vector<StopQuery> queries =
         generateRandomStopQueries(data.numberOfStops(), n);
 
+    std::vector<int> arrivalTimes;
+    arrivalTimes.reserve(n);
     for (const StopQuery &query : queries) {
       algorithm.run(query.source, query.departureTime, query.target);
+      arrivalTimes.emplace_back(algorithm.getDistance(query.target));
     }
+    std::cout << "Binary heap:" << std::endl;
     algorithm.getProfiler().printStatistics();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const StopQuery &query = queries[i];
+      radixAlgorithm.run(query.source, query.departureTime, query.target);
+      mismatches +=
+          (radixAlgorithm.getDistance(query.target) != arrivalTimes[i]);
+    }
+    std::cout << "Radix heap:" << std::endl;
+    radixAlgorithm.getProfiler().printStatistics();
+    if (mismatches > 0) {
+      std::cout << "Arrival times differ in " << mismatches << " queries!"
+                << std::endl;
+    }
   }
 };
 
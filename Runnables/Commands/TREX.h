@@ -34,6 +34,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../Algorithms/TREX/BorderStops.h"
 #include "../../Algorithms/TREX/Preprocessing/BuilderIBEs.h"
 #include "../../Algorithms/TREX/Preprocessing/TBTEGraph.h"
+#include "../../Algorithms/TREX/Preprocessing/TopoBFS.h"
+#include "../../Algorithms/TREX/Query/ParallelTREXQuery.h"
+#include "../../Algorithms/TREX/Query/TREXMatrixQuery.h"
 #include "../../Algorithms/TREX/Query/TREXProfileQuery.h"
 #include "../../Algorithms/TREX/Query/TREXQuery.h"
 #include "../../Algorithms/TripBased/Preprocessing/StopEventGraphBuilder.h"
@@ -44,11 +47,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "../../DataStructures/Graph/Utils/IO.h"
 #include "../../DataStructures/Queries/Queries.h"
 #include "../../DataStructures/RAPTOR/Data.h"
+#include "../../DataStructures/TREX/MappedTREXData.h"
 #include "../../DataStructures/TREX/TREXData.h"
 #include "../../DataStructures/TripBased/Data.h"
 #include "../../Helpers/Console/Progress.h"
 #include "../../Helpers/MultiThreading.h"
 #include "../../Helpers/String/String.h"
+#include "../../Helpers/Timer.h"
 #include "../../Shell/Shell.h"
 
 using namespace Shell;
@@ -63,6 +68,7 @@ class ApplyPartitionFile : public ParameterizedCommand {
     addParameter("Input file (Partition File)");
     addParameter("Input file (Number of levels)");
     addParameter("Input file (TREX Data)");
+    addParameter("Number of cells per level", "2");
   }
 
   virtual void execute() noexcept {
@@ -71,9 +77,11 @@ class ApplyPartitionFile : public ParameterizedCommand {
         getParameter<int>("Input file (Number of levels)");
     const std::string partitionFile =
         getParameter("Input file (Partition File)");
+    const int numberOfCellsPerLevel =
+        getParameter<int>("Number of cells per level");
 
     TripBased::TREXData data(raptorFile);
-    data.setNumberOfLevels(numberOfLevels);
+    data.setHierarchy(numberOfLevels, numberOfCellsPerLevel);
     data.printInfo();
 
     data.createCompactLayoutGraph();
@@ -91,6 +99,7 @@ class RAPTORToTREX : public ParameterizedCommand {
     addParameter("Input file (RAPTOR Data)");
     addParameter("Output file (TREX Data)");
     addParameter("Number of levels");
+    addParameter("Number of cells per level", "2");
     addParameter("Route-based pruning?", "true");
     addParameter("Number of threads", "max");
     addParameter("Pin multiplier", "1");
@@ -100,6 +109,7 @@ class RAPTORToTREX : public ParameterizedCommand {
     const std::string raptorFile = getParameter("Input file (RAPTOR Data)");
     const std::string mltbFile = getParameter("Output file (TREX Data)");
     const int numLevels = getParameter<int>("Number of levels");
+    const int numCellsPerLevel = getParameter<int>("Number of cells per level");
     const bool routeBasedPruning = getParameter<bool>("Route-based pruning?");
     const int numberOfThreads = getNumberOfThreads();
     const int pinMultiplier = getParameter<int>("Pin multiplier");
@@ -107,8 +117,9 @@ class RAPTORToTREX : public ParameterizedCommand {
     RAPTOR::Data raptor(raptorFile);
     /* raptor.normalizeInstantaneousTravel(); */
 
-    TripBased::TREXData data(raptor, numLevels);
+    TripBased::TREXData data(raptor, numLevels, numCellsPerLevel);
 
+    Timer timer;
     if (numberOfThreads == 0) {
       if (routeBasedPruning) {
         TripBased::ComputeStopEventGraphRouteBased(data);
@@ -123,6 +134,8 @@ class RAPTORToTREX : public ParameterizedCommand {
         TripBased::ComputeStopEventGraph(data, numberOfThreads, pinMultiplier);
       }
     }
+    std::cout << "Stop event graph computed in "
+              << String::msToString(timer.elapsedMilliseconds()) << std::endl;
 
     data.addInformationToStopEventGraph();
     /* data.convertStopEventGraphToDynamicEventGraph(); */
@@ -236,6 +249,240 @@ class Customization : public ParameterizedCommand {
   }
 };
 
+class IncrementalCustomization : public ParameterizedCommand {
+ public:
+  IncrementalCustomization(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "incrementalCustomization",
+            "Updates the customization of TREX after a new partition and/or "
+            "changed trips. Only the IBEs leading into affected cells are "
+            "searched again. The changed trips file contains one trip id per "
+            "line.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Output file (TREX Data)");
+    addParameter("Input file (Partition File)", "");
+    addParameter("Input file (Changed Trips)", "");
+    addParameter("Number of threads", "max");
+    addParameter("Pin multiplier", "1");
+    addParameter("Verify?", "false");
+  }
+
+  virtual void execute() noexcept {
+    const std::string mltbFile = getParameter("Input file (TREX Data)");
+    const std::string output = getParameter("Output file (TREX Data)");
+    const std::string partitionFile =
+        getParameter("Input file (Partition File)");
+    const std::string changedTripsFile =
+        getParameter("Input file (Changed Trips)");
+    const int numberOfThreads = getNumberOfThreads();
+    const int pinMultiplier = getParameter<int>("Pin multiplier");
+    const bool verify = getParameter<bool>("Verify?");
+
+    TripBased::TREXData data(mltbFile);
+    data.printInfo();
+
+    const std::vector<uint32_t> oldCellIds = data.cellIds;
+    if (partitionFile != "") data.readPartitionFile(partitionFile);
+
+    std::vector<TripId> changedTrips;
+    if (changedTripsFile != "") {
+      std::ifstream file(changedTripsFile);
+      size_t trip;
+      while (file >> trip) changedTrips.emplace_back(TripId(trip));
+      std::cout << "Read " << String::prettyInt(changedTrips.size())
+                << " changed trips!" << std::endl;
+    }
+
+    Timer timer;
+    {
+      TripBased::Builder builder(data, numberOfThreads, pinMultiplier);
+      builder.runIncremental(oldCellIds, changedTrips);
+    }
+    const double incrementalTime = timer.elapsedMilliseconds();
+    std::cout << "Incremental customization: "
+              << String::msToString(incrementalTime) << std::endl;
+    data.serialize(output);
+
+    if (!verify) return;
+
+    const std::vector<uint8_t> incrementalLevels =
+        data.stopEventGraph.get(LocalLevel);
+    data.addInformationToStopEventGraph();
+    timer.restart();
+    {
+      TripBased::Builder builder(data, numberOfThreads, pinMultiplier);
+      builder.run<true, false>();
+    }
+    const double fullTime = timer.elapsedMilliseconds();
+    std::cout << "Full customization:        " << String::msToString(fullTime)
+              << std::endl;
+    std::cout << "Same levels: "
+              << (incrementalLevels == data.stopEventGraph.get(LocalLevel)
+                      ? "yes"
+                      : "NO")
+              << std::endl;
+  }
+
+ private:
+  inline int getNumberOfThreads() const noexcept {
+    if (getParameter("Number of threads") == "max") {
+      return numberOfCores();
+    } else {
+      return getParameter<int>("Number of threads");
+    }
+  }
+};
+
+class BenchmarkCustomization : public ParameterizedCommand {
+ public:
+  BenchmarkCustomization(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "benchmarkCustomization",
+            "Runs the TREX customization with every given number of threads "
+            "and reports the wall time per level and the speedup over the "
+            "first run. Also checks that all runs compute the same levels.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Numbers of threads", "1,2,4,8,16");
+    addParameter("Pin multiplier", "1");
+  }
+
+  virtual void execute() noexcept {
+    const int pinMultiplier = getParameter<int>("Pin multiplier");
+    std::vector<int> threadCounts;
+    for (const std::string &token :
+         String::split(getParameter("Numbers of threads"), ',')) {
+      threadCounts.emplace_back(String::lexicalCast<int>(token));
+    }
+
+    TripBased::TREXData data(getParameter("Input file (TREX Data)"));
+    data.printInfo();
+
+    std::vector<uint8_t> firstLevels;
+    double firstTime = 0;
+    for (const int numberOfThreads : threadCounts) {
+      data.addInformationToStopEventGraph();
+      TripBased::Builder builder(data, numberOfThreads, pinMultiplier);
+
+      Timer timer;
+      builder.run<true, false>();
+      const double time = timer.elapsedMilliseconds();
+
+      const std::vector<uint8_t> &levels = data.stopEventGraph.get(LocalLevel);
+      if (firstLevels.empty()) {
+        firstLevels = levels;
+        firstTime = time;
+      }
+
+      std::cout << "Threads: " << std::setw(3) << numberOfThreads
+                << " | Total: " << std::setw(10) << String::msToString(time)
+                << " | Speedup: " << std::setw(6)
+                << String::prettyDouble(firstTime / time) << " | Levels:";
+      for (const double levelTime : builder.getLevelTimes()) {
+        std::cout << " " << String::msToString(levelTime);
+      }
+      std::cout << " | Same levels: " << (levels == firstLevels ? "yes" : "NO")
+                << std::endl;
+    }
+  }
+};
+
+class CompareTopoBFS : public ParameterizedCommand {
+ public:
+  CompareTopoBFS(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "compareTopoBFS",
+            "Runs the TREX customization with the TransferSearch and with the "
+            "bit-parallel TopoBFS on the TBTE graph. Compares runtime and the "
+            "computed levels, and validates the TopoBFS levels with random "
+            "queries against TB.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Number of threads", "1");
+    addParameter("Pin multiplier", "1");
+    addParameter("Number of queries", "1000");
+  }
+
+  virtual void execute() noexcept {
+    const int numberOfThreads = getParameter<int>("Number of threads");
+    const int pinMultiplier = getParameter<int>("Pin multiplier");
+
+    TripBased::TREXData data(getParameter("Input file (TREX Data)"));
+    data.printInfo();
+
+    data.addInformationToStopEventGraph();
+    Timer timer;
+    {
+      TripBased::Builder builder(data, numberOfThreads, pinMultiplier);
+      builder.run<true, false>();
+    }
+    const double builderTime = timer.elapsedMilliseconds();
+    const std::vector<uint8_t> builderLevels =
+        data.stopEventGraph.get(LocalLevel);
+
+    data.addInformationToStopEventGraph();
+    timer.restart();
+    TripBased::TopoBFSBuilder topoBuilder(data, numberOfThreads,
+                                          pinMultiplier);
+    const double graphTime = timer.elapsedMilliseconds();
+    topoBuilder.run();
+    const double topoTime = timer.elapsedMilliseconds();
+    const std::vector<uint8_t> &topoLevels =
+        data.stopEventGraph.get(LocalLevel);
+
+    std::cout << "TransferSearch: " << String::msToString(builderTime)
+              << std::endl;
+    std::cout << "TopoBFS:        " << String::msToString(topoTime)
+              << " (TBTE graph: " << String::msToString(graphTime) << ")"
+              << std::endl;
+
+    std::vector<size_t> builderCount(data.getNumberOfLevels() + 1, 0);
+    std::vector<size_t> topoCount(data.getNumberOfLevels() + 1, 0);
+    size_t equal = 0, higher = 0, lower = 0;
+    for (size_t i = 0; i < topoLevels.size(); ++i) {
+      ++builderCount[builderLevels[i]];
+      ++topoCount[topoLevels[i]];
+      equal += (topoLevels[i] == builderLevels[i]);
+      higher += (topoLevels[i] > builderLevels[i]);
+      lower += (topoLevels[i] < builderLevels[i]);
+    }
+    for (size_t level = 0; level < builderCount.size(); ++level) {
+      std::cout << "Level " << level << ": " << std::setw(12)
+                << String::prettyInt(builderCount[level]) << " vs "
+                << std::setw(12) << String::prettyInt(topoCount[level])
+                << std::endl;
+    }
+    std::cout << "Transfers with equal level:  " << String::prettyInt(equal)
+              << std::endl;
+    std::cout << "Transfers with higher level: " << String::prettyInt(higher)
+              << std::endl;
+    std::cout << "Transfers with lower level:  " << String::prettyInt(lower)
+              << std::endl;
+
+    const size_t n = getParameter<size_t>("Number of queries");
+    const std::vector<StopQuery> queries =
+        generateRandomStopQueries(data.numberOfStops(), n);
+    TripBased::TREXQuery<TripBased::NoProfiler> trexQuery(data);
+    TripBased::TransitiveQuery<TripBased::NoProfiler> tbQuery(data);
+
+    size_t wrong = 0;
+    for (const StopQuery &query : queries) {
+      trexQuery.run(query.source, query.departureTime, query.target);
+      tbQuery.run(query.source, query.departureTime, query.target);
+      const std::vector<RAPTOR::ArrivalLabel> trexArrivals =
+          trexQuery.getArrivals();
+      const std::vector<RAPTOR::ArrivalLabel> tbArrivals =
+          tbQuery.getArrivals();
+      bool same = (trexArrivals.size() == tbArrivals.size());
+      for (size_t i = 0; same && i < trexArrivals.size(); ++i) {
+        same = (trexArrivals[i].arrivalTime == tbArrivals[i].arrivalTime) &&
+               (trexArrivals[i].numberOfTrips == tbArrivals[i].numberOfTrips);
+      }
+      wrong += !same;
+    }
+    std::cout << "Queries with wrong result: " << wrong << " of " << n
+              << std::endl;
+  }
+};
+
 class ShowInfoOfTREX : public ParameterizedCommand {
  public:
   ShowInfoOfTREX(BasicShell &shell)
@@ -286,6 +533,36 @@ class ShowInfoOfTREX : public ParameterizedCommand {
   }
 };
 
+class WriteMappedTREX : public ParameterizedCommand {
+ public:
+  WriteMappedTREX(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "writeMappedTREX",
+            "Writes the TREX data (including the query tables) into a single "
+            "file, which queries can memory map instead of deserializing it.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Output file (mapped TREX Data)");
+  }
+
+  virtual void execute() noexcept {
+    const std::string outputFile =
+        getParameter("Output file (mapped TREX Data)");
+
+    Timer timer;
+    TripBased::TREXData data(getParameter("Input file (TREX Data)"));
+    std::cout << "Deserialized TREX data in "
+              << String::msToString(timer.elapsedMilliseconds()) << std::endl;
+
+    TripBased::MappedTREXData::write(data, outputFile);
+
+    timer.restart();
+    TripBased::MappedTREXData mappedData(outputFile);
+    std::cout << "Mapped TREX data in "
+              << String::musToString(timer.elapsedMicroseconds()) << std::endl;
+    mappedData.printInfo();
+  }
+};
+
 class RunTREXQuery : public ParameterizedCommand {
  public:
   RunTREXQuery(BasicShell &shell)
@@ -440,6 +717,274 @@ class RunTREXQuery : public ParameterizedCommand {
   }
 };
 
+class RunParallelTREXQueries : public ParameterizedCommand {
+ public:
+  RunParallelTREXQueries(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "runParallelTREXQueries",
+            "Runs a batch of TREX queries on several threads, which share the "
+            "query tables. Reports throughput and latency percentiles. The "
+            "query file contains one query per line (source target "
+            "departureTime), use 'random' for random queries. Memory mapped "
+            "input files are written by writeMappedTREX.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Query file", "random");
+    addParameter("Number of queries", "10000");
+    addParameter("Number of threads", "max");
+    addParameter("Pin multiplier", "1");
+    addParameter("Memory mapped", "false");
+    addParameter("Compact edge layout", "false");
+  }
+
+  virtual void execute() noexcept {
+    const std::string tripFile = getParameter("Input file (TREX Data)");
+
+    Timer timer;
+    if (getParameter<bool>("Memory mapped")) {
+      TripBased::MappedTREXData data(tripFile);
+      std::cout << "Loaded data in "
+                << String::musToString(timer.elapsedMicroseconds())
+                << std::endl;
+      data.printInfo();
+      run(data);
+    } else {
+      TripBased::TREXData data(tripFile);
+      std::cout << "Loaded data in "
+                << String::musToString(timer.elapsedMicroseconds())
+                << std::endl;
+      data.printInfo();
+      run(data);
+    }
+  }
+
+ private:
+  template <typename DATA>
+  inline void run(const DATA &data) const noexcept {
+    const std::string queryFile = getParameter("Query file");
+    const std::vector<StopQuery> queries =
+        (queryFile == "random")
+            ? generateRandomStopQueries(
+                  data.numberOfStops(),
+                  getParameter<size_t>("Number of queries"))
+            : readStopQueries(queryFile, data.numberOfStops());
+
+    if (queries.empty()) {
+      std::cout << "No queries to run!" << std::endl;
+      return;
+    }
+
+    if (getParameter<bool>("Compact edge layout")) {
+      run<TripBased::CompactEdgeLayout>(data, queries);
+    } else {
+      run<TripBased::PaddedEdgeLayout>(data, queries);
+    }
+  }
+
+  template <typename EDGE_LAYOUT, typename DATA>
+  inline void run(const DATA &data,
+                  const std::vector<StopQuery> &queries) const noexcept {
+    TripBased::ParallelTREXQuery<DATA, EDGE_LAYOUT> algorithm(
+        data, getNumberOfThreads(), getParameter<int>("Pin multiplier"));
+    algorithm.run(queries);
+    algorithm.printStatistics();
+  }
+
+  inline int getNumberOfThreads() const noexcept {
+    if (getParameter("Number of threads") == "max") {
+      return numberOfCores();
+    } else {
+      return getParameter<int>("Number of threads");
+    }
+  }
+};
+
+class CompareTREXEdgeLayouts : public ParameterizedCommand {
+ public:
+  CompareTREXEdgeLayouts(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "compareTREXEdgeLayouts",
+            "Runs the same random TREX queries with the padded and with the "
+            "compact (8 byte) edge labels. Reports the query times, the size "
+            "of the edge labels and checks that both compute the same "
+            "arrivals.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Number of queries", "10000");
+  }
+
+  virtual void execute() noexcept {
+    TripBased::TREXData data(getParameter("Input file (TREX Data)"));
+    data.printInfo();
+
+    const size_t n = getParameter<size_t>("Number of queries");
+    const std::vector<StopQuery> queries =
+        generateRandomStopQueries(data.numberOfStops(), n);
+
+    std::vector<std::vector<RAPTOR::ArrivalLabel>> paddedArrivals;
+    const double paddedTime =
+        run<TripBased::PaddedEdgeLayout>(data, queries, paddedArrivals);
+    std::vector<std::vector<RAPTOR::ArrivalLabel>> compactArrivals;
+    const double compactTime =
+        run<TripBased::CompactEdgeLayout>(data, queries, compactArrivals);
+
+    size_t wrong = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+      bool same = (paddedArrivals[i].size() == compactArrivals[i].size());
+      for (size_t j = 0; same && j < paddedArrivals[i].size(); ++j) {
+        same = (paddedArrivals[i][j].arrivalTime ==
+                compactArrivals[i][j].arrivalTime) &&
+               (paddedArrivals[i][j].numberOfTrips ==
+                compactArrivals[i][j].numberOfTrips);
+      }
+      wrong += !same;
+    }
+
+    std::cout << "Padded layout:  "
+              << String::bytesToString(Vector::byteSize(
+                     data.queryTables.edgeLabels))
+              << ", " << String::musToString(paddedTime / n) << " per query"
+              << std::endl;
+    std::cout << "Compact layout: "
+              << String::bytesToString(Vector::byteSize(
+                     data.queryTables.compactEdgeLabels))
+              << ", " << String::musToString(compactTime / n) << " per query"
+              << std::endl;
+    std::cout << "Speedup: " << String::prettyDouble(paddedTime / compactTime)
+              << std::endl;
+    std::cout << "Queries with different result: " << wrong << " of " << n
+              << std::endl;
+  }
+
+ private:
+  // returns the total time in microseconds
+  template <typename EDGE_LAYOUT>
+  inline double run(
+      const TripBased::TREXData &data, const std::vector<StopQuery> &queries,
+      std::vector<std::vector<RAPTOR::ArrivalLabel>> &arrivals) const noexcept {
+    TripBased::TREXQuery<TripBased::NoProfiler, TripBased::TREXData,
+                         EDGE_LAYOUT>
+        algorithm(data);
+    arrivals.resize(queries.size());
+    double time = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+      Timer timer;
+      algorithm.run(queries[i].source, queries[i].departureTime,
+                    queries[i].target);
+      time += timer.elapsedMicroseconds();
+      arrivals[i] = algorithm.getArrivals();
+    }
+    return time;
+  }
+};
+
+class RunTREXMatrixQueries : public ParameterizedCommand {
+ public:
+  RunTREXMatrixQueries(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "runTREXMatrixQueries",
+            "Computes the travel time matrix between random origin and "
+            "destination stops with one-to-many TREX queries on several "
+            "threads. Compares the throughput (and the results) against "
+            "point-to-point TREX queries for some of the pairs. The matrix is "
+            "written in binary form if an output file is given.") {
+    addParameter("Input file (TREX Data)");
+    addParameter("Number of origins", "100");
+    addParameter("Number of destinations", "1000");
+    addParameter("Departure time (seconds)", "28800");
+    addParameter("Output file (Matrix)", "");
+    addParameter("Number of threads", "max");
+    addParameter("Pin multiplier", "1");
+    addParameter("Number of point-to-point queries", "1000");
+  }
+
+  virtual void execute() noexcept {
+    TripBased::TREXData data(getParameter("Input file (TREX Data)"));
+    data.printInfo();
+
+    const int departureTime = getParameter<int>("Departure time (seconds)");
+    const std::vector<StopId> origins =
+        randomStops(data, getParameter<size_t>("Number of origins"), 42);
+    const std::vector<StopId> destinations =
+        randomStops(data, getParameter<size_t>("Number of destinations"), 43);
+    const size_t numberOfPairs = origins.size() * destinations.size();
+
+    TripBased::TREXMatrixQuery<TripBased::TREXData> matrixQuery(
+        data, getNumberOfThreads(), getParameter<int>("Pin multiplier"));
+    matrixQuery.run(origins, destinations, departureTime);
+    const double matrixTime = matrixQuery.getTotalTime();
+
+    size_t reachable = 0;
+    for (const int32_t travelTime : matrixQuery.getMatrix()) {
+      reachable += (travelTime != matrixQuery.Unreachable);
+    }
+    std::cout << "Matrix: " << origins.size() << " x " << destinations.size()
+              << ", " << String::prettyInt(reachable) << " reachable pairs"
+              << std::endl;
+    std::cout << "Wall time: " << String::musToString(matrixTime) << std::endl;
+    std::cout << "Throughput: "
+              << String::prettyDouble(numberOfPairs / (matrixTime / 1000000.0))
+              << " pairs/s" << std::endl;
+
+    const std::string outputFile = getParameter("Output file (Matrix)");
+    if (outputFile != "") matrixQuery.writeBinary(outputFile);
+
+    // point-to-point queries on a single thread for a sample of the pairs
+    const size_t numberOfSamples = std::min(
+        numberOfPairs, getParameter<size_t>("Number of point-to-point queries"));
+    if (numberOfSamples == 0) return;
+    TripBased::TREXQuery<TripBased::NoProfiler> trexQuery(data);
+    std::mt19937 randomGenerator(44);
+    std::uniform_int_distribution<size_t> pairDistribution(0,
+                                                           numberOfPairs - 1);
+    size_t wrong = 0;
+    double pointToPointTime = 0;
+    for (size_t k = 0; k < numberOfSamples; ++k) {
+      const size_t pair = pairDistribution(randomGenerator);
+      const size_t i = pair / destinations.size();
+      const size_t j = pair % destinations.size();
+      Timer timer;
+      trexQuery.run(origins[i], departureTime, destinations[j]);
+      pointToPointTime += timer.elapsedMicroseconds();
+      const int arrivalTime = trexQuery.getEarliestArrivalTime();
+      const int32_t expected = (arrivalTime >= INFTY)
+                                   ? matrixQuery.Unreachable
+                                   : arrivalTime - departureTime;
+      wrong += (matrixQuery.travelTime(i, j) != expected);
+    }
+    const double singleThreadMatrixTime =
+        matrixTime * getNumberOfThreads() / numberOfPairs;
+    std::cout << "Point-to-point: "
+              << String::musToString(pointToPointTime / numberOfSamples)
+              << " per pair, matrix (per thread): "
+              << String::musToString(singleThreadMatrixTime) << " per pair"
+              << std::endl;
+    std::cout << "Pairs with different result: " << wrong << " of "
+              << numberOfSamples << std::endl;
+  }
+
+ private:
+  inline std::vector<StopId> randomStops(const TripBased::TREXData &data,
+                                         const size_t n,
+                                         const int seed) const noexcept {
+    std::mt19937 randomGenerator(seed);
+    std::uniform_int_distribution<> stopDistribution(0,
+                                                     data.numberOfStops() - 1);
+    std::vector<StopId> stops;
+    stops.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      stops.emplace_back(StopId(stopDistribution(randomGenerator)));
+    }
+    return stops;
+  }
+
+  inline int getNumberOfThreads() const noexcept {
+    if (getParameter("Number of threads") == "max") {
+      return numberOfCores();
+    } else {
+      return getParameter<int>("Number of threads");
+    }
+  }
+};
+
 class RunTREXProfileQueries : public ParameterizedCommand {
  public:
   RunTREXProfileQueries(BasicShell &shell)
@@ -471,6 +1016,80 @@ class RunTREXProfileQueries : public ParameterizedCommand {
   }
 };
 
+class RunTREXRangeQueries : public ParameterizedCommand {
+ public:
+  RunTREXRangeQueries(BasicShell &shell)
+      : ParameterizedCommand(
+            shell, "runTREXRangeQueries",
+            "Runs random TREX range queries, which report the Pareto optimal "
+            "journeys departing within the given time window. Compares them "
+            "to running one TREX query per departure time within the window.") {
+    addParameter("TREX input file");
+    addParameter("Number of queries");
+    addParameter("Window start (seconds)", "28800");
+    addParameter("Window length (seconds)", "7200");
+  }
+
+  virtual void execute() noexcept {
+    TripBased::TREXData data(getParameter("TREX input file"));
+    data.printInfo();
+    TripBased::TREXProfileQuery<TripBased::AggregateProfiler> rangeQuery(data);
+    TripBased::TREXQuery<TripBased::NoProfiler> trexQuery(data);
+
+    const size_t n = getParameter<size_t>("Number of queries");
+    const int windowStart = getParameter<int>("Window start (seconds)");
+    const int windowEnd =
+        windowStart + getParameter<int>("Window length (seconds)");
+    const std::vector<StopQuery> queries =
+        generateRandomStopQueries(data.numberOfStops(), n);
+
+    double rangeTime = 0;
+    double rangeJourneys = 0;
+    double singleTime = 0;
+    double singleJourneys = 0;
+    double numberOfDepartures = 0;
+    std::vector<int> departureTimes;
+    for (const StopQuery &query : queries) {
+      Timer timer;
+      rangeQuery.run(query.source, query.target, windowStart, windowEnd);
+      const std::vector<RAPTOR::Journey> journeys =
+          rangeQuery.getParetoJourneys();
+      rangeTime += timer.elapsedMicroseconds();
+      rangeJourneys += journeys.size();
+
+      departureTimes.clear();
+      for (const auto &departure : rangeQuery.getCollectedDepTimes()) {
+        departureTimes.emplace_back(departure.depTime);
+      }
+      std::sort(departureTimes.begin(), departureTimes.end());
+      departureTimes.erase(
+          std::unique(departureTimes.begin(), departureTimes.end()),
+          departureTimes.end());
+      numberOfDepartures += departureTimes.size();
+
+      timer.restart();
+      for (const int departureTime : departureTimes) {
+        trexQuery.run(query.source, departureTime, query.target);
+        singleJourneys += trexQuery.getJourneys().size();
+      }
+      singleTime += timer.elapsedMicroseconds();
+    }
+    rangeQuery.getProfiler().printStatistics();
+    std::cout << "Avg. departures: "
+              << String::prettyDouble(numberOfDepartures / n) << std::endl;
+    std::cout << "Range query:          "
+              << String::prettyDouble(rangeJourneys / n) << " journeys, "
+              << String::musToString(rangeTime / n) << " per query"
+              << std::endl;
+    std::cout << "One per departure:    "
+              << String::prettyDouble(singleJourneys / n) << " journeys, "
+              << String::musToString(singleTime / n) << " per query"
+              << std::endl;
+    std::cout << "Speedup: " << String::prettyDouble(singleTime / rangeTime)
+              << std::endl;
+  }
+};
+
 class WriteTREXToCSV : public ParameterizedCommand {
  public:
   WriteTREXToCSV(BasicShell &shell)
@@ -545,13 +1164,26 @@ class RunGeoRankedTREXQueries : public ParameterizedCommand {
     addParameter("Number of source stops");
     addParameter("Output csv file");
     addParameter("Lowest r");
+    addParameter("Timestamped reached index", "false");
   }
 
   virtual void execute() noexcept {
+    if (getParameter<bool>("Timestamped reached index")) {
+      run<TripBased::TimestampedReachedIndex>();
+    } else {
+      run<TripBased::ReachedIndex>();
+    }
+  }
+
+ private:
+  template <typename REACHED_INDEX>
+  inline void run() noexcept {
     const std::string file = getParameter("Output csv file");
     TripBased::TREXData data(getParameter("TREX input file"));
     data.printInfo();
-    TripBased::TREXQuery<TripBased::AggregateProfiler> algorithm(data);
+    TripBased::TREXQuery<TripBased::AggregateProfiler, TripBased::TREXData,
+                         TripBased::PaddedEdgeLayout, REACHED_INDEX>
+        algorithm(data);
 
     const size_t n = getParameter<size_t>("Number of source stops");
     const int minR = getParameter<int>("Lowest r");
@@ -631,6 +1263,22 @@ class RunGeoRankedTREXQueries : public ParameterizedCommand {
       csv << "\n";
       ++i;
     }
+
+    // Short range queries (small r) are where resetting the reached index
+    // dominates
+    std::cout << "Average query time per geo rank:" << std::endl;
+    for (int r = minR; r <= maxR; ++r) {
+      double sum = 0;
+      size_t count = 0;
+      for (size_t k = r - minR; k < queryRunTimes.size();
+           k += maxR - minR + 1) {
+        sum += queryRunTimes[k];
+        ++count;
+      }
+      if (count == 0) continue;
+      std::cout << "   r = " << std::setw(2) << r << ": "
+                << String::musToString(sum / count) << std::endl;
+    }
   }
 };
 
@@ -669,7 +1317,8 @@ class CheckBorderStops : public ParameterizedCommand {
 
     for (int level = 0; level < numLevels; ++level) {
       std::cout << "*** Level " << (numLevels - level) << " ***" << std::endl;
-      for (int cell = 0; cell < (1 << (numLevels - level)); ++cell) {
+      const int numCells = 1 << data.getCellShift(numLevels - level);
+      for (int cell = 0; cell < numCells; ++cell) {
         auto inAndOutTrips =
             checker.collectIncommingAndOutgoingTrips(level, cell);
 
@@ -848,10 +1497,11 @@ class ShowInducedCellOfNetwork : public ParameterizedCommand {
 
     auto isInCell = [&](const StopId stop, const int level,
                         const int cell) -> bool {
-      assert(level >= 0 && level < 16);
-      assert(cell == 0 || cell == 1);
-      return ((data.getCellIdOfStop(stop) >> level) & 1) ==
-             static_cast<std::uint16_t>(cell);
+      assert(data.isLevel(level));
+      assert(cell >= 0 && cell < data.getNumberOfCellsPerLevel());
+      return (data.getCellOfStop(stop, level) &
+              (data.getNumberOfCellsPerLevel() - 1)) ==
+             static_cast<std::uint32_t>(cell);
     };
 
     for (StopId stop(0); stop < data.numberOfStops(); ++stop) {
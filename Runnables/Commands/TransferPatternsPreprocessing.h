@@ -103,6 +103,7 @@ class ComputeTPUsingTB : public ParameterizedCommand {
     addParameter("Output file (TP Data)");
     addParameter("Number of threads", "max");
     addParameter("Pin multiplier", "1");
+    addParameter("Lower bound cells", "0");
   }
 
   virtual void execute() noexcept {
@@ -110,11 +111,12 @@ class ComputeTPUsingTB : public ParameterizedCommand {
     const std::string outputFile = getParameter("Output file (TP Data)");
     const int numberOfThreads = getNumberOfThreads();
     const int pinMultiplier = getParameter<int>("Pin multiplier");
+    const size_t lowerBoundCells = getParameter<size_t>("Lower bound cells");
 
     TripBased::Data data(inputFile);
     data.printInfo();
 
-    TransferPattern::Data tpData(data.raptorData);
+    TransferPattern::Data tpData(data.raptorData, lowerBoundCells);
 
     std::cout << "Computing Transfer Pattern with " << (int)numberOfThreads
               << " # of threads!" << std::endl;
@@ -130,12 +132,15 @@ class ComputeTPUsingTB : public ParameterizedCommand {
     long long totalNumEdges(0);
 
     for (const StopId stop : tpData.raptorData.stops()) {
-      totalNumVertices += tpData.transferPatternOfStop[stop].numVertices();
-      totalNumEdges += tpData.transferPatternOfStop[stop].numEdges();
+      totalNumVertices += tpData.transferPatterns.dagOfStop(stop).numVertices();
+      totalNumEdges += tpData.transferPatterns.dagOfStop(stop).numEdges();
     }
 
     std::cout << "Total Size:       "
               << String::bytesToString(tpData.byteSize()) << std::endl;
+    std::cout << "Lower bounds:     "
+              << String::bytesToString(tpData.lowerBoundsByteSize())
+              << std::endl;
     std::cout << "Average # Nodes:  "
               << String::prettyDouble(totalNumVertices /
                                       data.raptorData.numberOfStops())
@@ -184,10 +189,67 @@ class ExportTPDAGOfStop : public ParameterizedCommand {
       std::cout << "Stop Out of range!" << std::endl;
       return;
     }
+    StaticDAGTransferPattern dag;
+    data.transferPatterns.copyDAG(StopId(stop), dag);
     if (type == "GML") {
-      Graph::toGML(outputFile, data.transferPatternOfStop[stop]);
+      Graph::toGML(outputFile, dag);
     } else {
-      Graph::toEdgeListCSV(outputFile, data.transferPatternOfStop[stop]);
+      Graph::toEdgeListCSV(outputFile, dag);
     }
   }
 };
+
+class CompactTPLowerBounds : public ParameterizedCommand {
+ public:
+  CompactTPLowerBounds(BasicShell& shell)
+      : ParameterizedCommand(shell, "compactTPLowerBounds",
+                             "Replaces the stop-to-stop A* lower bounds of the "
+                             "given Transfer Pattern data by cell-to-cell "
+                             "lower bounds.") {
+    addParameter("Input file (TP Data)");
+    addParameter("Output file (TP Data)");
+    addParameter("Number of cells", "1024");
+    addParameter("Number of queries", "1000");
+  }
+
+  virtual void execute() noexcept {
+    const std::string inputFile = getParameter("Input file (TP Data)");
+    const std::string outputFile = getParameter("Output file (TP Data)");
+    const size_t numberOfCells = getParameter<size_t>("Number of cells");
+
+    TransferPattern::Data data(inputFile);
+    if (data.hasCompactLowerBounds()) {
+      std::cout << "Lower bounds are already compact!" << std::endl;
+      return;
+    }
+
+    // Compares the A* query time with dense and with compact lower bounds
+    const std::vector<StopQuery> queries =
+        generateRandomStopQueries(data.raptorData.numberOfStops(),
+                                  getParameter<size_t>("Number of queries"));
+    const auto averageQueryTime = [&]() {
+      if (queries.empty()) return 0.0;
+      TransferPattern::QueryAStar<TransferPattern::AggregateProfiler> algorithm(
+          data);
+      for (const StopQuery& query : queries) {
+        algorithm.run(query.source, query.departureTime, query.target);
+      }
+      return algorithm.getProfiler().getTotalTime();
+    };
+
+    const long long denseSize = data.lowerBoundsByteSize();
+    const double denseQueryTime = averageQueryTime();
+    data.useCompactLowerBounds(numberOfCells);
+    const double compactQueryTime = averageQueryTime();
+    std::cout << "Lower bounds (dense):   " << String::bytesToString(denseSize)
+              << ", A* query time: " << String::musToString(denseQueryTime)
+              << std::endl;
+    std::cout << "Lower bounds (compact): "
+              << String::bytesToString(data.lowerBoundsByteSize()) << " ("
+              << data.compactLowerBounds.numberOfCells()
+              << " cells), A* query time: "
+              << String::musToString(compactQueryTime) << std::endl;
+
+    data.serialize(outputFile);
+  }
+};
@@ -367,6 +367,7 @@ class RAPTORToTripBased : public ParameterizedCommand {
     raptor.printInfo();
     TripBased::Data data(raptor);
 
+    Timer timer;
     if (numberOfThreads == 0) {
       if (routeBasedPruning) {
         TripBased::ComputeStopEventGraphRouteBased(data);
@@ -381,6 +382,8 @@ class RAPTORToTripBased : public ParameterizedCommand {
         TripBased::ComputeStopEventGraph(data, numberOfThreads, pinMultiplier);
       }
     }
+    std::cout << "Stop event graph computed in "
+              << String::msToString(timer.elapsedMilliseconds()) << std::endl;
 
     data.printInfo();
     data.serialize(outputFile);
@@ -38,6 +38,7 @@ int main(int argc, char** argv) {
   new ExportTPDAGOfStop(shell);
   new RunTransferPatternQueries(shell);
   new ComputeTPUsingTB(shell);
+  new CompactTPLowerBounds(shell);
 
   shell.run();
   return 0;
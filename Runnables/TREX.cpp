@@ -51,22 +51,31 @@ int main(int argc, char **argv) {
   new RAPTORToTREX(shell);
   new CreateCompactLayoutGraph(shell);
   new Customization(shell);
+  new IncrementalCustomization(shell);
+  new BenchmarkCustomization(shell);
   new ShowInfoOfTREX(shell);
+  new WriteMappedTREX(shell);
   new WriteTREXToCSV(shell);
   new EventDistributionOverTime(shell);
   new CheckBorderStops(shell);
   new ExportTREXTimeExpandedGraph(shell);
   new BuildTBTEGraph(shell);
+  new CompareTopoBFS(shell);
   new ShowInducedCellOfNetwork(shell);
 
   new RunTREXQuery(shell);
+  new RunParallelTREXQueries(shell);
+  new CompareTREXEdgeLayouts(shell);
+  new RunTREXMatrixQueries(shell);
   new RunTREXProfileQueries(shell);
+  new RunTREXRangeQueries(shell);
 
   new RunTransitiveRAPTORQueries(shell);
   new RunOneTransitiveRAPTORQuery(shell);
   new RunTransitiveTripBasedQueries(shell);
   new RunTransitiveCSAQueries(shell);
   new RunTransitiveProfileTripBasedQueries(shell);
+  new RunMultiDepartureProfileTripBasedQueries(shell);
 
   new RunGeoRankedRAPTORQueries(shell);
   new RunGeoRankedTripBasedQueries(shell);
@@ -81,6 +90,7 @@ int main(int argc, char **argv) {
   new RunTEDijkstraQueries(shell);
 
   new TEToPTL(shell);
+  new BuildPTL(shell);
   new RunPTLQueries(shell);
 
   new DistanceNetwork(shell);
@@ -52,6 +52,7 @@ int main(int argc, char** argv) {
 
   new RunTransitiveCSAQueries(shell);
   new RunTransitiveProfileCSAQueries(shell);
+  new RunMultiDepartureCSAQueries(shell);
   new RunDijkstraCSAQueries(shell);
   new RunHLCSAQueries(shell);
   new RunULTRACSAQueries(shell);